@@ -0,0 +1,96 @@
+#ifndef ADAPTIVEBUFFERSIZE_HPP
+#define ADAPTIVEBUFFERSIZE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include "Metrics.hpp"
+
+#if defined(min) || defined(max)
+#  error "windows.h was included without NOMINMAX"
+#endif
+
+namespace pcmplayer
+{
+    // Picks the smallest buffer size that runs without dropouts. The size
+    // is doubled as soon as a deadline is missed and halved after a quiet
+    // period with enough headroom. Every shrink that has to be undone
+    // doubles the quiet period required for the next one.
+    class AdaptiveBufferSize final
+    {
+    public:
+        AdaptiveBufferSize(std::uint32_t initMinSize,
+                           std::uint32_t initMaxSize,
+                           std::uint32_t initQuietUpdates = 8,
+                           double initShrinkLoad = 0.4):
+            minSize{initMinSize},
+            maxSize{initMaxSize},
+            size{initMinSize},
+            baseQuietUpdates{initQuietUpdates},
+            requiredQuietUpdates{initQuietUpdates},
+            shrinkLoad{initShrinkLoad}
+        {
+            if (minSize == 0 || minSize > maxSize)
+                throw std::runtime_error("Invalid buffer size range");
+        }
+
+        auto getMinSize() const noexcept { return minSize; }
+        auto getMaxSize() const noexcept { return maxSize; }
+        auto getSize() const noexcept { return size; }
+
+        // returns true if the buffer size has changed
+        bool update(const Metrics& metrics) noexcept
+        {
+            const auto misses = metrics.getUnderruns() + metrics.getXruns() + metrics.getMissedDeadlines();
+            const auto duration = metrics.getTotalDuration();
+            const auto budget = metrics.getTotalBudget();
+
+            const auto newMisses = misses - lastMisses;
+            const auto load = budget > lastBudget ?
+                static_cast<double>(duration - lastDuration) / (budget - lastBudget) : 0.0;
+
+            lastMisses = misses;
+            lastDuration = duration;
+            lastBudget = budget;
+
+            if (newMisses)
+            {
+                quietUpdates = 0;
+
+                if (size == maxSize) return false;
+
+                // the last shrink was too aggressive, wait longer next time
+                if (shrunk)
+                    requiredQuietUpdates = std::min(requiredQuietUpdates * 2, baseQuietUpdates * 64);
+
+                shrunk = false;
+                size = std::min(size * 2, maxSize);
+                return true;
+            }
+
+            if (++quietUpdates < requiredQuietUpdates || load > shrinkLoad || size == minSize)
+                return false;
+
+            quietUpdates = 0;
+            shrunk = true;
+            size = std::max(size / 2, minSize);
+            return true;
+        }
+
+    private:
+        std::uint32_t minSize;
+        std::uint32_t maxSize;
+        std::uint32_t size;
+        std::uint32_t baseQuietUpdates;
+        std::uint32_t requiredQuietUpdates;
+        std::uint32_t quietUpdates = 0;
+        double shrinkLoad;
+        bool shrunk = false;
+
+        std::uint64_t lastMisses = 0;
+        std::uint64_t lastDuration = 0;
+        std::uint64_t lastBudget = 0;
+    };
+}
+
+#endif // ADAPTIVEBUFFERSIZE_HPP
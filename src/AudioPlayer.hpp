@@ -1,11 +1,28 @@
 #ifndef AUDIOPLAYER_HPP
 #define AUDIOPLAYER_HPP
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <functional>
+#include <new>
+#include <optional>
+#include <stdexcept>
 #include <vector>
+#include "AdaptiveBufferSize.hpp"
 #include "Driver.hpp"
+#include "Metrics.hpp"
+#include "PlaybackClock.hpp"
+#include "RenderThread.hpp"
+#include "SampleBuffer.hpp"
+#include "SampleConverter.hpp"
 #include "SampleFormat.hpp"
+#include "Source.hpp"
+#include "Trace.hpp"
+#include "dsp/AnalysisTap.hpp"
+#include "dsp/Limiter.hpp"
+#include "dsp/ProcessorChain.hpp"
+#include "dsp/Silence.hpp"
 
 namespace pcmplayer
 {
@@ -18,53 +35,359 @@ namespace pcmplayer
                     SampleFormat initSampleFormat,
                     std::uint16_t initChannels) :
             driver(initDriver),
+            sampleFormat(initSampleFormat),
             bufferSize(initBufferSize),
             sampleRate(initSampleRate),
-            sampleFormat(initSampleFormat),
-            channels(initChannels)
+            channels(initChannels),
+            metrics(initSampleRate),
+            playbackClock(initSampleRate)
         {
+            processors.prepare(sampleRate, renderBlockSize, channels);
         }
 
         virtual ~AudioPlayer() = default;
 
-        void play(const std::vector<float> s)
+        void play(const SampleBuffer& s)
+        {
+            setSamples(s);
+            start();
+        }
+
+        void play(Source& s)
         {
-            samples = s;
+            setSource(s);
             start();
         }
 
+        // Sends the samples to the device untouched, the device must have
+        // accepted the same sample format
+        void playBitExact(const ByteBuffer& d, SampleFormat dataSampleFormat)
+        {
+            setBitExactData(d, dataSampleFormat);
+            start();
+        }
+
+        // sets the data without starting the playback, e.g. for a Scheduler
+        void setSamples(const SampleBuffer& s)
+        {
+            bufferSource = BufferSource(s, channels);
+            bufferSource.setLoop(loop);
+            setSource(bufferSource);
+        }
+
+        // the source must outlive the playback
+        void setSource(Source& s)
+        {
+            if (renderThreadSettings) s.setRenderThreadSettings(*renderThreadSettings);
+
+            source = &s;
+            bitExactData.clear();
+            resetPosition();
+            renderBuffer.resize(static_cast<std::size_t>(bufferSize < renderBlockSize ? renderBlockSize : bufferSize) * channels);
+        }
+
+        void setBitExactData(const ByteBuffer& d, SampleFormat dataSampleFormat)
+        {
+            if (dataSampleFormat != sampleFormat)
+                throw std::runtime_error("Sample format does not match the device format");
+
+            bitExactData = d;
+            offset = 0;
+            loopsPlayed = 0;
+            source = nullptr;
+            resetPosition();
+        }
+
+        // Repeats a region of the samples or the bit-exact data by wrapping
+        // the read position, must be set before the playback
+        void setLoop(const Loop& newLoop) noexcept
+        {
+            loop = newLoop;
+            loopsPlayed = 0;
+            bufferSource.setLoop(loop);
+        }
+
+        // Starts the data at the frame of the stream, counted from the first
+        // rendered frame. The frames before it are rendered as silence.
+        void setStartFrame(std::uint64_t frame) noexcept
+        {
+            startFrame = frame;
+            startTime.reset();
+        }
+
+        // Starts the data at the time, resolved to a frame when the first
+        // frame is rendered, so it is only as accurate as the device latency
+        void setStartTime(std::chrono::steady_clock::time_point time) noexcept
+        {
+            startFrame = 0;
+            startTime = time;
+        }
+
+        const Metrics& getMetrics() const noexcept { return metrics; }
+
+        // The last position reported by the device, lock-free and cheap
+        // enough to be polled from any thread at a high rate
+        PlaybackPosition getPlaybackPosition() const noexcept { return playbackClock.read(); }
+
+        // the frame of the stream presented at the time, extrapolated
+        std::uint64_t getPresentedFrame(std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now()) const noexcept
+        {
+            return playbackClock.getFrame(time);
+        }
+
+        auto getBufferSize() const noexcept { return bufferSize; }
+        auto getSampleFormat() const noexcept { return sampleFormat; }
+
+        void setDither(bool enabled) noexcept { dither.setEnabled(enabled); }
+
+        // Inserts the processor after the source and before the limiter,
+        // it must outlive the player and be added before the playback.
+        // The bit-exact data is not processed.
+        void addProcessor(dsp::Processor& processor)
+        {
+            processors.add(processor);
+        }
+
+        // Keeps the samples under the threshold of the limiter, which
+        // delays them by its lookahead. Must be set before the playback.
+        void setLimiter(const dsp::LimiterSettings& settings)
+        {
+            limiter.emplace(settings);
+            limiter->prepare(sampleRate, renderBlockSize, channels);
+        }
+
+        // Copies the rendered samples after the limiter to the tap for the
+        // readers on other threads, it must outlive the player and be set
+        // before the playback
+        void setTap(dsp::AnalysisTap& newTap)
+        {
+            newTap.prepare(sampleRate, renderBlockSize, channels);
+            tap = &newTap;
+        }
+
+        // Starts with the smallest buffer size and lets the player grow and
+        // shrink it between the bounds depending on the dropouts
+        void setAdaptiveBufferSize(std::uint32_t minSize, std::uint32_t maxSize)
+        {
+            adaptiveBufferSize.emplace(minSize, maxSize);
+            setBufferSize(adaptiveBufferSize->getSize());
+        }
+
+        // Applied by the backends that own their render thread before the
+        // first callback, CoreAudio renders on a thread that is already
+        // real-time. Must be set before the source to reach its threads.
+        void setRenderThreadSettings(const RenderThreadSettings& settings)
+        {
+            renderThreadSettings = settings;
+        }
+
+        // the first error from configuring the render thread
+        auto getRenderThreadError() const noexcept { return renderThreadError; }
+
     protected:
         virtual void start() = 0;
         virtual void stop() = 0;
+        virtual void setBufferSize(std::uint32_t newBufferSize) = 0;
+
+        // must not be called from the render callback
+        void adaptBufferSize()
+        {
+            if (!adaptiveBufferSize) return;
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now - lastAdaptation < adaptationInterval) return;
+            lastAdaptation = now;
+
+            if (adaptiveBufferSize->update(metrics))
+                setBufferSize(adaptiveBufferSize->getSize());
+        }
+
+        // Must be called from the render thread before the first callback,
+        // everything the callbacks touch is allocated and faulted in here
+        void prepareRenderThread() noexcept
+        {
+            if (renderThreadPrepared) return;
+            renderThreadPrepared = true;
+
+            try
+            {
+                trace::Tracer::getInstance().prepareThread();
+            }
+            catch (const std::bad_alloc&)
+            {
+                trace::Tracer::getInstance().setEnabled(false);
+            }
+
+            if (renderThreadSettings)
+                renderThreadError = RenderThread::configureCurrentThread(*renderThreadSettings);
+
+            if (source == &bufferSource)
+                RenderThread::prefault(const_cast<float*>(bufferSource.getSamples().data()),
+                                       bufferSource.getSamples().size() * sizeof(float));
+            RenderThread::prefault(bitExactData.data(), bitExactData.size());
+            RenderThread::prefault(renderBuffer.data(), renderBuffer.size() * sizeof(float));
+        }
+
+        // frames rendered since the start, including the silence
+        std::uint64_t getRenderedFrames() const noexcept { return position; }
+
+        // the frame of the stream at which the data ended, valid after render() returned false
+        std::uint64_t getEndFrame() const noexcept { return endFrame; }
+
+        // Called from the render thread after a callback with the frame of
+        // the stream that the device presents at the time
+        void publishPlaybackPosition(std::uint64_t frame, std::chrono::steady_clock::time_point time) noexcept
+        {
+            playbackClock.publish(PlaybackPosition{frame < position ? frame : position, time, position});
+        }
+
+        // for the devices that report how many rendered frames they have not played yet
+        void publishPlaybackPosition(std::uint64_t queuedFrames) noexcept
+        {
+            publishPlaybackPosition(queuedFrames < position ? position - queuedFrames : 0,
+                                    std::chrono::steady_clock::now());
+        }
 
-        bool getData(std::uint32_t frames, std::vector<float>& result)
+        static constexpr std::chrono::milliseconds adaptationInterval{250};
+        static constexpr std::uint32_t renderBlockSize = 512; // in frames
+
+        // Renders the frames in the device sample format, the output buffer
+        // is written directly if the device accepts floats
+        bool render(std::uint32_t frames, void* output)
         {
-            result.clear();
-            result.reserve(frames * channels);
+            const auto frameSize = getSampleSize(sampleFormat) * channels;
+            auto destination = static_cast<std::uint8_t*>(output);
 
-            const std::size_t bufferFrames = samples.size() / channels;
-            const std::size_t remainingFrames = bufferFrames - offset;
+            resolveStartTime();
 
-            if (remainingFrames > frames)
+            // the silence before the start is never stored
+            if (position < startFrame)
             {
-                result.insert(result.end(),
-                              samples.begin() + offset * channels,
-                              samples.begin() + (offset + frames) * channels);
+                const auto silentFrames = static_cast<std::uint32_t>(startFrame - position < frames ? startFrame - position : frames);
+                std::fill(destination, destination + silentFrames * frameSize,
+                          sampleFormat == SampleFormat::unsignedInt8 ? 0x80 : 0x00);
 
-                offset += frames;
+                position += silentFrames;
+                destination += silentFrames * frameSize;
+                frames -= silentFrames;
 
-                return true;
+                if (frames == 0) return true;
             }
+
+            const auto firstFrame = position;
+            position += frames;
+
+            std::uint32_t dataFrames = 0;
+
+            if (!bitExactData.empty())
+                dataFrames = getBitExactData(frames, destination);
+            else if (sampleFormat == SampleFormat::float32)
+                dataFrames = getData(frames, reinterpret_cast<float*>(destination));
             else
             {
-                result.insert(result.end(),
-                    samples.begin() + offset * channels,
-                    samples.end());
+                const auto blockFrames = static_cast<std::uint32_t>(renderBuffer.size() / channels);
 
-                offset = bufferFrames;
+                for (std::uint32_t i = 0; i < frames; i += blockFrames)
+                {
+                    const auto currentFrames = frames - i < blockFrames ? frames - i : blockFrames;
+                    dataFrames += getData(currentFrames, renderBuffer.data());
 
-                return false;
+                    // dithered silence is not silent
+                    if (renderedSilence && !dither.isEnabled())
+                        std::fill(destination, destination + currentFrames * frameSize,
+                                  sampleFormat == SampleFormat::unsignedInt8 ? 0x80 : 0x00);
+                    else
+                        convert(renderBuffer.data(), destination, currentFrames * channels, sampleFormat, &dither);
+
+                    destination += currentFrames * frameSize;
+                }
             }
+
+            if (dataFrames < frames || isDataFinished())
+            {
+                if (!dataEndFrame) dataEndFrame = firstFrame + dataFrames;
+
+                // the processors still hold the end of the data
+                const auto tail = bitExactData.empty() ? getProcessingLatency() : 0;
+                if (*dataEndFrame + tail <= position)
+                {
+                    endFrame = *dataEndFrame + tail;
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        void resolveStartTime() noexcept
+        {
+            if (position != 0 || !startTime) return;
+
+            const std::chrono::duration<double> delay = *startTime - std::chrono::steady_clock::now();
+            startFrame = delay.count() > 0.0 ? static_cast<std::uint64_t>(delay.count() * sampleRate) : 0;
+            startTime.reset();
+        }
+
+        void resetPosition() noexcept
+        {
+            position = 0;
+            endFrame = 0;
+            dataEndFrame.reset();
+            processors.reset();
+            if (limiter) limiter->reset();
+            limiterGate.reset();
+            playbackClock.publish(PlaybackPosition{0, std::chrono::steady_clock::now(), 0});
+        }
+
+        bool isDataFinished() const noexcept
+        {
+            if (!bitExactData.empty())
+                return offset == bitExactData.size() / (getSampleSize(sampleFormat) * channels);
+
+            return !source || source->isFinished();
+        }
+
+        // Reads the next frames from the source, pads them with silence
+        // after its end and returns the number of frames read
+        std::uint32_t getData(std::uint32_t frames, float* result)
+        {
+            trace::Scope scope("AudioPlayer::getData");
+
+            const auto readFrames = source && !source->isFinished() ? source->read(result, frames) : 0;
+            std::fill(result + readFrames * channels, result + frames * channels, 0.0F);
+
+            // the padding after the end of the source is known to be silent
+            auto silent = processors.process(result, frames, readFrames == 0);
+            if (limiter) silent = limiterGate.process(*limiter, result, frames, channels, silent);
+            if (tap) tap->process(result, frames);
+            renderedSilence = silent;
+
+            return readFrames;
+        }
+
+        std::uint32_t getProcessingLatency() const noexcept
+        {
+            return processors.getLatency() + (limiter ? limiter->getLatency() : 0);
+        }
+
+        std::uint32_t getBitExactData(std::uint32_t frames, void* output)
+        {
+            trace::Scope scope("AudioPlayer::getBitExactData");
+
+            const std::size_t frameSize = getSampleSize(sampleFormat) * channels;
+            auto result = static_cast<std::uint8_t*>(output);
+
+            const auto copyFrames = readLooped(offset, bitExactData.size() / frameSize, frames, loop, loopsPlayed,
+                                               [this, result, frameSize](std::size_t first, std::uint32_t written, std::uint32_t count) noexcept {
+                std::copy(bitExactData.begin() + first * frameSize,
+                          bitExactData.begin() + (first + count) * frameSize,
+                          result + written * frameSize);
+            });
+            std::fill(result + copyFrames * frameSize,
+                      result + frames * frameSize,
+                      sampleFormat == SampleFormat::unsignedInt8 ? 0x80 : 0x00);
+
+            return copyFrames;
         }
 
         Driver driver;
@@ -74,9 +397,38 @@ namespace pcmplayer
         std::uint32_t sampleRate;
         std::uint16_t channels;
 
+        Metrics metrics;
+
     private:
-        std::vector<float> samples;
-        std::size_t offset = 0;
+        PlaybackClock playbackClock;
+
+        BufferSource bufferSource;
+        Source* source = nullptr;
+
+        std::size_t offset = 0; // in the bit-exact data
+        Loop loop;
+        std::uint32_t loopsPlayed = 0;
+        std::uint64_t position = 0; // frames rendered, including the silence
+        std::uint64_t endFrame = 0;
+        std::optional<std::uint64_t> dataEndFrame;
+        std::uint64_t startFrame = 0;
+        std::optional<std::chrono::steady_clock::time_point> startTime;
+
+        ByteBuffer bitExactData;
+        SampleBuffer renderBuffer;
+        Dither dither;
+        dsp::ProcessorChain processors;
+        std::optional<dsp::Limiter> limiter;
+        dsp::SilenceGate limiterGate;
+        dsp::AnalysisTap* tap = nullptr;
+        bool renderedSilence = false; // the result of the last getData()
+
+        std::optional<RenderThreadSettings> renderThreadSettings;
+        std::error_code renderThreadError;
+        bool renderThreadPrepared = false;
+
+        std::optional<AdaptiveBufferSize> adaptiveBufferSize;
+        std::chrono::steady_clock::time_point lastAdaptation;
     };
 }
 
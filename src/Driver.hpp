@@ -9,6 +9,7 @@ namespace pcmplayer
         openSL,
         coreAudio,
         alsa,
+        pulseAudio,
         wasapi
     };
 }
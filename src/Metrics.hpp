@@ -0,0 +1,157 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace pcmplayer
+{
+    // Real-time statistics of the render callback. All values are written
+    // only from the render thread and can be read from any other thread.
+    class Metrics final
+    {
+    public:
+        // bucket N counts callbacks that took [2^N, 2^(N+1)) microseconds
+        static constexpr std::size_t bucketCount = 20;
+
+        explicit Metrics(std::uint32_t initSampleRate) noexcept:
+            sampleRate{initSampleRate}
+        {
+        }
+
+        Metrics(const Metrics&) = delete;
+        Metrics& operator=(const Metrics&) = delete;
+
+        std::chrono::steady_clock::time_point beginCallback() noexcept
+        {
+            const auto now = std::chrono::steady_clock::now();
+
+            if (lastWakeUp != std::chrono::steady_clock::time_point{} && lastFrames != 0)
+            {
+                const auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastWakeUp).count();
+                const auto expected = static_cast<std::int64_t>(lastFrames * nanosecondsPerSecond / sampleRate);
+                const auto jitter = static_cast<std::uint64_t>(interval > expected ? interval - expected : expected - interval);
+
+                store(lastJitter, jitter);
+                store(totalJitter, totalJitter.load(std::memory_order_relaxed) + jitter);
+                if (jitter > maxJitter.load(std::memory_order_relaxed))
+                    store(maxJitter, jitter);
+            }
+
+            lastWakeUp = now;
+            return now;
+        }
+
+        void endCallback(std::chrono::steady_clock::time_point begin, std::uint32_t frames) noexcept
+        {
+            const auto duration = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+            const auto budget = static_cast<std::uint64_t>(frames) * nanosecondsPerSecond / sampleRate;
+
+            store(callbacks, callbacks.load(std::memory_order_relaxed) + 1);
+            store(framesRendered, framesRendered.load(std::memory_order_relaxed) + frames);
+            store(lastDuration, duration);
+            store(lastBudget, budget);
+            store(totalDuration, totalDuration.load(std::memory_order_relaxed) + duration);
+            store(totalBudget, totalBudget.load(std::memory_order_relaxed) + budget);
+            if (duration > maxDuration.load(std::memory_order_relaxed))
+                store(maxDuration, duration);
+            if (duration > budget)
+                store(missedDeadlines, missedDeadlines.load(std::memory_order_relaxed) + 1);
+
+            auto& bucket = histogram[getBucket(duration / 1000U)];
+            store(bucket, bucket.load(std::memory_order_relaxed) + 1);
+
+            lastFrames = frames;
+        }
+
+        // the device ran out of data because a callback did not deliver in time
+        void underrun() noexcept
+        {
+            store(underruns, underruns.load(std::memory_order_relaxed) + 1);
+        }
+
+        // the driver reported an overload or a discontinuity
+        void xrun() noexcept
+        {
+            xruns.fetch_add(1, std::memory_order_relaxed); // may be reported from a notification thread
+        }
+
+        void error() noexcept
+        {
+            store(errors, errors.load(std::memory_order_relaxed) + 1);
+        }
+
+        auto getSampleRate() const noexcept { return sampleRate; }
+        auto getCallbacks() const noexcept { return callbacks.load(std::memory_order_relaxed); }
+        auto getFramesRendered() const noexcept { return framesRendered.load(std::memory_order_relaxed); }
+        auto getUnderruns() const noexcept { return underruns.load(std::memory_order_relaxed); }
+        auto getXruns() const noexcept { return xruns.load(std::memory_order_relaxed); }
+        auto getErrors() const noexcept { return errors.load(std::memory_order_relaxed); }
+        auto getMissedDeadlines() const noexcept { return missedDeadlines.load(std::memory_order_relaxed); }
+
+        // durations are in nanoseconds
+        auto getLastDuration() const noexcept { return lastDuration.load(std::memory_order_relaxed); }
+        auto getMaxDuration() const noexcept { return maxDuration.load(std::memory_order_relaxed); }
+        auto getTotalDuration() const noexcept { return totalDuration.load(std::memory_order_relaxed); }
+        auto getLastBudget() const noexcept { return lastBudget.load(std::memory_order_relaxed); }
+        auto getTotalBudget() const noexcept { return totalBudget.load(std::memory_order_relaxed); }
+        auto getLastJitter() const noexcept { return lastJitter.load(std::memory_order_relaxed); }
+        auto getMaxJitter() const noexcept { return maxJitter.load(std::memory_order_relaxed); }
+        auto getTotalJitter() const noexcept { return totalJitter.load(std::memory_order_relaxed); }
+
+        auto getHistogram(std::size_t bucket) const noexcept
+        {
+            return histogram[bucket].load(std::memory_order_relaxed);
+        }
+
+        // fraction of the time budget spent in the callbacks
+        double getLoad() const noexcept
+        {
+            const auto budget = getTotalBudget();
+            return budget ? static_cast<double>(getTotalDuration()) / budget : 0.0;
+        }
+
+    private:
+        static constexpr std::uint64_t nanosecondsPerSecond = 1'000'000'000U;
+
+        static void store(std::atomic<std::uint64_t>& value, std::uint64_t newValue) noexcept
+        {
+            value.store(newValue, std::memory_order_relaxed);
+        }
+
+        static std::size_t getBucket(std::uint64_t microseconds) noexcept
+        {
+            std::size_t bucket = 0;
+            while (microseconds > 1 && bucket < bucketCount - 1)
+            {
+                microseconds >>= 1;
+                ++bucket;
+            }
+            return bucket;
+        }
+
+        std::uint32_t sampleRate;
+        std::chrono::steady_clock::time_point lastWakeUp;
+        std::uint32_t lastFrames = 0;
+
+        std::atomic<std::uint64_t> callbacks{0};
+        std::atomic<std::uint64_t> framesRendered{0};
+        std::atomic<std::uint64_t> underruns{0};
+        std::atomic<std::uint64_t> xruns{0};
+        std::atomic<std::uint64_t> errors{0};
+        std::atomic<std::uint64_t> missedDeadlines{0};
+        std::atomic<std::uint64_t> lastDuration{0};
+        std::atomic<std::uint64_t> maxDuration{0};
+        std::atomic<std::uint64_t> totalDuration{0};
+        std::atomic<std::uint64_t> lastBudget{0};
+        std::atomic<std::uint64_t> totalBudget{0};
+        std::atomic<std::uint64_t> lastJitter{0};
+        std::atomic<std::uint64_t> maxJitter{0};
+        std::atomic<std::uint64_t> totalJitter{0};
+        std::array<std::atomic<std::uint64_t>, bucketCount> histogram{};
+    };
+}
+
+#endif // METRICS_HPP
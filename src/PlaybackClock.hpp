@@ -0,0 +1,83 @@
+#ifndef PLAYBACKCLOCK_HPP
+#define PLAYBACKCLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace pcmplayer
+{
+    struct PlaybackPosition final
+    {
+        std::uint64_t frame = 0; // frame of the stream that is presented at the time
+        std::chrono::steady_clock::time_point time;
+        std::uint64_t renderedFrames = 0;
+    };
+
+    // Playback position published by the render thread and read by any
+    // number of threads without locking (a sequence lock)
+    class PlaybackClock final
+    {
+    public:
+        explicit PlaybackClock(std::uint32_t initSampleRate) noexcept:
+            sampleRate{initSampleRate}
+        {
+        }
+
+        // must only be called from one thread at a time
+        void publish(const PlaybackPosition& position) noexcept
+        {
+            const auto currentSequence = sequence.load(std::memory_order_relaxed);
+            sequence.store(currentSequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            frame.store(position.frame, std::memory_order_relaxed);
+            time.store(position.time.time_since_epoch().count(), std::memory_order_relaxed);
+            renderedFrames.store(position.renderedFrames, std::memory_order_relaxed);
+
+            sequence.store(currentSequence + 2, std::memory_order_release);
+        }
+
+        PlaybackPosition read() const noexcept
+        {
+            PlaybackPosition result;
+
+            for (;;)
+            {
+                const auto firstSequence = sequence.load(std::memory_order_acquire);
+
+                result.frame = frame.load(std::memory_order_relaxed);
+                result.time = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(time.load(std::memory_order_relaxed)));
+                result.renderedFrames = renderedFrames.load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                // retry if the writer was in the middle of an update
+                if (!(firstSequence & 1) && sequence.load(std::memory_order_relaxed) == firstSequence)
+                    return result;
+            }
+        }
+
+        // The frame presented at the time, extrapolated from the last
+        // published position and limited to the frames rendered so far
+        std::uint64_t getFrame(std::chrono::steady_clock::time_point at) const noexcept
+        {
+            const auto position = read();
+            const std::chrono::duration<double> elapsed = at - position.time;
+            const auto result = static_cast<double>(position.frame) + elapsed.count() * sampleRate;
+
+            if (result <= 0.0) return 0;
+            if (result >= static_cast<double>(position.renderedFrames)) return position.renderedFrames;
+            return static_cast<std::uint64_t>(result);
+        }
+
+    private:
+        std::uint32_t sampleRate;
+        std::atomic<std::uint32_t> sequence{0};
+        std::atomic<std::uint64_t> frame{0};
+        std::atomic<std::chrono::steady_clock::rep> time{0};
+        std::atomic<std::uint64_t> renderedFrames{0};
+    };
+}
+
+#endif // PLAYBACKCLOCK_HPP
@@ -0,0 +1,289 @@
+#ifndef PLAYLIST_HPP
+#define PLAYLIST_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Source.hpp"
+#include "SpscQueue.hpp"
+
+namespace pcmplayer
+{
+    // Plays the items one after another without a gap or with a crossfade.
+    // The next item is decoded on a background thread while the current one
+    // plays and handed to the render thread without locking.
+    class Playlist final: public Source
+    {
+    public:
+        // returns the interleaved samples of an item, runs on the decoding thread
+        using Decoder = std::function<SampleBuffer()>;
+
+        explicit Playlist(std::uint16_t initChannels):
+            channels{initChannels}
+        {
+            if (channels == 0)
+                throw std::runtime_error("Invalid channel count");
+
+            thread = std::thread(&Playlist::decode, this);
+        }
+
+        // must not be destroyed while a player reads from it
+        ~Playlist()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running = false;
+            }
+            condition.notify_all();
+            thread.join();
+        }
+
+        Playlist(const Playlist&) = delete;
+        Playlist& operator=(const Playlist&) = delete;
+
+        // can be called during the playback, which ends when the render
+        // thread runs out of items and none are waiting to be decoded
+        void add(Decoder decoder)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                decoders.push_back(std::move(decoder));
+                remainingItems.fetch_add(1, std::memory_order_release);
+            }
+            condition.notify_all();
+        }
+
+        // Overlaps the end of an item with the start of the next one with
+        // an equal-power crossfade, 0 cuts between them. Must be set before the playback.
+        void setCrossfadeFrames(std::uint32_t frames) noexcept { crossfadeFrames = frames; }
+
+        // For offline rendering: waits for the decoder instead of rendering
+        // silence when it falls behind
+        void setWaitForDecoder(bool wait) noexcept { waitForDecoder = wait; }
+
+        // items whose decoder threw or returned samples of a wrong size
+        std::size_t getFailedItems() const noexcept { return failedItems.load(std::memory_order_relaxed); }
+
+        // silence rendered while the decoder was behind
+        std::uint64_t getLateFrames() const noexcept { return lateFrames.load(std::memory_order_relaxed); }
+
+        std::uint32_t read(float* output, std::uint32_t frames) noexcept final
+        {
+            std::uint32_t written = 0;
+
+            while (written < frames)
+            {
+                if (!current && !(current = takeNext()))
+                {
+                    if (remainingItems.load(std::memory_order_acquire) == 0) break;
+
+                    lateFrames.store(getLateFrames() + frames - written, std::memory_order_relaxed);
+                    std::fill(output + written * channels, output + frames * channels, 0.0F);
+                    written = frames;
+                    break;
+                }
+
+                auto destination = output + written * channels;
+
+                if (fading)
+                {
+                    const auto count = fadeLength - fadePosition < frames - written ? fadeLength - fadePosition : frames - written;
+                    crossfade(destination, count);
+                    written += count;
+
+                    if (fadePosition == fadeLength)
+                    {
+                        retire(fading);
+                        fading = nullptr;
+                    }
+                    continue;
+                }
+
+                // play up to the start of the crossfade or to the end
+                const auto remaining = current->frames - current->offset;
+                const auto fadeStart = crossfadeFrames < remaining ? remaining - crossfadeFrames : 0;
+                const auto count = static_cast<std::uint32_t>(fadeStart < frames - written ? fadeStart : frames - written);
+
+                if (count > 0)
+                {
+                    std::copy(current->samples.begin() + current->offset * channels,
+                              current->samples.begin() + (current->offset + count) * channels,
+                              destination);
+                    current->offset += count;
+                    written += count;
+                    continue;
+                }
+
+                if (remaining > 0 && crossfadeFrames > 0)
+                {
+                    // without a decoded next item the current one plays to the end
+                    if (Item* next = takeNext())
+                    {
+                        fading = current;
+                        current = next;
+                        fadeLength = static_cast<std::uint32_t>(remaining < next->frames ? remaining : next->frames);
+                        fadePosition = 0;
+                        continue;
+                    }
+
+                    const auto endCount = static_cast<std::uint32_t>(remaining < frames - written ? remaining : frames - written);
+                    std::copy(current->samples.begin() + current->offset * channels,
+                              current->samples.begin() + (current->offset + endCount) * channels,
+                              destination);
+                    current->offset += endCount;
+                    written += endCount;
+                }
+
+                if (current->offset == current->frames)
+                {
+                    retire(current);
+                    current = nullptr;
+                }
+            }
+
+            return written;
+        }
+
+        bool isFinished() const noexcept final
+        {
+            return !current && !fading && ready.empty() && remainingItems.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        // the number of items decoded ahead of the one that is playing
+        static constexpr std::size_t lookahead = 1;
+
+        struct Item final
+        {
+            SampleBuffer samples;
+            std::size_t frames = 0;
+            std::size_t offset = 0;
+            std::atomic<bool> finished{false};
+        };
+
+        Item* takeNext() noexcept
+        {
+            Item* item = nullptr;
+
+            if (waitForDecoder)
+                while (ready.empty() && remainingItems.load(std::memory_order_acquire) != 0)
+                    std::this_thread::yield();
+
+            if (!ready.pop(item)) return nullptr;
+
+            remainingItems.fetch_sub(1, std::memory_order_release);
+            return item;
+        }
+
+        // the decoding thread frees the item on its next poll, notifying the
+        // condition variable could block the render thread in the kernel
+        void retire(Item* item) noexcept
+        {
+            item->finished.store(true, std::memory_order_release);
+        }
+
+        void crossfade(float* destination, std::uint32_t count) noexcept
+        {
+            constexpr float halfPi = 1.57079632679489661923F;
+
+            for (std::uint32_t frame = 0; frame < count; ++frame)
+            {
+                const auto t = (static_cast<float>(fadePosition + frame) + 0.5F) / static_cast<float>(fadeLength);
+                const auto fadeOut = std::cos(t * halfPi);
+                const auto fadeIn = std::sin(t * halfPi);
+
+                const auto outSamples = fading->samples.data() + (fading->offset + frame) * channels;
+                const auto inSamples = current->samples.data() + (current->offset + frame) * channels;
+                for (std::uint16_t channel = 0; channel < channels; ++channel)
+                    destination[frame * channels + channel] = outSamples[channel] * fadeOut + inSamples[channel] * fadeIn;
+            }
+
+            fading->offset += count;
+            current->offset += count;
+            fadePosition += count;
+        }
+
+        void decode()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (running)
+            {
+                items.erase(std::remove_if(items.begin(), items.end(), [](const std::unique_ptr<Item>& item) noexcept {
+                    return item->finished.load(std::memory_order_acquire);
+                }), items.end());
+
+                if (decoders.empty() || ready.size() >= lookahead)
+                {
+                    // the render thread never notifies, it only sets flags and pops items
+                    condition.wait_for(lock, std::chrono::milliseconds(10));
+                    continue;
+                }
+
+                auto decoder = std::move(decoders.front());
+                decoders.pop_front();
+                lock.unlock();
+
+                auto item = std::make_unique<Item>();
+                bool failed = false;
+                try
+                {
+                    item->samples = decoder();
+                    item->frames = item->samples.size() / channels;
+                    failed = item->samples.size() % channels != 0;
+                }
+                catch (...)
+                {
+                    failed = true;
+                }
+
+                lock.lock();
+
+                if (failed) failedItems.fetch_add(1, std::memory_order_relaxed);
+
+                if (failed || item->frames == 0)
+                    remainingItems.fetch_sub(1, std::memory_order_release);
+                else
+                {
+                    ready.push(item.get());
+                    items.push_back(std::move(item));
+                }
+            }
+        }
+
+        std::uint16_t channels;
+        std::uint32_t crossfadeFrames = 0;
+        bool waitForDecoder = false;
+
+        // owned by the decoding thread
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<Decoder> decoders;
+        std::vector<std::unique_ptr<Item>> items;
+        bool running = true;
+
+        SpscQueue<Item*, lookahead + 1> ready;
+        std::atomic<std::size_t> remainingItems{0}; // added but not taken by the render thread yet
+        std::atomic<std::size_t> failedItems{0};
+        std::atomic<std::uint64_t> lateFrames{0};
+
+        // owned by the render thread
+        Item* current = nullptr;
+        Item* fading = nullptr;
+        std::uint32_t fadeLength = 0;
+        std::uint32_t fadePosition = 0;
+
+        std::thread thread;
+    };
+}
+
+#endif // PLAYLIST_HPP
@@ -0,0 +1,181 @@
+#ifndef RENDERTHREAD_HPP
+#define RENDERTHREAD_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <system_error>
+#include <thread>
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <sched.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+namespace pcmplayer
+{
+    // Scheduling and memory settings of the thread that renders the audio
+    struct RenderThreadSettings final
+    {
+        enum class Policy
+        {
+            normal,
+            fifo,
+            roundRobin
+        };
+
+        Policy policy = Policy::normal;
+        int priority = 0; // 1-99 for the real-time policies on POSIX
+        int cpu = -1; // no affinity if negative
+        bool lockMemory = false;
+        std::size_t stackPrefaultSize = 0; // in bytes
+    };
+
+    // Marks the code that runs in an audio callback, the tests use it to
+    // check that nothing in there allocates memory or takes a lock
+    class RenderScope final
+    {
+    public:
+        RenderScope() noexcept { ++depth; }
+        ~RenderScope() { --depth; }
+
+        RenderScope(const RenderScope&) = delete;
+        RenderScope& operator=(const RenderScope&) = delete;
+
+        static bool isActive() noexcept { return depth != 0; }
+
+    private:
+        static inline thread_local unsigned int depth = 0;
+    };
+
+    // A thread configured with the settings before it runs, only the Graph
+    // workers use it. The backends render on a thread they do not own
+    // (the one that called play() or the one of the audio server) and
+    // configure it with configureCurrentThread in prepareRenderThread.
+    class RenderThread final
+    {
+    public:
+        // Runs the function on a new thread after it has been configured
+        RenderThread(const RenderThreadSettings& settings, std::function<void()> function):
+            thread{[this, settings, function = std::move(function)]() {
+                error = configureCurrentThread(settings);
+                function();
+            }}
+        {
+        }
+
+        ~RenderThread()
+        {
+            if (thread.joinable()) thread.join();
+        }
+
+        RenderThread(const RenderThread&) = delete;
+        RenderThread& operator=(const RenderThread&) = delete;
+
+        void join()
+        {
+            thread.join();
+        }
+
+        // valid after the thread has been joined or once the function has
+        // signaled that it runs
+        std::error_code getError() const noexcept { return error; }
+
+        // Applies the settings to the calling thread, keeps going after a
+        // failure and returns the first error (usually a missing
+        // permission for the real-time policies or for locking memory)
+        static std::error_code configureCurrentThread(const RenderThreadSettings& settings) noexcept
+        {
+            std::error_code result;
+
+#if defined(_WIN32)
+            if (settings.policy != RenderThreadSettings::Policy::normal &&
+                !SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+                result = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+
+            if (settings.cpu >= 0 && settings.cpu < static_cast<int>(sizeof(DWORD_PTR) * 8) &&
+                !SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << settings.cpu) && !result)
+                result = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+#else
+            if (settings.policy != RenderThreadSettings::Policy::normal)
+            {
+                const int policy = settings.policy == RenderThreadSettings::Policy::fifo ? SCHED_FIFO : SCHED_RR;
+                sched_param param{};
+                param.sched_priority = settings.priority;
+                if (const auto error = pthread_setschedparam(pthread_self(), policy, &param); error != 0)
+                    result = std::error_code(error, std::system_category());
+            }
+
+#  if defined(__linux__)
+            if (settings.cpu >= 0)
+            {
+                cpu_set_t cpuSet;
+                CPU_ZERO(&cpuSet);
+                CPU_SET(settings.cpu, &cpuSet);
+                if (const auto error = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet); error != 0 && !result)
+                    result = std::error_code(error, std::system_category());
+            }
+#  endif
+
+            // keep the code, the stacks and every later allocation resident
+            if (settings.lockMemory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0 && !result)
+                result = std::error_code(errno, std::system_category());
+#endif
+
+            if (settings.stackPrefaultSize)
+                prefaultStack(settings.stackPrefaultSize);
+
+            return result;
+        }
+
+        // Touches every page so that the first callback does not fault
+        static void prefault(void* data, std::size_t size) noexcept
+        {
+            auto bytes = static_cast<volatile std::uint8_t*>(data);
+            const auto pageSize = getPageSize();
+            for (std::size_t offset = 0; offset < size; offset += pageSize)
+                bytes[offset] = bytes[offset];
+        }
+
+        static void prefaultStack(std::size_t size) noexcept
+        {
+            constexpr std::size_t chunkSize = 4096;
+            volatile std::uint8_t chunk[chunkSize];
+            std::memset(const_cast<std::uint8_t*>(chunk), 0, chunkSize);
+
+            // recurse to grow the stack one chunk at a time, the access
+            // after the call keeps it from being turned into a loop
+            if (size > chunkSize)
+                prefaultStack(size - chunkSize);
+            chunk[0] = chunk[0];
+        }
+
+        static std::size_t getPageSize() noexcept
+        {
+#if defined(_WIN32)
+            SYSTEM_INFO systemInfo;
+            GetSystemInfo(&systemInfo);
+            return systemInfo.dwPageSize;
+#else
+            static const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            return pageSize;
+#endif
+        }
+
+    private:
+        std::error_code error;
+        std::thread thread;
+    };
+}
+
+#endif // RENDERTHREAD_HPP
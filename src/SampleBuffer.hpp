@@ -0,0 +1,225 @@
+#ifndef SAMPLEBUFFER_HPP
+#define SAMPLEBUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#  include <sys/mman.h>
+#endif
+
+namespace pcmplayer
+{
+    // the alignment of every sample buffer, a cache line and an AVX-512 register
+    constexpr std::size_t sampleAlignment = 64;
+
+    enum class HugePages
+    {
+        none,
+        transparent, // madvise(MADV_HUGEPAGE), the kernel may back the buffer with huge pages
+        explicitPages // MAP_HUGETLB from the reserved pool, transparent if it is exhausted
+    };
+
+    // How the memory of the sample buffers is allocated, must be set before
+    // the first buffer is allocated
+    struct SampleAllocatorSettings final
+    {
+        HugePages hugePages = HugePages::transparent; // only on Linux
+        std::size_t hugePageThreshold = 2 * 1024 * 1024; // in bytes, the smaller buffers are on the heap
+
+        // replaces the heap and the huge pages, e.g. with a pool or locked memory,
+        // must return memory aligned to the given alignment
+        void* (*allocate)(std::size_t size, std::size_t alignment) = nullptr;
+        void (*deallocate)(void* pointer, std::size_t size, std::size_t alignment) = nullptr;
+    };
+
+    namespace detail
+    {
+        inline SampleAllocatorSettings& getSampleAllocatorSettings() noexcept
+        {
+            static SampleAllocatorSettings settings;
+            return settings;
+        }
+
+        // precedes every heap and custom allocation, so it is freed the way
+        // it was allocated
+        struct alignas(sampleAlignment) AllocationHeader final
+        {
+            std::size_t size; // of the whole allocation
+            void* base;
+            void (*deallocate)(void*, std::size_t, std::size_t); // nullptr for the heap
+        };
+
+#if defined(__linux__)
+        constexpr std::size_t hugePageSize = 2 * 1024 * 1024;
+
+        // The mapped allocations have their header out of band, so that they
+        // are rounded to huge pages without it. They are large, so there are few.
+        struct MappedAllocations final
+        {
+            std::mutex mutex;
+            std::vector<std::pair<void*, std::size_t>> allocations; // the start and the mapped size
+        };
+
+        inline MappedAllocations& getMappedAllocations() noexcept
+        {
+            static MappedAllocations mappedAllocations;
+            return mappedAllocations;
+        }
+
+        // returns false if the pointer was not mapped
+        inline bool unmapHugePages(void* pointer) noexcept
+        {
+            auto& mappedAllocations = getMappedAllocations();
+            std::size_t mappedSize = 0;
+            {
+                std::lock_guard<std::mutex> lock(mappedAllocations.mutex);
+                auto& allocations = mappedAllocations.allocations;
+                for (auto i = allocations.begin(); i != allocations.end(); ++i)
+                    if (i->first == pointer)
+                    {
+                        mappedSize = i->second;
+                        *i = allocations.back();
+                        allocations.pop_back();
+                        break;
+                    }
+            }
+
+            if (!mappedSize) return false;
+            munmap(pointer, mappedSize);
+            return true;
+        }
+
+        // returns nullptr on failure
+        inline void* mapHugePages(std::size_t size, HugePages hugePages, void*& base, std::size_t& mappedSize) noexcept
+        {
+            mappedSize = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+
+#  if defined(MAP_HUGETLB)
+            if (hugePages == HugePages::explicitPages)
+            {
+                base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (base != MAP_FAILED) return base;
+            }
+#  endif
+
+            // over-mapped by a huge page to align the start to one
+            const auto overSize = mappedSize + hugePageSize;
+            const auto mapping = mmap(nullptr, overSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapping == MAP_FAILED) return nullptr;
+
+            const auto address = reinterpret_cast<std::uintptr_t>(mapping);
+            const auto aligned = (address + hugePageSize - 1) / hugePageSize * hugePageSize;
+            if (aligned != address) munmap(mapping, aligned - address);
+            if (aligned + mappedSize != address + overSize)
+                munmap(reinterpret_cast<void*>(aligned + mappedSize), address + overSize - aligned - mappedSize);
+
+            base = reinterpret_cast<void*>(aligned);
+#  if defined(MADV_HUGEPAGE)
+            madvise(base, mappedSize, MADV_HUGEPAGE); // only a hint
+#  endif
+            return base;
+        }
+#endif
+
+        inline void* allocateSamples(std::size_t size)
+        {
+            const auto& settings = getSampleAllocatorSettings();
+            const auto total = size + sizeof(AllocationHeader);
+            AllocationHeader header{total, nullptr, nullptr};
+
+            if (settings.allocate && settings.deallocate)
+            {
+                header.deallocate = settings.deallocate;
+                header.base = settings.allocate(total, sampleAlignment);
+                if (!header.base) throw std::bad_alloc();
+            }
+#if defined(__linux__)
+            else if (settings.hugePages != HugePages::none && size >= settings.hugePageThreshold)
+            {
+                void* base;
+                std::size_t mappedSize;
+                if (!mapHugePages(size, settings.hugePages, base, mappedSize))
+                    throw std::bad_alloc();
+
+                try
+                {
+                    auto& mappedAllocations = getMappedAllocations();
+                    std::lock_guard<std::mutex> lock(mappedAllocations.mutex);
+                    mappedAllocations.allocations.emplace_back(base, mappedSize);
+                }
+                catch (...)
+                {
+                    munmap(base, mappedSize);
+                    throw;
+                }
+
+                return base;
+            }
+#endif
+            else
+                header.base = ::operator new(total, std::align_val_t{sampleAlignment});
+
+            const auto result = static_cast<AllocationHeader*>(header.base);
+            *result = header;
+            return result + 1;
+        }
+
+        inline void deallocateSamples(void* pointer) noexcept
+        {
+#if defined(__linux__)
+            // only the mapped allocations start at a huge page for sure
+            if (reinterpret_cast<std::uintptr_t>(pointer) % hugePageSize == 0 && unmapHugePages(pointer))
+                return;
+#endif
+
+            const auto header = *(static_cast<AllocationHeader*>(pointer) - 1);
+
+            if (header.deallocate)
+                header.deallocate(header.base, header.size, sampleAlignment);
+            else
+                ::operator delete(header.base, std::align_val_t{sampleAlignment});
+        }
+    }
+
+    inline void setSampleAllocatorSettings(const SampleAllocatorSettings& settings) noexcept
+    {
+        detail::getSampleAllocatorSettings() = settings;
+    }
+
+    // Allocates the storage aligned to sampleAlignment, the large buffers
+    // on huge pages where available
+    template <class T>
+    class SampleAllocator
+    {
+    public:
+        using value_type = T;
+
+        SampleAllocator() noexcept = default;
+        template <class U> SampleAllocator(const SampleAllocator<U>&) noexcept {}
+
+        T* allocate(std::size_t count)
+        {
+            return static_cast<T*>(detail::allocateSamples(count * sizeof(T)));
+        }
+
+        void deallocate(T* pointer, std::size_t) noexcept
+        {
+            detail::deallocateSamples(pointer);
+        }
+
+        template <class U> bool operator==(const SampleAllocator<U>&) const noexcept { return true; }
+        template <class U> bool operator!=(const SampleAllocator<U>&) const noexcept { return false; }
+    };
+
+    // interleaved float samples
+    using SampleBuffer = std::vector<float, SampleAllocator<float>>;
+
+    // samples in a device or file format
+    using ByteBuffer = std::vector<std::uint8_t, SampleAllocator<std::uint8_t>>;
+}
+
+#endif // SAMPLEBUFFER_HPP
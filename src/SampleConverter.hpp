@@ -0,0 +1,214 @@
+#ifndef SAMPLECONVERTER_HPP
+#define SAMPLECONVERTER_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "SampleFormat.hpp"
+#include "Simd.hpp"
+
+namespace pcmplayer
+{
+    // Triangular PDF dither, one xorshift generator per SIMD lane
+    class Dither final
+    {
+    public:
+        bool isEnabled() const noexcept { return enabled; }
+        void setEnabled(bool newEnabled) noexcept { enabled = newEnabled; }
+
+        // returns noise in the range (-1, 1) LSB
+        float next() noexcept
+        {
+            const auto a = static_cast<float>(step(state[0]) >> 8) / 16777216.0F;
+            const auto b = static_cast<float>(step(state[0]) >> 8) / 16777216.0F;
+            return a - b;
+        }
+
+        std::uint32_t state[4] = {0x9E3779B9U, 0x243F6A88U, 0xB7E15162U, 0x6A09E667U};
+
+    private:
+        static std::uint32_t step(std::uint32_t& value) noexcept
+        {
+            value ^= value << 13;
+            value ^= value >> 17;
+            value ^= value << 5;
+            return value;
+        }
+
+        bool enabled = false;
+    };
+
+    namespace detail
+    {
+        template <class T>
+        void convertToInteger(const float* source, T* destination, std::size_t count,
+                              float scale, float minValue, float maxValue,
+                              Dither* dither) noexcept
+        {
+            std::size_t i = 0;
+            const bool dithered = dither && dither->isEnabled();
+
+#if defined(PCMPLAYER_SSE2)
+            const auto scaleVector = _mm_set1_ps(scale);
+            const auto minVector = _mm_set1_ps(minValue);
+            const auto maxVector = _mm_set1_ps(maxValue);
+            const auto noiseScale = _mm_set1_ps(1.0F / 16777216.0F);
+            auto state = dithered ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither->state)) : _mm_setzero_si128();
+
+            const auto nextNoise = [&state, noiseScale]() noexcept {
+                state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+                state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+                state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+                return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), noiseScale);
+            };
+
+            for (; i + 4 <= count; i += 4)
+            {
+                auto value = _mm_mul_ps(_mm_loadu_ps(source + i), scaleVector);
+                if (dithered)
+                {
+                    const auto a = nextNoise();
+                    const auto b = nextNoise();
+                    value = _mm_add_ps(value, _mm_sub_ps(a, b));
+                }
+                value = _mm_max_ps(_mm_min_ps(value, maxVector), minVector);
+                const auto integer = _mm_cvtps_epi32(value);
+
+                if constexpr (sizeof(T) == sizeof(std::int16_t))
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i), _mm_packs_epi32(integer, integer));
+                else
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), integer);
+            }
+
+            if (dithered)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dither->state), state);
+#elif defined(PCMPLAYER_NEON)
+            const auto scaleVector = vdupq_n_f32(scale);
+            const auto minVector = vdupq_n_f32(minValue);
+            const auto maxVector = vdupq_n_f32(maxValue);
+            auto state = dithered ? vld1q_u32(dither->state) : vdupq_n_u32(0);
+
+            const auto nextNoise = [&state]() noexcept {
+                state = veorq_u32(state, vshlq_n_u32(state, 13));
+                state = veorq_u32(state, vshrq_n_u32(state, 17));
+                state = veorq_u32(state, vshlq_n_u32(state, 5));
+                return vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(state, 8)), 1.0F / 16777216.0F);
+            };
+
+            for (; i + 4 <= count; i += 4)
+            {
+                auto value = vmulq_f32(vld1q_f32(source + i), scaleVector);
+                if (dithered)
+                {
+                    const auto a = nextNoise();
+                    const auto b = nextNoise();
+                    value = vaddq_f32(value, vsubq_f32(a, b));
+                }
+                value = vmaxq_f32(vminq_f32(value, maxVector), minVector);
+#  if defined(__aarch64__) || defined(_M_ARM64)
+                const auto integer = vcvtnq_s32_f32(value);
+#  else
+                const auto half = vbslq_f32(vcltq_f32(value, vdupq_n_f32(0.0F)), vdupq_n_f32(-0.5F), vdupq_n_f32(0.5F));
+                const auto integer = vcvtq_s32_f32(vaddq_f32(value, half));
+#  endif
+
+                if constexpr (sizeof(T) == sizeof(std::int16_t))
+                    vst1_s16(destination + i, vqmovn_s32(integer));
+                else
+                    vst1q_s32(destination + i, integer);
+            }
+
+            if (dithered)
+                vst1q_u32(dither->state, state);
+#endif
+
+            for (; i < count; ++i)
+            {
+                auto value = source[i] * scale;
+                if (dithered) value += dither->next();
+                value = value > maxValue ? maxValue : value < minValue ? minValue : value;
+                destination[i] = static_cast<T>(std::lrint(value));
+            }
+        }
+    }
+
+    // Converts interleaved float samples to the device sample format
+    inline void convert(const float* source,
+                        void* destination,
+                        std::size_t count,
+                        SampleFormat sampleFormat,
+                        Dither* dither = nullptr) noexcept
+    {
+        switch (sampleFormat)
+        {
+            case SampleFormat::unsignedInt8:
+            {
+                auto output = static_cast<std::uint8_t*>(destination);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    auto value = (source[i] + 1.0F) * 127.5F;
+                    if (dither && dither->isEnabled()) value += dither->next();
+                    value = value > 255.0F ? 255.0F : value < 0.0F ? 0.0F : value;
+                    output[i] = static_cast<std::uint8_t>(std::lrint(value));
+                }
+                break;
+            }
+            case SampleFormat::signedInt24:
+            {
+                // convert in blocks to 32-bit containers and pack them
+                constexpr std::size_t blockSize = 64;
+                std::int32_t block[blockSize];
+                auto output = static_cast<std::uint8_t*>(destination);
+
+                for (std::size_t offset = 0; offset < count; offset += blockSize)
+                {
+                    const auto blockCount = count - offset < blockSize ? count - offset : blockSize;
+                    detail::convertToInteger(source + offset, block, blockCount,
+                                             8388607.0F, -8388608.0F, 8388607.0F, dither);
+
+                    // in the native byte order like the other integer formats
+                    for (std::size_t i = 0; i < blockCount; ++i)
+                    {
+                        const auto value = static_cast<std::uint32_t>(block[i]);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                        output[(offset + i) * 3 + 0] = static_cast<std::uint8_t>(value >> 16);
+                        output[(offset + i) * 3 + 1] = static_cast<std::uint8_t>(value >> 8);
+                        output[(offset + i) * 3 + 2] = static_cast<std::uint8_t>(value);
+#else
+                        output[(offset + i) * 3 + 0] = static_cast<std::uint8_t>(value);
+                        output[(offset + i) * 3 + 1] = static_cast<std::uint8_t>(value >> 8);
+                        output[(offset + i) * 3 + 2] = static_cast<std::uint8_t>(value >> 16);
+#endif
+                    }
+                }
+                break;
+            }
+            case SampleFormat::signedInt16:
+                detail::convertToInteger(source, static_cast<std::int16_t*>(destination), count,
+                                         32767.0F, -32768.0F, 32767.0F, dither);
+                break;
+            case SampleFormat::signedInt24In32:
+                detail::convertToInteger(source, static_cast<std::int32_t*>(destination), count,
+                                         8388607.0F, -8388608.0F, 8388607.0F, dither);
+                break;
+            case SampleFormat::signedInt32:
+                // 2147483520 is the largest float below 2^31
+                detail::convertToInteger(source, static_cast<std::int32_t*>(destination), count,
+                                         2147483647.0F, -2147483648.0F, 2147483520.0F, nullptr);
+                break;
+            case SampleFormat::float32:
+                if (source != destination)
+                    std::memcpy(destination, source, count * sizeof(float));
+                break;
+            case SampleFormat::float64:
+            {
+                auto output = static_cast<double*>(destination);
+                for (std::size_t i = 0; i < count; ++i)
+                    output[i] = static_cast<double>(source[i]);
+                break;
+            }
+        }
+    }
+}
+
+#endif // SAMPLECONVERTER_HPP
@@ -1,13 +1,100 @@
 #ifndef SAMPLEFORMAT_HPP
 #define SAMPLEFORMAT_HPP
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
 namespace pcmplayer
 {
     enum class SampleFormat
     {
+        unsignedInt8,
         signedInt16,
-        float32
+        signedInt24, // packed, 3 bytes per sample in the native byte order
+        signedInt24In32, // sign-extended 24-bit sample in a 32-bit container
+        signedInt32,
+        float32,
+        float64
+    };
+
+    constexpr std::array<SampleFormat, 7> sampleFormats = {
+        SampleFormat::unsignedInt8,
+        SampleFormat::signedInt16,
+        SampleFormat::signedInt24,
+        SampleFormat::signedInt24In32,
+        SampleFormat::signedInt32,
+        SampleFormat::float32,
+        SampleFormat::float64
     };
+
+    constexpr std::uint32_t getSampleSize(SampleFormat sampleFormat) noexcept
+    {
+        switch (sampleFormat)
+        {
+            case SampleFormat::unsignedInt8: return sizeof(std::uint8_t);
+            case SampleFormat::signedInt16: return sizeof(std::int16_t);
+            case SampleFormat::signedInt24: return 3;
+            case SampleFormat::signedInt24In32: return sizeof(std::int32_t);
+            case SampleFormat::signedInt32: return sizeof(std::int32_t);
+            case SampleFormat::float32: return sizeof(float);
+            case SampleFormat::float64: return sizeof(double);
+        }
+
+        return 0;
+    }
+
+    // number of significant bits, including the sign
+    constexpr std::uint32_t getPrecision(SampleFormat sampleFormat) noexcept
+    {
+        switch (sampleFormat)
+        {
+            case SampleFormat::unsignedInt8: return 8;
+            case SampleFormat::signedInt16: return 16;
+            case SampleFormat::signedInt24: return 24;
+            case SampleFormat::signedInt24In32: return 24;
+            case SampleFormat::signedInt32: return 32;
+            case SampleFormat::float32: return 25;
+            case SampleFormat::float64: return 54;
+        }
+
+        return 0;
+    }
+
+    constexpr bool isFloatingPoint(SampleFormat sampleFormat) noexcept
+    {
+        return sampleFormat == SampleFormat::float32 || sampleFormat == SampleFormat::float64;
+    }
+
+    // true if every value of the source format can be represented exactly
+    constexpr bool isLossless(SampleFormat source, SampleFormat destination) noexcept
+    {
+        if (isFloatingPoint(source))
+            return isFloatingPoint(destination) && getPrecision(destination) >= getPrecision(source);
+        else
+            return getPrecision(destination) >= getPrecision(source);
+    }
+
+    // All sample formats ordered by how well they preserve the source format:
+    // the source format itself, then the lossless formats from the smallest
+    // to the largest and then the lossy formats from the most precise one
+    inline std::array<SampleFormat, sampleFormats.size()> getPreferredSampleFormats(SampleFormat source)
+    {
+        auto result = sampleFormats;
+
+        const auto rank = [source](SampleFormat sampleFormat) noexcept {
+            if (sampleFormat == source) return 0;
+            if (isLossless(source, sampleFormat))
+                return 1 + static_cast<int>(getPrecision(sampleFormat));
+            return 1000 - static_cast<int>(getPrecision(sampleFormat));
+        };
+
+        std::stable_sort(result.begin(), result.end(), [&rank](SampleFormat a, SampleFormat b) noexcept {
+            return rank(a) < rank(b);
+        });
+
+        return result;
+    }
 }
 
 #endif // SAMPLEFORMAT_HPP
@@ -0,0 +1,275 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include "Trace.hpp"
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <unistd.h>
+#endif
+
+namespace pcmplayer
+{
+#if defined(_WIN32)
+    using WakeupHandle = HANDLE;
+#else
+    using WakeupHandle = pollfd;
+#endif
+
+    // A stream that can be serviced by a Scheduler instead of its own blocking loop
+    class ScheduledStream
+    {
+    public:
+        virtual ~ScheduledStream() = default;
+
+        // starts the device without blocking
+        virtual void startStream() = 0;
+        virtual void stopStream() = 0;
+
+        // Copies the handles to wait for if they fit in the count and returns
+        // the number of them, which must not grow while the stream is scheduled
+        virtual std::size_t getWakeupHandles(WakeupHandle* handles, std::size_t count) = 0;
+
+        // time of the next timed wakeup or time_point::max() if there is none
+        virtual std::chrono::steady_clock::time_point getDeadline() const noexcept
+        {
+            return std::chrono::steady_clock::time_point::max();
+        }
+
+        // Called after one of the handles was signaled or the deadline has
+        // passed, must not block and returns false after the end of the stream
+        virtual bool process(WakeupHandle* handles, std::size_t count) = 0;
+    };
+
+    // Services many streams from the thread that calls run(), wrap it in a
+    // RenderThread to make it real-time. Use several schedulers to spread
+    // the streams over a few threads.
+    class Scheduler final
+    {
+    public:
+        Scheduler()
+        {
+#if defined(_WIN32)
+            wakeupEvent = CreateEvent(nullptr, false, false, nullptr);
+            if (!wakeupEvent)
+                throw std::system_error(GetLastError(), std::system_category(), "Failed to create event");
+#else
+            if (pipe(wakeupPipe) != 0)
+                throw std::system_error(errno, std::system_category(), "Failed to create pipe");
+
+            fcntl(wakeupPipe[0], F_SETFL, O_NONBLOCK);
+            fcntl(wakeupPipe[1], F_SETFL, O_NONBLOCK);
+#endif
+        }
+
+        ~Scheduler()
+        {
+#if defined(_WIN32)
+            CloseHandle(wakeupEvent);
+#else
+            close(wakeupPipe[0]);
+            close(wakeupPipe[1]);
+#endif
+        }
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        // must not be called while running
+        void add(ScheduledStream& stream)
+        {
+            const auto handleCount = stream.getWakeupHandles(nullptr, 0);
+
+#if defined(_WIN32)
+            // WaitForMultipleObjects takes at most 64 handles including the wakeup of stop()
+            if (handleCapacity + handleCount + 1 > MAXIMUM_WAIT_OBJECTS)
+                throw std::runtime_error("Too many streams for one Scheduler");
+#endif
+
+            entries.push_back(Entry{&stream, 0, 0, true});
+            handleCapacity += handleCount;
+        }
+
+        // Runs until every stream has ended or stop() has been called
+        void run()
+        {
+            // one more for the wakeup of stop()
+            handles.resize(handleCapacity + 1);
+#if defined(_WIN32)
+            signaled.resize(handleCapacity + 1);
+#endif
+            trace::Tracer::getInstance().prepareThread();
+
+            for (auto& entry : entries)
+            {
+                entry.active = true;
+                entry.stream->startStream();
+            }
+
+            std::size_t activeCount = entries.size();
+
+            while (activeCount && !stopped)
+            {
+                std::size_t count = 0;
+                auto deadline = std::chrono::steady_clock::time_point::max();
+
+                for (auto& entry : entries)
+                {
+                    if (!entry.active) continue;
+
+                    entry.first = count;
+                    entry.count = entry.stream->getWakeupHandles(handles.data() + count, handleCapacity - count);
+                    count += entry.count;
+
+                    const auto streamDeadline = entry.stream->getDeadline();
+                    if (streamDeadline < deadline) deadline = streamDeadline;
+                }
+
+                wait(count, deadline);
+
+                const auto now = std::chrono::steady_clock::now();
+
+                for (auto& entry : entries)
+                {
+                    if (!entry.active || (!isSignaled(entry) && entry.stream->getDeadline() > now))
+                        continue;
+
+                    // a failing device must not take the other streams down
+                    bool alive = false;
+                    try
+                    {
+                        alive = entry.stream->process(handles.data() + entry.first, entry.count);
+                    }
+                    catch (const std::exception&)
+                    {
+                    }
+
+                    if (!alive)
+                    {
+                        entry.active = false;
+                        --activeCount;
+                        entry.stream->stopStream();
+                    }
+                }
+            }
+
+            for (auto& entry : entries)
+                if (entry.active)
+                {
+                    entry.active = false;
+                    entry.stream->stopStream();
+                }
+
+            stopped = false;
+        }
+
+        // can be called from any thread, also before run()
+        void stop() noexcept
+        {
+            stopped = true;
+#if defined(_WIN32)
+            SetEvent(wakeupEvent);
+#else
+            const char value = 0;
+            [[maybe_unused]] const auto result = write(wakeupPipe[1], &value, sizeof(value));
+#endif
+        }
+
+    private:
+        struct Entry final
+        {
+            ScheduledStream* stream;
+            std::size_t first;
+            std::size_t count;
+            bool active;
+        };
+
+        void wait(std::size_t count, std::chrono::steady_clock::time_point deadline)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            int timeout = -1;
+            if (deadline != std::chrono::steady_clock::time_point::max())
+                timeout = deadline <= now ? 0 :
+                    static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count());
+
+#if defined(_WIN32)
+            handles[count] = wakeupEvent;
+            std::fill(signaled.begin(), signaled.end(), false);
+
+            auto result = WaitForMultipleObjects(static_cast<DWORD>(count + 1), handles.data(), FALSE,
+                                                 timeout < 0 ? INFINITE : static_cast<DWORD>(timeout));
+
+            // a wait only reports the lowest signaled handle, so poll the ones after
+            // it as well or a busy stream would starve the streams behind it
+            for (std::size_t first = 0;;)
+            {
+                if (result == WAIT_FAILED)
+                    throw std::system_error(GetLastError(), std::system_category(), "Failed to wait for events");
+
+                if (result - WAIT_OBJECT_0 > count - first)
+                    break; // timed out
+
+                const auto index = first + (result - WAIT_OBJECT_0);
+                signaled[index] = true;
+
+                first = index + 1;
+                if (first > count) break;
+
+                result = WaitForMultipleObjects(static_cast<DWORD>(count + 1 - first), handles.data() + first, FALSE, 0);
+            }
+#else
+            handles[count] = pollfd{wakeupPipe[0], POLLIN, 0};
+
+            while (poll(handles.data(), static_cast<nfds_t>(count + 1), timeout) < 0)
+                if (errno != EINTR)
+                    throw std::system_error(errno, std::system_category(), "Failed to poll");
+
+            if (handles[count].revents & POLLIN)
+            {
+                char buffer[16];
+                while (read(wakeupPipe[0], buffer, sizeof(buffer)) > 0);
+            }
+#endif
+        }
+
+        bool isSignaled(const Entry& entry) const noexcept
+        {
+            for (std::size_t i = entry.first; i < entry.first + entry.count; ++i)
+#if defined(_WIN32)
+                if (signaled[i]) return true;
+#else
+                if (handles[i].revents) return true;
+#endif
+            return false;
+        }
+
+        std::vector<Entry> entries;
+        std::vector<WakeupHandle> handles;
+        std::size_t handleCapacity = 0;
+        std::atomic<bool> stopped{false};
+
+#if defined(_WIN32)
+        HANDLE wakeupEvent = nullptr;
+        std::vector<bool> signaled;
+#else
+        int wakeupPipe[2];
+#endif
+    };
+}
+
+#endif // SCHEDULER_HPP
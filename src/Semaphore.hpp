@@ -0,0 +1,91 @@
+#ifndef SEMAPHORE_HPP
+#define SEMAPHORE_HPP
+
+#include <cerrno>
+#include <climits>
+#include <system_error>
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#elif defined(__APPLE__)
+#  include <dispatch/dispatch.h>
+#else
+#  include <semaphore.h>
+#endif
+
+namespace pcmplayer
+{
+    // A counting semaphore that the render thread can signal without
+    // blocking or taking a lock, to wake the threads that help it
+    class Semaphore final
+    {
+    public:
+        Semaphore()
+        {
+#if defined(_WIN32)
+            semaphore = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+            if (!semaphore)
+                throw std::system_error(GetLastError(), std::system_category(), "Failed to create semaphore");
+#elif defined(__APPLE__)
+            semaphore = dispatch_semaphore_create(0);
+            if (!semaphore)
+                throw std::system_error(ENOMEM, std::system_category(), "Failed to create semaphore");
+#else
+            if (sem_init(&semaphore, 0, 0) != 0)
+                throw std::system_error(errno, std::system_category(), "Failed to create semaphore");
+#endif
+        }
+
+        ~Semaphore()
+        {
+#if defined(_WIN32)
+            CloseHandle(semaphore);
+#elif defined(__APPLE__)
+            dispatch_release(semaphore);
+#else
+            sem_destroy(&semaphore);
+#endif
+        }
+
+        Semaphore(const Semaphore&) = delete;
+        Semaphore& operator=(const Semaphore&) = delete;
+
+        void signal() noexcept
+        {
+#if defined(_WIN32)
+            ReleaseSemaphore(semaphore, 1, nullptr);
+#elif defined(__APPLE__)
+            dispatch_semaphore_signal(semaphore);
+#else
+            sem_post(&semaphore);
+#endif
+        }
+
+        void wait() noexcept
+        {
+#if defined(_WIN32)
+            WaitForSingleObject(semaphore, INFINITE);
+#elif defined(__APPLE__)
+            dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+#else
+            while (sem_wait(&semaphore) != 0 && errno == EINTR);
+#endif
+        }
+
+    private:
+#if defined(_WIN32)
+        HANDLE semaphore = nullptr;
+#elif defined(__APPLE__)
+        dispatch_semaphore_t semaphore = nullptr;
+#else
+        sem_t semaphore;
+#endif
+    };
+}
+
+#endif // SEMAPHORE_HPP
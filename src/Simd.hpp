@@ -0,0 +1,12 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define PCMPLAYER_SSE2 1
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#  define PCMPLAYER_NEON 1
+#  include <arm_neon.h>
+#endif
+
+#endif // SIMD_HPP
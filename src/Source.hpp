@@ -0,0 +1,116 @@
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "SampleBuffer.hpp"
+
+namespace pcmplayer
+{
+    struct RenderThreadSettings;
+
+    // Produces the interleaved float samples that a player renders, read
+    // from the render thread so it must neither block nor allocate
+    class Source
+    {
+    public:
+        virtual ~Source() = default;
+
+        // Writes up to the frames to the output and returns how many were
+        // written, fewer than requested only at the end of the source
+        virtual std::uint32_t read(float* output, std::uint32_t frames) noexcept = 0;
+
+        // true if the end has been reached, lets the player stop without
+        // another read when the data ends exactly at the end of a buffer
+        virtual bool isFinished() const noexcept { return false; }
+
+        // the settings of the player's render thread, for the sources that
+        // render on threads of their own
+        virtual void setRenderThreadSettings(const RenderThreadSettings&) {}
+    };
+
+    // A region of a buffer that is repeated, the end is exclusive like
+    // in Wav::Loop
+    struct Loop final
+    {
+        std::size_t start = 0; // first frame
+        std::size_t end = 0; // frame after the last one, no loop unless it is after the start
+        std::uint32_t playCount = 0; // times the region is played, 0 for indefinitely
+    };
+
+    // Reads the frames from a buffer in contiguous spans and wraps the
+    // offset at the end of the loop, copy(offset, written, count) copies a span
+    template <class Copy>
+    std::uint32_t readLooped(std::size_t& offset, std::size_t bufferFrames, std::uint32_t frames,
+                             const Loop& loop, std::uint32_t& loopsPlayed, Copy copy) noexcept
+    {
+        const bool looping = loop.end > loop.start && loop.end <= bufferFrames;
+        std::uint32_t written = 0;
+
+        while (written < frames)
+        {
+            const bool wrap = looping && offset < loop.end &&
+                (loop.playCount == 0 || loopsPlayed + 1 < loop.playCount);
+            const auto limit = wrap ? loop.end : bufferFrames;
+            const auto count = static_cast<std::uint32_t>(limit - offset < frames - written ? limit - offset : frames - written);
+            if (count == 0) break;
+
+            copy(offset, written, count);
+            offset += count;
+            written += count;
+
+            if (wrap && offset == loop.end)
+            {
+                offset = loop.start;
+                ++loopsPlayed;
+            }
+        }
+
+        return written;
+    }
+
+    class BufferSource final: public Source
+    {
+    public:
+        BufferSource() = default;
+
+        BufferSource(SampleBuffer initSamples, std::uint16_t initChannels):
+            samples{std::move(initSamples)}, channels{initChannels}
+        {
+        }
+
+        // must be set before the playback
+        void setLoop(const Loop& newLoop) noexcept
+        {
+            loop = newLoop;
+            loopsPlayed = 0;
+        }
+
+        std::uint32_t read(float* output, std::uint32_t frames) noexcept final
+        {
+            return readLooped(offset, samples.size() / channels, frames, loop, loopsPlayed,
+                              [this, output](std::size_t first, std::uint32_t written, std::uint32_t count) noexcept {
+                std::copy(samples.begin() + first * channels,
+                          samples.begin() + (first + count) * channels,
+                          output + written * channels);
+            });
+        }
+
+        bool isFinished() const noexcept final
+        {
+            return offset == samples.size() / channels;
+        }
+
+        auto& getSamples() const noexcept { return samples; }
+
+    private:
+        SampleBuffer samples;
+        std::uint16_t channels = 1;
+        std::size_t offset = 0;
+        Loop loop;
+        std::uint32_t loopsPlayed = 0;
+    };
+}
+
+#endif // SOURCE_HPP
@@ -0,0 +1,57 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace pcmplayer
+{
+    // Fixed-size lock-free queue for exactly one producer and one consumer
+    // thread, e.g. to hand objects to the render thread and back
+    template <class T, std::size_t capacity>
+    class SpscQueue final
+    {
+    public:
+        static_assert(capacity > 0, "Invalid capacity");
+
+        // returns false if the queue is full
+        bool push(const T& value) noexcept
+        {
+            const auto currentTail = tail.load(std::memory_order_relaxed);
+            if (currentTail - head.load(std::memory_order_acquire) == capacity)
+                return false;
+
+            values[currentTail % capacity] = value;
+            tail.store(currentTail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // returns false if the queue is empty
+        bool pop(T& value) noexcept
+        {
+            const auto currentHead = head.load(std::memory_order_relaxed);
+            if (currentHead == tail.load(std::memory_order_acquire))
+                return false;
+
+            value = values[currentHead % capacity];
+            head.store(currentHead + 1, std::memory_order_release);
+            return true;
+        }
+
+        // exact only when called from the producer or the consumer thread
+        std::size_t size() const noexcept
+        {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        bool empty() const noexcept { return size() == 0; }
+
+    private:
+        std::array<T, capacity> values{};
+        std::atomic<std::size_t> head{0};
+        std::atomic<std::size_t> tail{0};
+    };
+}
+
+#endif // SPSCQUEUE_HPP
@@ -0,0 +1,167 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace pcmplayer::trace
+{
+    struct Event final
+    {
+        const char* name;
+        char phase;
+        std::uint64_t timestamp; // in nanoseconds since the tracer was created
+    };
+
+    // Written only by its own thread, read by the thread writing the trace
+    class Buffer final
+    {
+    public:
+        static constexpr std::size_t capacity = 65536;
+
+        explicit Buffer(std::uint32_t initThreadId) noexcept:
+            threadId{initThreadId}
+        {
+        }
+
+        void push(const char* name, char phase, std::uint64_t timestamp) noexcept
+        {
+            const auto currentSize = size.load(std::memory_order_relaxed);
+            if (currentSize == capacity)
+            {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+
+            events[currentSize] = Event{name, phase, timestamp};
+            size.store(currentSize + 1, std::memory_order_release);
+        }
+
+        auto getThreadId() const noexcept { return threadId; }
+        auto getSize() const noexcept { return size.load(std::memory_order_acquire); }
+        auto getDropped() const noexcept { return dropped.load(std::memory_order_relaxed); }
+        const Event& operator[](std::size_t index) const noexcept { return events[index]; }
+
+    private:
+        std::uint32_t threadId;
+        std::array<Event, capacity> events;
+        std::atomic<std::size_t> size{0};
+        std::atomic<std::size_t> dropped{0};
+    };
+
+    class Tracer final
+    {
+    public:
+        static Tracer& getInstance()
+        {
+            static Tracer tracer;
+            return tracer;
+        }
+
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        void setEnabled(bool newEnabled) noexcept { enabled.store(newEnabled, std::memory_order_relaxed); }
+        bool isEnabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+
+        // Allocates the buffer of the calling thread if tracing is enabled,
+        // so that the first event in a render callback does not allocate
+        void prepareThread()
+        {
+            if (isEnabled()) getBuffer();
+        }
+
+        void record(const char* name, char phase)
+        {
+            const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+            getBuffer().push(name, phase, static_cast<std::uint64_t>(timestamp));
+        }
+
+        // Chrome trace event format, loadable in chrome://tracing and Perfetto
+        void write(std::ostream& output) const
+        {
+            std::lock_guard lock(buffersMutex);
+
+            output << "{\"traceEvents\":[";
+
+            bool first = true;
+            for (const auto& buffer : buffers)
+            {
+                const auto size = buffer->getSize();
+                for (std::size_t i = 0; i < size; ++i)
+                {
+                    const auto& event = (*buffer)[i];
+                    if (!first) output << ',';
+                    first = false;
+
+                    output << "\n{\"name\":\"" << event.name <<
+                        "\",\"ph\":\"" << event.phase <<
+                        "\",\"ts\":" << event.timestamp / 1000U << '.' << event.timestamp / 100U % 10U <<
+                        ",\"pid\":1,\"tid\":" << buffer->getThreadId() << '}';
+                }
+
+                if (const auto dropped = buffer->getDropped())
+                {
+                    if (!first) output << ',';
+                    first = false;
+
+                    output << "\n{\"name\":\"dropped\",\"ph\":\"C\",\"ts\":0,\"pid\":1,\"tid\":" <<
+                        buffer->getThreadId() << ",\"args\":{\"events\":" << dropped << "}}";
+                }
+            }
+
+            output << "\n]}\n";
+        }
+
+    private:
+        Tracer() = default;
+
+        Buffer& getBuffer()
+        {
+            // the buffer is allocated on the first event of each thread and
+            // is owned by the tracer so that it outlives the thread
+            thread_local Buffer* buffer = nullptr;
+            if (!buffer)
+            {
+                std::lock_guard lock(buffersMutex);
+                buffers.push_back(std::make_unique<Buffer>(static_cast<std::uint32_t>(buffers.size() + 1)));
+                buffer = buffers.back().get();
+            }
+            return *buffer;
+        }
+
+        std::atomic<bool> enabled{false};
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        mutable std::mutex buffersMutex;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+    };
+
+    class Scope final
+    {
+    public:
+        explicit Scope(const char* initName):
+            name{Tracer::getInstance().isEnabled() ? initName : nullptr}
+        {
+            if (name) Tracer::getInstance().record(name, 'B');
+        }
+
+        ~Scope()
+        {
+            if (name) Tracer::getInstance().record(name, 'E');
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+    };
+}
+
+#endif // TRACE_HPP
@@ -1,23 +1,61 @@
 #ifndef Wav_h
 #define Wav_h
 
+#include <cstdint>
+#include <cstring>
 #include <istream>
 #include <ostream>
 #include <stdexcept>
 #include <vector>
+#include "SampleBuffer.hpp"
+#include "SampleFormat.hpp"
+#include "Trace.hpp"
 
 namespace
 {
     constexpr std::uint16_t WAVE_FORMAT_PCM = 1;
     constexpr std::uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+
+    inline std::uint32_t decodeUInt32(const std::uint8_t* buffer) noexcept
+    {
+        return static_cast<std::uint32_t>(buffer[0]) |
+            (static_cast<std::uint32_t>(buffer[1]) << 8) |
+            (static_cast<std::uint32_t>(buffer[2]) << 16) |
+            (static_cast<std::uint32_t>(buffer[3]) << 24);
+    }
 }
 
 class Wav final
 {
 public:
+    // A loop of the smpl chunk, converted to the end-exclusive range of
+    // pcmplayer::Loop (the chunk stores the last frame of the loop)
+    struct Loop final
+    {
+        enum class Type: std::uint32_t
+        {
+            forward = 0,
+            alternating = 1,
+            backward = 2
+        };
+
+        std::uint32_t cuePointId = 0;
+        Type type = Type::forward;
+        std::uint64_t start = 0; // first frame
+        std::uint64_t end = 0; // frame after the last one
+        std::uint32_t playCount = 0; // 0 for an infinite loop
+    };
+
+    // a cue point of the cue chunk
+    struct CuePoint final
+    {
+        std::uint32_t id = 0;
+        std::uint32_t frame = 0;
+    };
+
     Wav() = default;
 
-    Wav(std::uint16_t c, std::uint32_t sr, std::uint32_t f, const std::vector<float>& s):
+    Wav(std::uint16_t c, std::uint32_t sr, std::uint32_t f, const pcmplayer::SampleBuffer& s):
         channels{c}, sampleRate{sr}, frames{f}, samples{s}
     {
         if (channels < 1)
@@ -28,8 +66,11 @@ public:
             throw std::runtime_error("Invalid sample count");
     }
 
-    Wav(std::istream& input)
+    // the raw data chunk is only kept for bit-exact playback
+    Wav(std::istream& input, bool keepData = false)
     {
+        pcmplayer::trace::Scope parseScope("Wav::parse");
+
         char riffHeader[4];
         input.read(riffHeader, sizeof(riffHeader));
 
@@ -141,8 +182,13 @@ public:
                      chunkHeader[2] == 't' &&
                      chunkHeader[3] == 'a')
             {
-                std::vector<char> chunkBuffer(chunkSize);
-                input.read(chunkBuffer.data(), chunkSize);
+                pcmplayer::ByteBuffer chunkBuffer(chunkSize);
+                {
+                    pcmplayer::trace::Scope readScope("Wav::read");
+                    input.read(reinterpret_cast<char*>(chunkBuffer.data()), chunkSize);
+                }
+
+                pcmplayer::trace::Scope convertScope("Wav::convert");
 
                 const auto sampleCount = static_cast<std::uint32_t>(chunkBuffer.size() / (bitsPerSample / 8));
                 frames = sampleCount / channels;
@@ -165,6 +211,7 @@ public:
                                     outputFrame[channel] = 2.0F * value / 255.0F - 1.0F;
                                 }
                             }
+                            sampleFormat = pcmplayer::SampleFormat::unsignedInt8;
                             break;
                         }
                         case 16:
@@ -181,6 +228,7 @@ public:
                                     outputFrame[channel] = static_cast<float>(value) / 32767.0F;
                                 }
                             }
+                            sampleFormat = pcmplayer::SampleFormat::signedInt16;
                             break;
                         }
                         case 24:
@@ -204,6 +252,7 @@ public:
                                     outputFrame[channel] = static_cast<float>(value / 8388607.0);
                                 }
                             }
+                            sampleFormat = pcmplayer::SampleFormat::signedInt24;
                             break;
                         }
                         case 32:
@@ -222,6 +271,7 @@ public:
                                     outputFrame[channel] = static_cast<float>(value / 2147483647.0);
                                 }
                             }
+                            sampleFormat = pcmplayer::SampleFormat::signedInt32;
                             break;
                         }
                         default:
@@ -244,14 +294,93 @@ public:
                                 outputFrame[channel] = value;
                             }
                         }
+                        sampleFormat = pcmplayer::SampleFormat::float32;
+                    }
+                    else if (bitsPerSample == 64)
+                    {
+                        for (std::uint32_t frame = 0; frame < frames; ++frame)
+                        {
+                            float* outputFrame = &samples[frame * channels];
+
+                            for (std::uint32_t channel = 0; channel < channels; ++channel)
+                            {
+                                const auto* sourceData = &chunkBuffer[(frame * channels + channel) * 8];
+                                double value;
+                                std::memcpy(&value, sourceData, sizeof(double));
+                                outputFrame[channel] = static_cast<float>(value);
+                            }
+                        }
+                        sampleFormat = pcmplayer::SampleFormat::float64;
                     }
                     else
                         throw std::runtime_error("Failed to load sound file, unsupported bit depth");
                 }
 
+                // keep the original samples for bit-exact playback
+                if (keepData) data = std::move(chunkBuffer);
+
                 input.seekg(chunkSize, std::ios::cur); // skip the data
                 offset += chunkSize;
             }
+            else if (chunkHeader[0] == 's' &&
+                     chunkHeader[1] == 'm' &&
+                     chunkHeader[2] == 'p' &&
+                     chunkHeader[3] == 'l')
+            {
+                constexpr std::size_t headerSize = 36;
+                constexpr std::size_t loopSize = 24;
+
+                std::vector<std::uint8_t> chunkBuffer(chunkSize);
+                input.read(reinterpret_cast<char*>(chunkBuffer.data()), chunkSize);
+
+                if (chunkSize >= headerSize)
+                {
+                    const auto loopCount = decodeUInt32(&chunkBuffer[28]);
+
+                    for (std::size_t i = 0; i < loopCount && headerSize + (i + 1) * loopSize <= chunkSize; ++i)
+                    {
+                        const auto* loopData = &chunkBuffer[headerSize + i * loopSize];
+
+                        Loop loop;
+                        loop.cuePointId = decodeUInt32(loopData);
+                        loop.type = static_cast<Loop::Type>(decodeUInt32(loopData + 4));
+                        loop.start = decodeUInt32(loopData + 8);
+                        loop.end = std::uint64_t(decodeUInt32(loopData + 12)) + 1;
+                        loop.playCount = decodeUInt32(loopData + 20); // after the fraction
+                        loops.push_back(loop);
+                    }
+                }
+
+                offset += chunkSize;
+            }
+            else if (chunkHeader[0] == 'c' &&
+                     chunkHeader[1] == 'u' &&
+                     chunkHeader[2] == 'e' &&
+                     chunkHeader[3] == ' ')
+            {
+                constexpr std::size_t cuePointSize = 24;
+
+                std::vector<std::uint8_t> chunkBuffer(chunkSize);
+                input.read(reinterpret_cast<char*>(chunkBuffer.data()), chunkSize);
+
+                if (chunkSize >= 4)
+                {
+                    const auto cuePointCount = decodeUInt32(chunkBuffer.data());
+
+                    for (std::size_t i = 0; i < cuePointCount && 4 + (i + 1) * cuePointSize <= chunkSize; ++i)
+                    {
+                        const auto* cuePointData = &chunkBuffer[4 + i * cuePointSize];
+
+                        // the sample offset in the data chunk, the position is in the playlist order
+                        CuePoint cuePoint;
+                        cuePoint.id = decodeUInt32(cuePointData);
+                        cuePoint.frame = decodeUInt32(cuePointData + 20);
+                        cuePoints.push_back(cuePoint);
+                    }
+                }
+
+                offset += chunkSize;
+            }
             else
             {
                 input.seekg(chunkSize, std::ios::cur); // skip the chunk
@@ -266,67 +395,13 @@ public:
 
     void save(std::ostream& output)
     {
-        const std::size_t sampleSize = sizeof(float);
-
-        char riffHeader[] = {'R', 'I', 'F', 'F'};
+        pcmplayer::trace::Scope saveScope("Wav::save");
 
-        const std::uint32_t waveHeaderSize = 4;
-        const std::uint32_t chunkHeaderSize = 4;
-        const std::uint32_t fmtChunkSize = 16;
+        const std::size_t sampleSize = sizeof(float);
         const std::uint16_t formatTag = WAVE_FORMAT_IEEE_FLOAT;
-        const auto byteRate = static_cast<std::uint32_t>(sampleSize * channels * sampleRate);
-        const std::uint16_t byteAlign = sampleSize * channels;
         const std::uint16_t bitsPerSample = sampleSize * 8;
         const auto dataChunkSize = static_cast<std::uint32_t>(samples.size() * sampleSize);
 
-        const std::uint32_t dataLength = waveHeaderSize +
-            chunkHeaderSize +
-            fmtChunkSize +
-            chunkHeaderSize +
-            dataChunkSize;
-
-        const char dataLengthBuffer[] = {static_cast<char>(dataLength),
-            static_cast<char>(dataLength >> 8),
-            static_cast<char>(dataLength >> 16),
-            static_cast<char>(dataLength >> 24)
-        };
-        const char waveHeader[] = {'W', 'A', 'V', 'E'};
-
-        const char fmtChunkHeader[] = {'f', 'm', 't', ' '};
-        const char fmtChunkSizeBuffer[] = {static_cast<char>(fmtChunkSize),
-            static_cast<char>(fmtChunkSize >> 8),
-            static_cast<char>(fmtChunkSize >> 16),
-            static_cast<char>(fmtChunkSize >> 24)
-        };
-        const char formatTagBuffer[] = {static_cast<char>(formatTag),
-            static_cast<char>(formatTag >> 8)
-        };
-        const char channelsBuffer[] = {static_cast<char>(channels),
-            static_cast<char>(channels >> 8)
-        };
-        const char sampleRateBuffer[] = {static_cast<char>(sampleRate),
-            static_cast<char>(sampleRate >> 8),
-            static_cast<char>(sampleRate >> 16),
-            static_cast<char>(sampleRate >> 24)
-        };
-        const char byteRateBuffer[] = {static_cast<char>(byteRate),
-            static_cast<char>(byteRate >> 8),
-            static_cast<char>(byteRate >> 16),
-            static_cast<char>(byteRate >> 24)
-        };
-        const char byteAlignBuffer[] = {static_cast<char>(byteAlign),
-            static_cast<char>(byteAlign >> 8)
-        };
-        const char bitsPerSampleBuffer[] = {static_cast<char>(bitsPerSample),
-            static_cast<char>(bitsPerSample >> 8)
-        };
-
-        const char dataChunkHeader[] = {'d', 'a', 't', 'a'};
-        const char dataChunkSizeBuffer[] = {static_cast<char>(dataChunkSize),
-            static_cast<char>(dataChunkSize >> 8),
-            static_cast<char>(dataChunkSize >> 16),
-            static_cast<char>(dataChunkSize >> 24)
-        };
         std::vector<char> dataChunkBuffer(dataChunkSize);
 
         if (formatTag == WAVE_FORMAT_PCM)
@@ -428,6 +503,78 @@ public:
                 throw std::runtime_error("Failed to load sound file, unsupported bit depth");
         }
 
+        pcmplayer::trace::Scope writeScope("Wav::write");
+
+        writeHeader(output, formatTag, channels, sampleRate, bitsPerSample, dataChunkSize);
+        output.write(dataChunkBuffer.data(), dataChunkBuffer.size());
+    }
+
+    // Writes the RIFF header, the fmt chunk and the header of the data chunk
+    static void writeHeader(std::ostream& output,
+                            std::uint16_t formatTag,
+                            std::uint16_t channels,
+                            std::uint32_t sampleRate,
+                            std::uint16_t bitsPerSample,
+                            std::uint32_t dataChunkSize)
+    {
+        char riffHeader[] = {'R', 'I', 'F', 'F'};
+
+        const std::uint32_t waveHeaderSize = 4;
+        const std::uint32_t chunkHeaderSize = 4;
+        const std::uint32_t fmtChunkSize = 16;
+        const std::uint32_t chunkSizeSize = 4;
+        const auto byteRate = static_cast<std::uint32_t>(bitsPerSample / 8 * channels * sampleRate);
+        const auto byteAlign = static_cast<std::uint16_t>(bitsPerSample / 8 * channels);
+
+        const std::uint32_t dataLength = waveHeaderSize +
+            chunkHeaderSize + chunkSizeSize +
+            fmtChunkSize +
+            chunkHeaderSize + chunkSizeSize +
+            dataChunkSize + (dataChunkSize % 2); // with the pad byte
+
+        const char dataLengthBuffer[] = {static_cast<char>(dataLength),
+            static_cast<char>(dataLength >> 8),
+            static_cast<char>(dataLength >> 16),
+            static_cast<char>(dataLength >> 24)
+        };
+        const char waveHeader[] = {'W', 'A', 'V', 'E'};
+
+        const char fmtChunkHeader[] = {'f', 'm', 't', ' '};
+        const char fmtChunkSizeBuffer[] = {static_cast<char>(fmtChunkSize),
+            static_cast<char>(fmtChunkSize >> 8),
+            static_cast<char>(fmtChunkSize >> 16),
+            static_cast<char>(fmtChunkSize >> 24)
+        };
+        const char formatTagBuffer[] = {static_cast<char>(formatTag),
+            static_cast<char>(formatTag >> 8)
+        };
+        const char channelsBuffer[] = {static_cast<char>(channels),
+            static_cast<char>(channels >> 8)
+        };
+        const char sampleRateBuffer[] = {static_cast<char>(sampleRate),
+            static_cast<char>(sampleRate >> 8),
+            static_cast<char>(sampleRate >> 16),
+            static_cast<char>(sampleRate >> 24)
+        };
+        const char byteRateBuffer[] = {static_cast<char>(byteRate),
+            static_cast<char>(byteRate >> 8),
+            static_cast<char>(byteRate >> 16),
+            static_cast<char>(byteRate >> 24)
+        };
+        const char byteAlignBuffer[] = {static_cast<char>(byteAlign),
+            static_cast<char>(byteAlign >> 8)
+        };
+        const char bitsPerSampleBuffer[] = {static_cast<char>(bitsPerSample),
+            static_cast<char>(bitsPerSample >> 8)
+        };
+
+        const char dataChunkHeader[] = {'d', 'a', 't', 'a'};
+        const char dataChunkSizeBuffer[] = {static_cast<char>(dataChunkSize),
+            static_cast<char>(dataChunkSize >> 8),
+            static_cast<char>(dataChunkSize >> 16),
+            static_cast<char>(dataChunkSize >> 24)
+        };
+
         output.write(riffHeader, sizeof(riffHeader));
         output.write(dataLengthBuffer, sizeof(dataLengthBuffer));
         output.write(waveHeader, sizeof(waveHeader));
@@ -445,19 +592,30 @@ public:
         // data chunk
         output.write(dataChunkHeader, sizeof(dataChunkHeader));
         output.write(dataChunkSizeBuffer, sizeof(dataChunkSizeBuffer));
-        output.write(dataChunkBuffer.data(), dataChunkBuffer.size());
     }
 
     auto& getChannels() const noexcept { return channels; }
     auto& getSampleRate() const noexcept { return sampleRate; }
     auto& getFrames() const noexcept { return frames; }
     auto& getSamples() const noexcept { return samples; }
+    auto& getSamples() noexcept { return samples; }
+
+    // the samples as stored in the file, empty unless the Wav was loaded with keepData
+    auto& getSampleFormat() const noexcept { return sampleFormat; }
+    auto& getData() const noexcept { return data; }
+
+    auto& getLoops() const noexcept { return loops; }
+    auto& getCuePoints() const noexcept { return cuePoints; }
 
 private:
     std::uint16_t channels = 0;
     std::uint32_t sampleRate = 0;
     std::uint32_t frames = 0;
-    std::vector<float> samples;
+    pcmplayer::SampleBuffer samples;
+    pcmplayer::SampleFormat sampleFormat = pcmplayer::SampleFormat::float32;
+    pcmplayer::ByteBuffer data;
+    std::vector<Loop> loops;
+    std::vector<CuePoint> cuePoints;
 };
 
 #endif /* Wav_h */
@@ -0,0 +1,515 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include "ALSAAudioPlayer.hpp"
+
+namespace pcmplayer::alsa
+{
+    const ErrorCategory errorCategory{};
+
+    namespace
+    {
+        struct DeviceHint final
+        {
+            std::string name;
+            std::string description;
+        };
+
+        std::vector<DeviceHint> getDeviceHints()
+        {
+            void** hints;
+            if (const auto result = snd_device_name_hint(-1, "pcm", &hints); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to get device hints");
+
+            std::vector<DeviceHint> result;
+
+            for (auto hint = hints; *hint; ++hint)
+            {
+                char* name = snd_device_name_get_hint(*hint, "NAME");
+                char* description = snd_device_name_get_hint(*hint, "DESC");
+                char* ioid = snd_device_name_get_hint(*hint, "IOID");
+
+                // a missing IOID means that the PCM supports both directions
+                if (name && (!ioid || std::strcmp(ioid, "Output") == 0))
+                {
+                    std::string firstLine = description ? description : name;
+                    firstLine = firstLine.substr(0, firstLine.find('\n'));
+                    result.push_back(DeviceHint{name, firstLine});
+                }
+
+                std::free(name);
+                std::free(description);
+                std::free(ioid);
+            }
+
+            snd_device_name_free_hint(hints);
+
+            return result;
+        }
+
+        std::string getDeviceName(std::uint32_t audioDeviceId)
+        {
+            if (audioDeviceId == 0)
+                return "default";
+
+            const auto hints = getDeviceHints();
+            if (audioDeviceId > hints.size())
+                throw std::runtime_error("Invalid device");
+
+            return hints[audioDeviceId - 1].name;
+        }
+
+        snd_pcm_format_t getFormat(SampleFormat sampleFormat) noexcept
+        {
+            switch (sampleFormat)
+            {
+                case SampleFormat::unsignedInt8: return SND_PCM_FORMAT_U8;
+                case SampleFormat::signedInt16: return SND_PCM_FORMAT_S16;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                case SampleFormat::signedInt24: return SND_PCM_FORMAT_S24_3BE;
+#else
+                case SampleFormat::signedInt24: return SND_PCM_FORMAT_S24_3LE;
+#endif
+                case SampleFormat::signedInt24In32: return SND_PCM_FORMAT_S24;
+                case SampleFormat::signedInt32: return SND_PCM_FORMAT_S32;
+                case SampleFormat::float32: return SND_PCM_FORMAT_FLOAT;
+                case SampleFormat::float64: return SND_PCM_FORMAT_FLOAT64;
+            }
+
+            return SND_PCM_FORMAT_UNKNOWN;
+        }
+    }
+
+    AudioPlayer::AudioPlayer(std::uint32_t audioDeviceId,
+                             std::uint32_t initBufferSize,
+                             std::uint32_t initSampleRate,
+                             SampleFormat initSampleFormat,
+                             std::uint16_t initChannels):
+        AudioPlayer(getDeviceName(audioDeviceId), initBufferSize, initSampleRate, initSampleFormat, initChannels)
+    {
+    }
+
+    AudioPlayer::AudioPlayer(const std::string& deviceName,
+                             std::uint32_t initBufferSize,
+                             std::uint32_t initSampleRate,
+                             SampleFormat initSampleFormat,
+                             std::uint16_t initChannels,
+                             std::uint32_t periods):
+        pcmplayer::AudioPlayer(Driver::alsa, initBufferSize, initSampleRate, initSampleFormat, initChannels)
+    {
+        if (bufferSize == 0 || periods < 2)
+            throw std::runtime_error("Invalid buffer size");
+
+        if (const auto result = snd_pcm_open(&pcm, deviceName.c_str(), SND_PCM_STREAM_PLAYBACK, 0); result < 0)
+            throw std::system_error(result, errorCategory, "Failed to open " + deviceName);
+
+        try
+        {
+            snd_pcm_hw_params_t* hwParams;
+            snd_pcm_hw_params_alloca(&hwParams);
+
+            if (const auto result = snd_pcm_hw_params_any(pcm, hwParams); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to get hardware parameters");
+
+            // render straight into the ring buffer if the PCM can be memory mapped
+            if (snd_pcm_hw_params_set_access(pcm, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0)
+            {
+                memoryMapped = false;
+                if (const auto result = snd_pcm_hw_params_set_access(pcm, hwParams, SND_PCM_ACCESS_RW_INTERLEAVED); result < 0)
+                    throw std::system_error(result, errorCategory, "Failed to set access type");
+            }
+
+            // try the formats closest to the requested one first
+            int formatResult = -EINVAL;
+            for (const auto candidate : getPreferredSampleFormats(sampleFormat))
+                if (snd_pcm_hw_params_test_format(pcm, hwParams, getFormat(candidate)) == 0)
+                {
+                    formatResult = snd_pcm_hw_params_set_format(pcm, hwParams, getFormat(candidate));
+                    if (formatResult == 0)
+                    {
+                        sampleFormat = candidate;
+                        break;
+                    }
+                }
+
+            if (formatResult < 0)
+                throw std::system_error(formatResult, errorCategory, "Failed to set sample format");
+
+            if (const auto result = snd_pcm_hw_params_set_channels(pcm, hwParams, channels); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to set channel count");
+
+            if (const auto result = snd_pcm_hw_params_set_rate_resample(pcm, hwParams, 1); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to enable resampling");
+
+            unsigned int rate = sampleRate;
+            if (const auto result = snd_pcm_hw_params_set_rate_near(pcm, hwParams, &rate, nullptr); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to set sample rate");
+
+            if (rate != sampleRate)
+                throw std::runtime_error("Sample rate not supported");
+
+            snd_pcm_uframes_t requestedPeriodSize = bufferSize;
+            int direction = 0;
+            if (const auto result = snd_pcm_hw_params_set_period_size_near(pcm, hwParams, &requestedPeriodSize, &direction); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to set period size");
+
+            snd_pcm_uframes_t requestedBufferSize = requestedPeriodSize * periods;
+            if (const auto result = snd_pcm_hw_params_set_buffer_size_near(pcm, hwParams, &requestedBufferSize); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to set buffer size");
+
+            if (const auto result = snd_pcm_hw_params(pcm, hwParams); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to set hardware parameters");
+
+            if (const auto result = snd_pcm_hw_params_get_period_size(hwParams, &periodSize, &direction); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to get period size");
+
+            if (const auto result = snd_pcm_hw_params_get_buffer_size(hwParams, &bufferFrameCount); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to get buffer size");
+
+            snd_pcm_sw_params_t* swParams;
+            snd_pcm_sw_params_alloca(&swParams);
+
+            if (const auto result = snd_pcm_sw_params_current(pcm, swParams); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to get software parameters");
+
+            if (const auto result = snd_pcm_sw_params_set_avail_min(pcm, swParams, periodSize); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to set minimum available frames");
+
+            // the stream is started explicitly after the buffer has been filled
+            snd_pcm_uframes_t boundary;
+            if (const auto result = snd_pcm_sw_params_get_boundary(swParams, &boundary); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to get boundary");
+
+            if (const auto result = snd_pcm_sw_params_set_start_threshold(pcm, swParams, boundary); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to set start threshold");
+
+            if (const auto result = snd_pcm_sw_params(pcm, swParams); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to set software parameters");
+
+            const auto descriptorCount = snd_pcm_poll_descriptors_count(pcm);
+            if (descriptorCount <= 0)
+                throw std::system_error(descriptorCount, errorCategory, "Failed to get poll descriptor count");
+
+            pollDescriptors.resize(static_cast<std::size_t>(descriptorCount));
+            if (const auto result = snd_pcm_poll_descriptors(pcm, pollDescriptors.data(), static_cast<unsigned int>(descriptorCount)); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to get poll descriptors");
+
+            frameSize = getSampleSize(sampleFormat) * channels;
+            if (!memoryMapped)
+                writeBuffer.resize(bufferFrameCount * frameSize);
+
+            bufferSize = static_cast<std::uint32_t>(bufferFrameCount);
+            targetFrameCount = bufferFrameCount;
+        }
+        catch (...)
+        {
+            snd_pcm_close(pcm);
+            throw;
+        }
+    }
+
+    AudioPlayer::~AudioPlayer()
+    {
+        if (pcm) snd_pcm_close(pcm);
+    }
+
+    void AudioPlayer::start()
+    {
+        startStream();
+        run();
+    }
+
+    void AudioPlayer::stop()
+    {
+        running = false;
+    }
+
+    void AudioPlayer::setBufferSize(std::uint32_t newBufferSize)
+    {
+        // the ring buffer is allocated once, only the fill level is limited
+        const snd_pcm_uframes_t newTargetFrameCount = newBufferSize < bufferFrameCount ? newBufferSize : bufferFrameCount;
+
+        // wake up when half of the target fill level has been played out
+        snd_pcm_sw_params_t* swParams;
+        snd_pcm_sw_params_alloca(&swParams);
+
+        if (const auto result = snd_pcm_sw_params_current(pcm, swParams); result < 0)
+            throw std::system_error(result, errorCategory, "Failed to get software parameters");
+
+        if (const auto result = snd_pcm_sw_params_set_avail_min(pcm, swParams, bufferFrameCount - newTargetFrameCount / 2); result < 0)
+            throw std::system_error(result, errorCategory, "Failed to set minimum available frames");
+
+        if (const auto result = snd_pcm_sw_params(pcm, swParams); result < 0)
+            throw std::system_error(result, errorCategory, "Failed to set software parameters");
+
+        targetFrameCount = newTargetFrameCount;
+        bufferSize = static_cast<std::uint32_t>(newTargetFrameCount);
+    }
+
+    bool AudioPlayer::fill()
+    {
+        const auto available = snd_pcm_avail_update(pcm);
+        if (available < 0)
+        {
+            recover(static_cast<int>(available));
+            return true;
+        }
+
+        const auto availableFrames = static_cast<snd_pcm_uframes_t>(available);
+        const auto filledFrames = availableFrames < bufferFrameCount ? bufferFrameCount - availableFrames : 0;
+        const snd_pcm_uframes_t target = targetFrameCount;
+
+        if (filledFrames >= target)
+        {
+            if (snd_pcm_state(pcm) != SND_PCM_STATE_PREPARED)
+                return false;
+
+            if (const auto result = snd_pcm_start(pcm); result < 0)
+                recover(result);
+            return true;
+        }
+
+        const auto callbackStart = metrics.beginCallback();
+        trace::Scope scope("ALSA::render");
+        RenderScope renderScope;
+
+        const auto frames = target - filledFrames;
+        const bool hasMoreData = write(frames);
+
+        // the frames between the application and the speaker
+        if (snd_pcm_sframes_t delay = 0; snd_pcm_delay(pcm, &delay) == 0)
+            publishPlaybackPosition(delay > 0 ? static_cast<std::uint64_t>(delay) : 0);
+
+        metrics.endCallback(callbackStart, static_cast<std::uint32_t>(frames));
+
+        if (!hasMoreData)
+        {
+            finished = true;
+
+            if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED)
+                snd_pcm_start(pcm);
+        }
+        else
+            adaptBufferSize();
+
+        return true;
+    }
+
+    void AudioPlayer::run()
+    {
+        prepareRenderThread();
+
+        try
+        {
+            while (running)
+            {
+                if (!fill())
+                    wait();
+                else if (finished)
+                {
+                    // let the device play out the rest of the buffer
+                    snd_pcm_drain(pcm);
+                    running = false;
+                    return;
+                }
+            }
+
+            snd_pcm_drop(pcm);
+        }
+        catch (const std::exception&)
+        {
+            metrics.error();
+            running = false;
+            snd_pcm_drop(pcm);
+            throw;
+        }
+    }
+
+    void AudioPlayer::startStream()
+    {
+        if (const auto result = snd_pcm_prepare(pcm); result < 0)
+            throw std::system_error(result, errorCategory, "Failed to prepare PCM");
+
+        finished = false;
+        running = true;
+    }
+
+    void AudioPlayer::stopStream()
+    {
+        running = false;
+        snd_pcm_drop(pcm);
+        snd_pcm_nonblock(pcm, 0);
+    }
+
+    std::size_t AudioPlayer::getWakeupHandles(WakeupHandle* handles, std::size_t count)
+    {
+        // only the drain deadline matters after the end of the data
+        if (finished) return 0;
+
+        if (count >= pollDescriptors.size())
+            std::copy(pollDescriptors.begin(), pollDescriptors.end(), handles);
+
+        return pollDescriptors.size();
+    }
+
+    std::chrono::steady_clock::time_point AudioPlayer::getDeadline() const noexcept
+    {
+        return finished ? drainDeadline : std::chrono::steady_clock::time_point::max();
+    }
+
+    bool AudioPlayer::process(WakeupHandle* handles, std::size_t count)
+    {
+        try
+        {
+            if (finished)
+            {
+                if (snd_pcm_state(pcm) != SND_PCM_STATE_DRAINING)
+                    return false;
+
+                drainDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+                return true;
+            }
+
+            if (count)
+            {
+                unsigned short events;
+                if (const auto result = snd_pcm_poll_descriptors_revents(pcm, handles, static_cast<unsigned int>(count), &events); result < 0)
+                    throw std::system_error(result, errorCategory, "Failed to get poll events");
+
+                if (!(events & (POLLOUT | POLLERR)))
+                    return true;
+            }
+
+            while (fill())
+                if (finished)
+                {
+                    // drain in the background and check back when it should be done
+                    snd_pcm_sframes_t delay = 0;
+                    snd_pcm_delay(pcm, &delay);
+
+                    snd_pcm_nonblock(pcm, 1);
+                    snd_pcm_drain(pcm);
+
+                    drainDeadline = std::chrono::steady_clock::now() +
+                        std::chrono::microseconds(delay > 0 ? delay * 1'000'000 / sampleRate : 0);
+                    return true;
+                }
+
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            metrics.error();
+            throw;
+        }
+    }
+
+    bool AudioPlayer::write(snd_pcm_uframes_t frames)
+    {
+        bool hasMoreData = true;
+
+        if (memoryMapped)
+        {
+            while (frames > 0 && hasMoreData)
+            {
+                // the mapped area can be shorter than requested if it wraps around the end of the ring buffer
+                const snd_pcm_channel_area_t* areas;
+                snd_pcm_uframes_t offset;
+                snd_pcm_uframes_t count = frames;
+                if (const auto result = snd_pcm_mmap_begin(pcm, &areas, &offset, &count); result < 0)
+                {
+                    recover(result);
+                    break;
+                }
+
+                auto destination = static_cast<std::uint8_t*>(areas[0].addr) +
+                    areas[0].first / 8 + offset * areas[0].step / 8;
+                hasMoreData = render(static_cast<std::uint32_t>(count), destination);
+
+                const auto committed = snd_pcm_mmap_commit(pcm, offset, count);
+                if (committed < 0)
+                {
+                    recover(static_cast<int>(committed));
+                    break;
+                }
+                else if (static_cast<snd_pcm_uframes_t>(committed) != count)
+                {
+                    recover(-EPIPE);
+                    break;
+                }
+
+                frames -= count;
+            }
+        }
+        else
+        {
+            hasMoreData = render(static_cast<std::uint32_t>(frames), writeBuffer.data());
+
+            const std::uint8_t* source = writeBuffer.data();
+            while (frames > 0)
+            {
+                const auto written = snd_pcm_writei(pcm, source, frames);
+                if (written < 0)
+                {
+                    if (written == -EAGAIN) continue;
+                    recover(static_cast<int>(written));
+                    break;
+                }
+
+                source += static_cast<snd_pcm_uframes_t>(written) * frameSize;
+                frames -= static_cast<snd_pcm_uframes_t>(written);
+            }
+        }
+
+        return hasMoreData;
+    }
+
+    void AudioPlayer::recover(int error)
+    {
+        if (error == -EPIPE)
+            metrics.underrun();
+        else if (error == -ESTRPIPE)
+            metrics.xrun();
+
+        // leaves the PCM prepared, the next write restarts it
+        if (const auto result = snd_pcm_recover(pcm, error, 1); result < 0)
+            throw std::system_error(result, errorCategory, "Failed to recover from an error");
+    }
+
+    void AudioPlayer::wait()
+    {
+        for (;;)
+        {
+            if (poll(pollDescriptors.data(), static_cast<nfds_t>(pollDescriptors.size()), -1) < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::system_category(), "Failed to poll");
+            }
+
+            unsigned short events;
+            if (const auto result = snd_pcm_poll_descriptors_revents(pcm, pollDescriptors.data(),
+                                                                     static_cast<unsigned int>(pollDescriptors.size()),
+                                                                     &events); result < 0)
+                throw std::system_error(result, errorCategory, "Failed to get poll events");
+
+            // errors are reported by the next snd_pcm_avail_update
+            if (events & (POLLOUT | POLLERR))
+                return;
+        }
+    }
+
+    std::vector<AudioDevice> AudioPlayer::getAudioDevices()
+    {
+        std::vector<AudioDevice> result;
+
+        std::uint32_t audioDeviceId = 0;
+        result.push_back(AudioDevice{audioDeviceId++, "Default device"});
+
+        for (const auto& hint : getDeviceHints())
+            result.push_back(AudioDevice{audioDeviceId++, hint.name + " (" + hint.description + ")"});
+
+        return result;
+    }
+}
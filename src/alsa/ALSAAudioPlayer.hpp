@@ -0,0 +1,75 @@
+#ifndef ALSAAUDIOPLAYER_HPP
+#define ALSAAUDIOPLAYER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <alsa/asoundlib.h>
+#include "../AudioPlayer.hpp"
+#include "../AudioDevice.hpp"
+#include "../SampleBuffer.hpp"
+#include "../Scheduler.hpp"
+#include "ALSAErrorCategory.hpp"
+
+namespace pcmplayer::alsa
+{
+    class AudioPlayer final: public pcmplayer::AudioPlayer, public ScheduledStream
+    {
+    public:
+        AudioPlayer(std::uint32_t audioDeviceId,
+                    std::uint32_t initBufferSize,
+                    std::uint32_t initSampleRate,
+                    SampleFormat initSampleFormat,
+                    std::uint16_t initChannels);
+
+        // Opens a PCM by its ALSA name, e.g. "hw:0,0", "null" or "file:'out.raw',raw".
+        // The buffer size is the period size, the device buffer holds the given number of periods.
+        AudioPlayer(const std::string& deviceName,
+                    std::uint32_t initBufferSize,
+                    std::uint32_t initSampleRate,
+                    SampleFormat initSampleFormat,
+                    std::uint16_t initChannels,
+                    std::uint32_t periods = 2);
+        ~AudioPlayer() override;
+
+        AudioPlayer(const AudioPlayer&) = delete;
+        AudioPlayer& operator=(const AudioPlayer&) = delete;
+
+        void start() final;
+        void stop() final;
+
+        void startStream() final;
+        void stopStream() final;
+        std::size_t getWakeupHandles(WakeupHandle* handles, std::size_t count) final;
+        std::chrono::steady_clock::time_point getDeadline() const noexcept final;
+        bool process(WakeupHandle* handles, std::size_t count) final;
+
+        bool isMemoryMapped() const noexcept { return memoryMapped; }
+
+        static std::vector<AudioDevice> getAudioDevices();
+
+    private:
+        void setBufferSize(std::uint32_t newBufferSize) final;
+        void run();
+        bool fill();
+        bool write(snd_pcm_uframes_t frames);
+        void recover(int error);
+        void wait();
+
+        snd_pcm_t* pcm = nullptr;
+        std::vector<pollfd> pollDescriptors;
+        ByteBuffer writeBuffer; // only used if the PCM can not be memory mapped
+
+        snd_pcm_uframes_t periodSize = 0;
+        snd_pcm_uframes_t bufferFrameCount = 0;
+        std::atomic<snd_pcm_uframes_t> targetFrameCount{0};
+        std::uint32_t frameSize = 0;
+        bool memoryMapped = true;
+        bool finished = false;
+        std::chrono::steady_clock::time_point drainDeadline;
+        std::atomic<bool> running{false};
+    };
+}
+
+#endif // ALSAAUDIOPLAYER_HPP
@@ -0,0 +1,25 @@
+#ifndef ALSAERRORCATEGORY_HPP
+#define ALSAERRORCATEGORY_HPP
+
+#include <string>
+#include <system_error>
+#include <alsa/asoundlib.h>
+
+namespace pcmplayer::alsa
+{
+    class ErrorCategory final: public std::error_category
+    {
+    public:
+        const char* name() const noexcept final
+        {
+            return "ALSA";
+        }
+
+        std::string message(int condition) const final
+        {
+            return snd_strerror(condition);
+        }
+    };
+}
+
+#endif // ALSAERRORCATEGORY_HPP
@@ -17,23 +17,30 @@ namespace pcmplayer::coreaudio
             // TODO: implement
             return noErr;
         }
+
+        OSStatus processorOverload(AudioObjectID, UInt32, const AudioObjectPropertyAddress*, void* inClientData)
+        {
+            auto audioPlayer = static_cast<pcmplayer::coreaudio::AudioPlayer*>(inClientData);
+            audioPlayer->overload();
+            return noErr;
+        }
 #endif
 
         OSStatus outputCallback(void* inRefCon,
                                 AudioUnitRenderActionFlags*,
-                                const AudioTimeStamp*,
-                                UInt32, UInt32,
+                                const AudioTimeStamp* inTimeStamp,
+                                UInt32, UInt32 inNumberFrames,
                                 AudioBufferList* ioData)
         {
             auto audioPlayer = static_cast<pcmplayer::coreaudio::AudioPlayer*>(inRefCon);
 
             try
             {
-                audioPlayer->outputCallback(ioData);
+                audioPlayer->outputCallback(inTimeStamp, inNumberFrames, ioData);
             }
-            catch (const std::exception& e)
+            catch (const std::exception&)
             {
-                //std::cerr << e.what();
+                audioPlayer->error();
                 return -1;
             }
 
@@ -43,6 +50,47 @@ namespace pcmplayer::coreaudio
 
     const ErrorCategory errorCategory {};
 
+    namespace
+    {
+        AudioStreamBasicDescription getStreamDescription(SampleFormat sampleFormat, std::uint16_t channels, std::uint32_t sampleRate)
+        {
+            AudioStreamBasicDescription streamDescription;
+            streamDescription.mSampleRate = sampleRate;
+            streamDescription.mFormatID = kAudioFormatLinearPCM;
+            streamDescription.mChannelsPerFrame = channels;
+            streamDescription.mFramesPerPacket = 1;
+            streamDescription.mBytesPerFrame = getSampleSize(sampleFormat) * channels;
+            streamDescription.mBytesPerPacket = streamDescription.mBytesPerFrame * streamDescription.mFramesPerPacket;
+            streamDescription.mReserved = 0;
+
+            switch (sampleFormat)
+            {
+                case SampleFormat::unsignedInt8:
+                    streamDescription.mFormatFlags = kLinearPCMFormatFlagIsPacked;
+                    streamDescription.mBitsPerChannel = 8;
+                    break;
+                case SampleFormat::signedInt16:
+                case SampleFormat::signedInt24:
+                case SampleFormat::signedInt32:
+                    streamDescription.mFormatFlags = kLinearPCMFormatFlagIsPacked | kAudioFormatFlagIsSignedInteger;
+                    streamDescription.mBitsPerChannel = getSampleSize(sampleFormat) * 8;
+                    break;
+                case SampleFormat::signedInt24In32:
+                    // not packed and not aligned high, so the sample is in the low bytes
+                    streamDescription.mFormatFlags = kAudioFormatFlagIsSignedInteger;
+                    streamDescription.mBitsPerChannel = 24;
+                    break;
+                case SampleFormat::float32:
+                case SampleFormat::float64:
+                    streamDescription.mFormatFlags = kLinearPCMFormatFlagIsPacked | kLinearPCMFormatFlagIsFloat;
+                    streamDescription.mBitsPerChannel = getSampleSize(sampleFormat) * 8;
+                    break;
+            }
+
+            return streamDescription;
+        }
+    }
+
     AudioPlayer::AudioPlayer(std::uint32_t audioDeviceId,
                              std::uint32_t initBufferSize,
                              std::uint32_t initSampleRate,
@@ -50,6 +98,8 @@ namespace pcmplayer::coreaudio
                              std::uint16_t initChannels):
         pcmplayer::AudioPlayer(Driver::coreAudio, initBufferSize, initSampleRate, initSampleFormat, initChannels)
     {
+        mach_timebase_info(&timebase);
+
 #if TARGET_OS_IOS || TARGET_OS_TV
         id audioSession = reinterpret_cast<id (*)(Class, SEL)>(&objc_msgSend)(objc_getClass("AVAudioSession"), sel_getUid("sharedInstance")); // [AVAudioSession sharedInstance]
         if (!reinterpret_cast<BOOL (*)(id, SEL, id, id)>(&objc_msgSend)(audioSession, sel_getUid("setCategory:error:"), AVAudioSessionCategoryAmbient, nil)) // [audioSession setCategory:AVAudioSessionCategoryAmbient error:nil]
@@ -198,6 +248,18 @@ namespace pcmplayer::coreaudio
                                                                deviceUnplugged,
                                                                this); result != noErr)
             throw std::system_error(result, errorCategory, "Failed to add CoreAudio property listener");
+
+        constexpr AudioObjectPropertyAddress overloadAddress = {
+            kAudioDeviceProcessorOverload,
+            kAudioObjectPropertyScopeGlobal,
+            kAudioObjectPropertyElementMaster
+        };
+
+        if (const auto result = AudioObjectAddPropertyListener(deviceId,
+                                                               &overloadAddress,
+                                                               processorOverload,
+                                                               this); result != noErr)
+            throw std::system_error(result, errorCategory, "Failed to add CoreAudio property listener");
 #endif
 
         if (const auto result = AudioComponentInstanceNew(audioComponent,
@@ -216,46 +278,29 @@ namespace pcmplayer::coreaudio
 
         constexpr AudioUnitElement bus = 0;
 
-        AudioStreamBasicDescription streamDescription;
-        streamDescription.mSampleRate = sampleRate;
-        streamDescription.mFormatID = kAudioFormatLinearPCM;
-        streamDescription.mFormatFlags = kLinearPCMFormatFlagIsFloat;
-        streamDescription.mChannelsPerFrame = channels;
-        streamDescription.mFramesPerPacket = 1;
-        streamDescription.mBitsPerChannel = sizeof(float) * 8;
-        streamDescription.mBytesPerFrame = streamDescription.mBitsPerChannel * streamDescription.mChannelsPerFrame / 8;
-        streamDescription.mBytesPerPacket = streamDescription.mBytesPerFrame * streamDescription.mFramesPerPacket;
-        streamDescription.mReserved = 0;
-
-        sampleFormat = SampleFormat::float32;
-        sampleSize = sizeof(float);
-
-        if (const auto result = AudioUnitSetProperty(audioUnit,
-                                                     kAudioUnitProperty_StreamFormat,
-                                                     kAudioUnitScope_Input,
-                                                     bus,
-                                                     &streamDescription,
-                                                     sizeof(streamDescription)); result != noErr)
+        // try the formats closest to the requested one first
+        OSStatus streamFormatResult = kAudioUnitErr_FormatNotSupported;
+        for (const auto candidate : getPreferredSampleFormats(sampleFormat))
         {
-            // std::cerr << "Failed to set CoreAudio unit stream format to float, error: " << result;
-
-            streamDescription.mFormatFlags = kLinearPCMFormatFlagIsPacked | kAudioFormatFlagIsSignedInteger;
-            streamDescription.mBitsPerChannel = sizeof(std::int16_t) * 8;
-            streamDescription.mBytesPerFrame = streamDescription.mBitsPerChannel * streamDescription.mChannelsPerFrame / 8;
-            streamDescription.mBytesPerPacket = streamDescription.mBytesPerFrame * streamDescription.mFramesPerPacket;
-
-            if (const auto setPropertyResult = AudioUnitSetProperty(audioUnit,
-                                                                    kAudioUnitProperty_StreamFormat,
-                                                                    kAudioUnitScope_Input,
-                                                                    bus,
-                                                                    &streamDescription,
-                                                                    sizeof(streamDescription)); setPropertyResult != noErr)
-                throw std::system_error(setPropertyResult, errorCategory, "Failed to set CoreAudio unit stream format");
-
-            sampleFormat = SampleFormat::signedInt16;
-            sampleSize = sizeof(std::int16_t);
+            const auto streamDescription = getStreamDescription(candidate, channels, sampleRate);
+
+            streamFormatResult = AudioUnitSetProperty(audioUnit,
+                                                      kAudioUnitProperty_StreamFormat,
+                                                      kAudioUnitScope_Input,
+                                                      bus,
+                                                      &streamDescription,
+                                                      sizeof(streamDescription));
+            if (streamFormatResult == noErr)
+            {
+                sampleFormat = candidate;
+                sampleSize = getSampleSize(candidate);
+                break;
+            }
         }
 
+        if (streamFormatResult != noErr)
+            throw std::system_error(streamFormatResult, errorCategory, "Failed to set CoreAudio unit stream format");
+
         AURenderCallbackStruct callback;
         callback.inputProc = coreaudio::outputCallback;
         callback.inputProcRefCon = this;
@@ -328,6 +373,17 @@ namespace pcmplayer::coreaudio
                                               &aliveAddress,
                                               deviceUnplugged,
                                               this);
+
+            constexpr AudioObjectPropertyAddress overloadAddress = {
+                kAudioDeviceProcessorOverload,
+                kAudioObjectPropertyScopeGlobal,
+                kAudioObjectPropertyElementMaster
+            };
+
+            AudioObjectRemovePropertyListener(deviceId,
+                                              &overloadAddress,
+                                              processorOverload,
+                                              this);
         }
 #endif
     }
@@ -350,28 +406,86 @@ namespace pcmplayer::coreaudio
         running = false;
     }
 
-    void AudioPlayer::outputCallback(AudioBufferList* ioData)
+    void AudioPlayer::outputCallback(const AudioTimeStamp* timeStamp, UInt32 frames, AudioBufferList* ioData)
     {
+        const auto callbackStart = metrics.beginCallback();
+        trace::Scope scope("CoreAudio::outputCallback");
+        RenderScope renderScope;
+
+        // the device time skipped ahead of the frames we have delivered so far
+        if (timeStamp && (timeStamp->mFlags & kAudioTimeStampSampleTimeValid))
+        {
+            if (nextSampleTime >= 0.0 && timeStamp->mSampleTime > nextSampleTime)
+                metrics.underrun();
+
+            nextSampleTime = timeStamp->mSampleTime + frames;
+        }
+
+        const auto firstFrame = getRenderedFrames();
+
         for (UInt32 i = 0; i < ioData->mNumberBuffers; ++i)
         {
             AudioBuffer& buffer = ioData->mBuffers[i];
-            bool hasMoreData = getData(buffer.mDataByteSize / (sampleSize * channels), data);
-            std::copy(data.begin(), data.end(), static_cast<float*>(buffer.mData));
+            const bool hasMoreData = render(buffer.mDataByteSize / (sampleSize * channels), buffer.mData);
 
+            // no lock in the callback, a missed notification only delays
+            // run() until the next adaptation interval
             if (!hasMoreData)
             {
-                std::unique_lock<std::mutex> lock(runningMutex);
                 running = false;
-                lock.unlock();
                 runningCondition.notify_all();
             }
         }
+
+        // the host time is when the first frame of the buffer hits the output
+        if (timeStamp && (timeStamp->mFlags & kAudioTimeStampHostTimeValid))
+        {
+            const auto hostTime = mach_absolute_time();
+            const auto ahead = timeStamp->mHostTime > hostTime ?
+                (timeStamp->mHostTime - hostTime) * timebase.numer / timebase.denom : 0;
+            publishPlaybackPosition(firstFrame, std::chrono::steady_clock::now() + std::chrono::nanoseconds(ahead));
+        }
+
+        metrics.endCallback(callbackStart, frames);
+    }
+
+    void AudioPlayer::overload() noexcept
+    {
+        metrics.xrun();
+    }
+
+    void AudioPlayer::error() noexcept
+    {
+        metrics.error();
+    }
+
+    void AudioPlayer::setBufferSize(std::uint32_t newBufferSize)
+    {
+#if TARGET_OS_MAC && !TARGET_OS_IOS && !TARGET_OS_TV
+        const UInt32 inIOBufferFrameSize = static_cast<UInt32>(newBufferSize);
+        if (const auto result = AudioUnitSetProperty(audioUnit,
+                                                     kAudioDevicePropertyBufferFrameSize,
+                                                     kAudioUnitScope_Global,
+                                                     0,
+                                                     &inIOBufferFrameSize,
+                                                     sizeof(UInt32)); result != noErr)
+            throw std::system_error(result, errorCategory, "Failed to set CoreAudio buffer size");
+#endif
+
+        bufferSize = newBufferSize;
     }
 
     void AudioPlayer::run()
     {
         std::unique_lock<std::mutex> lock(runningMutex);
-        while (running) runningCondition.wait(lock);
+        while (running)
+        {
+            runningCondition.wait_for(lock, adaptationInterval);
+
+            lock.unlock();
+            adaptBufferSize();
+            lock.lock();
+        }
     }
 
     namespace
@@ -1,6 +1,7 @@
 #ifndef CAAUDIOPLAYER_HPP
 #define CAAUDIOPLAYER_HPP
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <vector>
@@ -13,6 +14,7 @@
 #endif
 
 #include <AudioUnit/AudioUnit.h>
+#include <mach/mach_time.h>
 
 #include "../AudioPlayer.hpp"
 #include "../AudioDevice.hpp"
@@ -33,11 +35,14 @@ namespace pcmplayer::coreaudio
         void start() final;
         void stop() final;
 
-        void outputCallback(AudioBufferList* ioData);
+        void outputCallback(const AudioTimeStamp* timeStamp, UInt32 frames, AudioBufferList* ioData);
+        void overload() noexcept;
+        void error() noexcept;
 
         static std::vector<AudioDevice> getAudioDevices();
 
     private:
+        void setBufferSize(std::uint32_t newBufferSize) final;
         void run();
 
 #if TARGET_OS_MAC && !TARGET_OS_IOS && !TARGET_OS_TV
@@ -47,11 +52,12 @@ namespace pcmplayer::coreaudio
         AudioUnit audioUnit = nullptr;
 
         std::uint32_t sampleSize = 0;
-        std::vector<float> data;
+        Float64 nextSampleTime = -1.0;
+        mach_timebase_info_data_t timebase{};
 
         std::mutex runningMutex;
         std::condition_variable runningCondition;
-        bool running = false;
+        std::atomic<bool> running{false};
     };
 }
 
@@ -0,0 +1,116 @@
+#ifndef DSP_ANALYSISTAP_HPP
+#define DSP_ANALYSISTAP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include "Processor.hpp"
+
+namespace pcmplayer::dsp
+{
+    // Copies the samples that pass through it to a ring of the last frames,
+    // which any number of threads can read, e.g. for meters. The render
+    // thread never waits for the readers, a reader that falls more than the
+    // capacity behind fails to copy instead.
+    class AnalysisTap final: public Processor
+    {
+    public:
+        // the capacity in frames is rounded up to a power of two
+        explicit AnalysisTap(std::uint32_t initCapacity = 16384)
+        {
+            if (initCapacity == 0)
+                throw std::runtime_error("Invalid capacity");
+
+            capacity = 1;
+            while (capacity < initCapacity) capacity *= 2;
+        }
+
+        void prepare(std::uint32_t newSampleRate, std::uint32_t newMaxBlockSize, std::uint16_t newChannels) final
+        {
+            if (newMaxBlockSize > capacity)
+                throw std::runtime_error("Block size exceeds the capacity of the tap");
+
+            sampleRate = newSampleRate;
+            channels = newChannels;
+            ring = std::make_unique<std::atomic<float>[]>(static_cast<std::size_t>(capacity) * channels);
+            written.store(0, std::memory_order_relaxed);
+            writing.store(0, std::memory_order_relaxed);
+        }
+
+        void process(float* samples, std::uint32_t frames) noexcept final
+        {
+            const auto first = written.load(std::memory_order_relaxed);
+
+            // marks the frames that are overwritten before writing them
+            writing.store(first + frames, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for (std::uint32_t frame = 0; frame < frames; ++frame)
+            {
+                const auto slot = static_cast<std::size_t>((first + frame) & (capacity - 1)) * channels;
+                for (std::uint16_t channel = 0; channel < channels; ++channel)
+                    ring[slot + channel].store(samples[frame * channels + channel], std::memory_order_relaxed);
+            }
+
+            written.store(first + frames, std::memory_order_release);
+        }
+
+        // keeps the history, the readers count on the frame numbers
+        void reset() noexcept final {}
+
+        std::uint32_t getLatency() const noexcept final { return 0; }
+
+        // the silent blocks are copied too, the frame numbers follow the stream
+        std::uint32_t getTail() const noexcept final { return infiniteTail; }
+
+        // the stream parameters of the last prepare()
+        std::uint32_t getSampleRate() const noexcept { return sampleRate; }
+        std::uint16_t getChannels() const noexcept { return channels; }
+        std::uint32_t getCapacity() const noexcept { return capacity; }
+
+        // from any thread, the frames that have passed through since prepare()
+        std::uint64_t getFramesWritten() const noexcept
+        {
+            return written.load(std::memory_order_acquire);
+        }
+
+        // From any thread, copies the interleaved frames starting at the
+        // given frame number. Returns false if they have not been written
+        // yet or have already been overwritten.
+        bool copy(std::uint64_t first, float* output, std::uint32_t frames) const noexcept
+        {
+            if (!ring || frames > capacity) return false;
+
+            if (first + frames > written.load(std::memory_order_acquire)) return false;
+
+            for (std::uint32_t frame = 0; frame < frames; ++frame)
+            {
+                const auto slot = static_cast<std::size_t>((first + frame) & (capacity - 1)) * channels;
+                for (std::uint16_t channel = 0; channel < channels; ++channel)
+                    output[frame * channels + channel] = ring[slot + channel].load(std::memory_order_relaxed);
+            }
+
+            // the render thread might have started overwriting them in the meantime
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return writing.load(std::memory_order_relaxed) <= first + capacity;
+        }
+
+        // from any thread, the most recent frames, returns false if there are not enough of them
+        bool copyLatest(float* output, std::uint32_t frames) const noexcept
+        {
+            const auto end = written.load(std::memory_order_acquire);
+            return end >= frames && copy(end - frames, output, frames);
+        }
+
+    private:
+        std::uint32_t capacity; // in frames, a power of two
+        std::uint32_t sampleRate = 0;
+        std::uint16_t channels = 0;
+        std::unique_ptr<std::atomic<float>[]> ring;
+        std::atomic<std::uint64_t> written{0}; // frames published to the readers
+        std::atomic<std::uint64_t> writing{0}; // the end of the frames being written
+    };
+}
+
+#endif // DSP_ANALYSISTAP_HPP
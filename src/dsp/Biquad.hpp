@@ -0,0 +1,68 @@
+#ifndef DSP_BIQUAD_HPP
+#define DSP_BIQUAD_HPP
+
+#include "Float4.hpp"
+
+namespace pcmplayer::dsp
+{
+    // normalized by a0
+    struct BiquadCoefficients final
+    {
+        float b0 = 1.0F;
+        float b1 = 0.0F;
+        float b2 = 0.0F;
+        float a1 = 0.0F;
+        float a2 = 0.0F;
+    };
+
+    // Four independent biquads in transposed direct form II, one per lane
+    class Biquad4 final
+    {
+    public:
+        void setCoefficients(const BiquadCoefficients& coefficients) noexcept
+        {
+            const BiquadCoefficients lanes[4] = {coefficients, coefficients, coefficients, coefficients};
+            setCoefficients(lanes);
+        }
+
+        void setCoefficients(const BiquadCoefficients (&lanes)[4]) noexcept
+        {
+            float values[4];
+            const auto gather = [&lanes, &values](float BiquadCoefficients::*member) noexcept {
+                for (int i = 0; i < 4; ++i) values[i] = lanes[i].*member;
+                return Float4::load(values);
+            };
+
+            b0 = gather(&BiquadCoefficients::b0);
+            b1 = gather(&BiquadCoefficients::b1);
+            b2 = gather(&BiquadCoefficients::b2);
+            a1 = gather(&BiquadCoefficients::a1);
+            a2 = gather(&BiquadCoefficients::a2);
+        }
+
+        void reset() noexcept
+        {
+            z1 = Float4::zero();
+            z2 = Float4::zero();
+        }
+
+        Float4 process(Float4 input) noexcept
+        {
+            const auto output = b0 * input + z1;
+            z1 = b1 * input - a1 * output + z2;
+            z2 = b2 * input - a2 * output;
+            return output;
+        }
+
+    private:
+        Float4 b0 = Float4::broadcast(1.0F);
+        Float4 b1 = Float4::zero();
+        Float4 b2 = Float4::zero();
+        Float4 a1 = Float4::zero();
+        Float4 a2 = Float4::zero();
+        Float4 z1 = Float4::zero();
+        Float4 z2 = Float4::zero();
+    };
+}
+
+#endif // DSP_BIQUAD_HPP
@@ -0,0 +1,301 @@
+#ifndef DSP_CONVOLUTION_HPP
+#define DSP_CONVOLUTION_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../SampleBuffer.hpp"
+#include "Fft.hpp"
+#include "Float4.hpp"
+#include "Processor.hpp"
+
+#if defined(min) || defined(max)
+#  error "windows.h was included without NOMINMAX"
+#endif
+
+namespace pcmplayer::dsp
+{
+    // Convolves one channel with an impulse response with a latency of one
+    // block. The start of the response is split into partitions of the block
+    // size, the later parts into partitions eight times larger than the
+    // previous ones, each as soon as the latency allows it. Every group of
+    // partitions is an overlap-save convolution with a frequency-domain
+    // delay line.
+    class Convolver final
+    {
+    public:
+        Convolver(const float* impulseResponse, std::size_t length, std::uint32_t initBlockSize):
+            blockSize{initBlockSize}
+        {
+            if (blockSize < 2 || (blockSize & (blockSize - 1)) != 0)
+                throw std::runtime_error("Convolution block size must be a power of two");
+
+            std::size_t offset = 0;
+            std::size_t partitionSize = blockSize;
+
+            while (offset < length)
+            {
+                // a group with partitions of the next size may start once its latency is covered
+                auto nextSize = partitionSize * groupGrowth;
+                const bool last = nextSize > maxPartitionSize;
+                const auto end = last ? length : std::min(length, nextSize - blockSize);
+
+                stages.push_back(std::make_unique<Stage>(impulseResponse + offset, end - offset, offset, partitionSize));
+
+                offset = end;
+                if (!last) partitionSize = nextSize;
+            }
+
+            // the farthest a stage adds its output ahead of the current block
+            std::size_t extent = blockSize * 2;
+            for (const auto& stage : stages)
+                extent = std::max(extent, stage->offset + stage->size + blockSize * 2);
+
+            accumulatorSize = 1;
+            while (accumulatorSize < extent) accumulatorSize *= 2;
+            accumulator.assign(accumulatorSize, 0.0F);
+
+            inputBlock.assign(blockSize, 0.0F);
+            outputBlock.assign(blockSize, 0.0F);
+        }
+
+        std::uint32_t getLatency() const noexcept { return blockSize; }
+
+        void reset() noexcept
+        {
+            for (const auto& stage : stages) stage->reset();
+            std::fill(accumulator.begin(), accumulator.end(), 0.0F);
+            std::fill(inputBlock.begin(), inputBlock.end(), 0.0F);
+            std::fill(outputBlock.begin(), outputBlock.end(), 0.0F);
+            fill = 0;
+            time = 0;
+        }
+
+        // in place on samples with the given stride, does not allocate
+        void process(float* samples, std::size_t stride, std::uint32_t frames) noexcept
+        {
+            for (std::uint32_t frame = 0; frame < frames; ++frame)
+            {
+                auto& sample = samples[frame * stride];
+                inputBlock[fill] = sample;
+                sample = outputBlock[fill];
+
+                if (++fill == blockSize)
+                {
+                    fill = 0;
+                    processBlock();
+                }
+            }
+        }
+
+    private:
+        static constexpr std::size_t groupGrowth = 8;
+        static constexpr std::size_t maxPartitionSize = 16384;
+
+        struct Stage final
+        {
+            Stage(const float* impulseResponse, std::size_t length, std::size_t initOffset, std::size_t initSize):
+                offset{initOffset},
+                size{initSize},
+                partitions{(length + initSize - 1) / initSize},
+                bins{(initSize + 1 + 3) / 4 * 4},
+                fft{initSize * 2},
+                input(initSize * 2, 0.0F),
+                output(initSize * 2, 0.0F),
+                filterReal(partitions * bins, 0.0F),
+                filterImag(partitions * bins, 0.0F),
+                lineReal(partitions * bins, 0.0F),
+                lineImag(partitions * bins, 0.0F),
+                sumReal(bins, 0.0F),
+                sumImag(bins, 0.0F)
+            {
+                // the inverse FFT is not scaled, so the filters are
+                const auto scale = 1.0F / static_cast<float>(fft.getSize());
+
+                for (std::size_t partition = 0; partition < partitions; ++partition)
+                {
+                    std::fill(input.begin(), input.end(), 0.0F);
+                    const auto first = partition * size;
+                    const auto count = std::min(size, length - first);
+                    for (std::size_t i = 0; i < count; ++i)
+                        input[i] = impulseResponse[first + i] * scale;
+
+                    fft.forward(input.data(), filterReal.data() + partition * bins, filterImag.data() + partition * bins);
+                }
+
+                std::fill(input.begin(), input.end(), 0.0F);
+            }
+
+            void reset() noexcept
+            {
+                std::fill(input.begin(), input.end(), 0.0F);
+                std::fill(lineReal.begin(), lineReal.end(), 0.0F);
+                std::fill(lineImag.begin(), lineImag.end(), 0.0F);
+                fill = 0;
+                slot = 0;
+            }
+
+            // the second half of the input is the current block
+            void process() noexcept
+            {
+                fft.forward(input.data(), lineReal.data() + slot * bins, lineImag.data() + slot * bins);
+                std::copy(input.begin() + size, input.end(), input.begin());
+
+                std::fill(sumReal.begin(), sumReal.end(), 0.0F);
+                std::fill(sumImag.begin(), sumImag.end(), 0.0F);
+
+                // the newest block with the first partition, the oldest with the last
+                for (std::size_t partition = 0; partition < partitions; ++partition)
+                {
+                    const auto line = (slot + partitions - partition) % partitions * bins;
+                    const auto filter = partition * bins;
+
+                    for (std::size_t bin = 0; bin < bins; bin += 4)
+                    {
+                        const auto ar = Float4::load(lineReal.data() + line + bin);
+                        const auto ai = Float4::load(lineImag.data() + line + bin);
+                        const auto br = Float4::load(filterReal.data() + filter + bin);
+                        const auto bi = Float4::load(filterImag.data() + filter + bin);
+
+                        (Float4::load(sumReal.data() + bin) + ar * br - ai * bi).store(sumReal.data() + bin);
+                        (Float4::load(sumImag.data() + bin) + ar * bi + ai * br).store(sumImag.data() + bin);
+                    }
+                }
+
+                slot = (slot + 1) % partitions;
+
+                // the last half is free of the circular wrap-around
+                fft.inverse(sumReal.data(), sumImag.data(), output.data());
+            }
+
+            std::size_t offset; // in the impulse response
+            std::size_t size; // of a partition and of a block
+            std::size_t partitions;
+            std::size_t bins; // rounded up to the lanes
+
+            Fft fft;
+            SampleBuffer input;
+            SampleBuffer output;
+            SampleBuffer filterReal;
+            SampleBuffer filterImag;
+            SampleBuffer lineReal;
+            SampleBuffer lineImag;
+            SampleBuffer sumReal;
+            SampleBuffer sumImag;
+            std::size_t fill = 0;
+            std::size_t slot = 0;
+        };
+
+        void processBlock() noexcept
+        {
+            for (const auto& stage : stages)
+            {
+                std::copy(inputBlock.begin(), inputBlock.end(), stage->input.begin() + stage->size + stage->fill);
+                stage->fill += blockSize;
+                if (stage->fill < stage->size) continue;
+
+                stage->fill = 0;
+                stage->process();
+
+                // the stage block started this many frames ago
+                const auto start = time + blockSize - stage->size + stage->offset;
+                for (std::size_t i = 0; i < stage->size; ++i)
+                    accumulator[(start + i) & (accumulatorSize - 1)] += stage->output[stage->size + i];
+            }
+
+            // the block that has just been completed by all the stages
+            for (std::uint32_t i = 0; i < blockSize; ++i)
+            {
+                auto& value = accumulator[(time + i) & (accumulatorSize - 1)];
+                outputBlock[i] = value;
+                value = 0.0F;
+            }
+
+            time += blockSize;
+        }
+
+        std::uint32_t blockSize;
+        std::vector<std::unique_ptr<Stage>> stages;
+
+        SampleBuffer accumulator; // indexed by the frame modulo its size
+        std::size_t accumulatorSize = 0;
+        SampleBuffer inputBlock;
+        SampleBuffer outputBlock;
+        std::uint32_t fill = 0;
+        std::uint64_t time = 0; // the first frame of the current input block
+    };
+
+    // Convolves every channel with its own or a shared impulse response,
+    // delayed by the block size, which is the maximum block size of the
+    // processor rounded up to a power of two
+    class Convolution final: public Processor
+    {
+    public:
+        // interleaved with one channel or as many as the stream
+        Convolution(SampleBuffer initImpulseResponse, std::uint16_t initChannels, std::uint32_t initSampleRate):
+            impulseResponse(std::move(initImpulseResponse)),
+            impulseChannels{initChannels},
+            impulseSampleRate{initSampleRate}
+        {
+            if (impulseChannels == 0 || impulseResponse.size() % impulseChannels != 0)
+                throw std::runtime_error("Invalid impulse response");
+        }
+
+        void prepare(std::uint32_t sampleRate, std::uint32_t maxBlockSize, std::uint16_t channels) final
+        {
+            if (sampleRate != impulseSampleRate)
+                throw std::runtime_error("Sample rate of the impulse response does not match");
+
+            if (impulseChannels != 1 && impulseChannels != channels)
+                throw std::runtime_error("Channel count of the impulse response does not match");
+
+            std::uint32_t blockSize = 2;
+            while (blockSize < maxBlockSize) blockSize *= 2;
+
+            const auto length = impulseResponse.size() / impulseChannels;
+            SampleBuffer channelResponse(length);
+
+            convolvers.clear();
+            for (std::uint16_t channel = 0; channel < channels; ++channel)
+            {
+                const auto source = impulseChannels == 1 ? 0 : channel;
+                for (std::size_t i = 0; i < length; ++i)
+                    channelResponse[i] = impulseResponse[i * impulseChannels + source];
+
+                convolvers.push_back(std::make_unique<Convolver>(channelResponse.data(), length, blockSize));
+            }
+        }
+
+        void process(float* samples, std::uint32_t frames) noexcept final
+        {
+            const auto channels = convolvers.size();
+            for (std::size_t channel = 0; channel < channels; ++channel)
+                convolvers[channel]->process(samples + channel, channels, frames);
+        }
+
+        void reset() noexcept final
+        {
+            for (const auto& convolver : convolvers) convolver->reset();
+        }
+
+        std::uint32_t getLatency() const noexcept final
+        {
+            return convolvers.empty() ? 0 : convolvers.front()->getLatency();
+        }
+
+        std::uint32_t getTail() const noexcept final
+        {
+            return getLatency() + static_cast<std::uint32_t>(impulseResponse.size() / impulseChannels);
+        }
+
+    private:
+        SampleBuffer impulseResponse;
+        std::uint16_t impulseChannels;
+        std::uint32_t impulseSampleRate;
+        std::vector<std::unique_ptr<Convolver>> convolvers;
+    };
+}
+
+#endif // DSP_CONVOLUTION_HPP
@@ -0,0 +1,362 @@
+#ifndef DSP_EQUALIZER_HPP
+#define DSP_EQUALIZER_HPP
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "Biquad.hpp"
+#include "Float4.hpp"
+#include "Processor.hpp"
+
+namespace pcmplayer::dsp
+{
+    struct EqualizerBand final
+    {
+        enum class Type
+        {
+            peaking,
+            lowShelf,
+            highShelf,
+            highPass,
+            lowPass
+        };
+
+        Type type = Type::peaking;
+        float frequency = 1000.0F; // in Hz
+        float gain = 0.0F; // in dB, not used by the passes
+        float q = 0.70710678F;
+    };
+
+    // from the Audio EQ Cookbook by Robert Bristow-Johnson
+    inline BiquadCoefficients getCoefficients(const EqualizerBand& band, std::uint32_t sampleRate) noexcept
+    {
+        constexpr double pi = 3.14159265358979323846;
+
+        const double frequency = band.frequency < sampleRate * 0.49 ? band.frequency : sampleRate * 0.49;
+        const double omega = 2.0 * pi * frequency / sampleRate;
+        const double cosine = std::cos(omega);
+        const double alpha = std::sin(omega) / (2.0 * (band.q > 0.0F ? band.q : 0.01));
+        const double a = std::pow(10.0, band.gain / 40.0);
+        const double root = 2.0 * std::sqrt(a) * alpha;
+
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a0 = 1.0, a1 = 0.0, a2 = 0.0;
+
+        switch (band.type)
+        {
+            case EqualizerBand::Type::peaking:
+                b0 = 1.0 + alpha * a;
+                b1 = -2.0 * cosine;
+                b2 = 1.0 - alpha * a;
+                a0 = 1.0 + alpha / a;
+                a1 = -2.0 * cosine;
+                a2 = 1.0 - alpha / a;
+                break;
+            case EqualizerBand::Type::lowShelf:
+                b0 = a * ((a + 1.0) - (a - 1.0) * cosine + root);
+                b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosine);
+                b2 = a * ((a + 1.0) - (a - 1.0) * cosine - root);
+                a0 = (a + 1.0) + (a - 1.0) * cosine + root;
+                a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosine);
+                a2 = (a + 1.0) + (a - 1.0) * cosine - root;
+                break;
+            case EqualizerBand::Type::highShelf:
+                b0 = a * ((a + 1.0) + (a - 1.0) * cosine + root);
+                b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosine);
+                b2 = a * ((a + 1.0) + (a - 1.0) * cosine - root);
+                a0 = (a + 1.0) - (a - 1.0) * cosine + root;
+                a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosine);
+                a2 = (a + 1.0) - (a - 1.0) * cosine - root;
+                break;
+            case EqualizerBand::Type::highPass:
+                b0 = (1.0 + cosine) / 2.0;
+                b1 = -(1.0 + cosine);
+                b2 = (1.0 + cosine) / 2.0;
+                a0 = 1.0 + alpha;
+                a1 = -2.0 * cosine;
+                a2 = 1.0 - alpha;
+                break;
+            case EqualizerBand::Type::lowPass:
+                b0 = (1.0 - cosine) / 2.0;
+                b1 = 1.0 - cosine;
+                b2 = (1.0 - cosine) / 2.0;
+                a0 = 1.0 + alpha;
+                a1 = -2.0 * cosine;
+                a2 = 1.0 - alpha;
+                break;
+        }
+
+        return BiquadCoefficients{static_cast<float>(b0 / a0), static_cast<float>(b1 / a0), static_cast<float>(b2 / a0),
+                                  static_cast<float>(a1 / a0), static_cast<float>(a2 / a0)};
+    }
+
+    // Cascaded biquads with four channels in the lanes of every filter. The
+    // bands can be changed from any thread during the playback, the render
+    // thread picks the new coefficients up without locking (a sequence
+    // lock) and glides to them over the smoothing time.
+    class Equalizer final: public Processor
+    {
+    public:
+        explicit Equalizer(std::size_t initBandCount, float initSmoothingTime = 0.02F):
+            bandCount{initBandCount},
+            smoothingTime{initSmoothingTime},
+            bands(initBandCount)
+        {
+            if (bandCount == 0)
+                throw std::invalid_argument("Invalid band count");
+        }
+
+        std::size_t getBandCount() const noexcept { return bandCount; }
+
+        // sets the band of all the channels
+        void setBand(std::size_t index, const EqualizerBand& band)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (index >= bandCount)
+                throw std::out_of_range("Band out of range");
+
+            const auto bandChannels = bands.size() / bandCount;
+            for (std::size_t channel = 0; channel < bandChannels; ++channel)
+                bands[index * bandChannels + channel] = band;
+
+            publish();
+        }
+
+        // a band of one channel, only after prepare()
+        void setBand(std::size_t index, std::uint16_t channel, const EqualizerBand& band)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (index >= bandCount)
+                throw std::out_of_range("Band out of range");
+
+            if (channel >= channels)
+                throw std::out_of_range("Channel out of range");
+
+            bands[index * channels + channel] = band;
+
+            publish();
+        }
+
+        void prepare(std::uint32_t newSampleRate, std::uint32_t, std::uint16_t newChannels) final
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (newChannels == 0)
+                throw std::runtime_error("Invalid channel count");
+
+            // per channel from now on
+            std::vector<EqualizerBand> channelBands(bandCount * newChannels);
+            const auto bandChannels = bands.size() / bandCount;
+            for (std::size_t band = 0; band < bandCount; ++band)
+                for (std::uint16_t channel = 0; channel < newChannels; ++channel)
+                    channelBands[band * newChannels + channel] = bands[band * bandChannels + (channel < bandChannels ? channel : 0)];
+            bands = std::move(channelBands);
+
+            sampleRate = newSampleRate;
+            channels = newChannels;
+            groups = (channels + 3) / 4;
+
+            const auto size = bandCount * channels;
+            published = std::make_unique<std::atomic<float>[]>(size * 5);
+            current.resize(size);
+            target.resize(size);
+            pending.resize(size);
+            filters.assign(groups * bandCount, Biquad4{});
+            scratch.resize(subBlockSize);
+
+            smoothingFactor = smoothingTime > 0.0F ?
+                1.0F - std::exp(-static_cast<float>(subBlockSize) / (smoothingTime * static_cast<float>(sampleRate))) : 1.0F;
+
+            publish();
+            readSequence = sequence.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < size; ++i)
+                current[i] = target[i] = getCoefficients(bands[i], sampleRate);
+            smoothing = false;
+            updateFilters();
+        }
+
+        void reset() noexcept final
+        {
+            for (auto& filter : filters) filter.reset();
+        }
+
+        // the filters ring out well within a second
+        std::uint32_t getTail() const noexcept final { return sampleRate; }
+
+        void process(float* samples, std::uint32_t frames) noexcept final
+        {
+            for (std::uint32_t first = 0; first < frames; first += subBlockSize)
+            {
+                const auto count = frames - first < subBlockSize ? frames - first : subBlockSize;
+                const auto block = samples + static_cast<std::size_t>(first) * channels;
+
+                readTargets();
+                if (smoothing) smooth();
+
+                for (std::size_t group = 0; group < groups; ++group)
+                    processGroup(block, count, group);
+            }
+        }
+
+    private:
+        static constexpr std::uint32_t subBlockSize = 32; // in frames, the step of the smoothing
+        static constexpr float denormalGuard = 1e-20F;
+
+        void processGroup(float* block, std::uint32_t count, std::size_t group) noexcept
+        {
+            const auto firstChannel = group * 4;
+            const auto lanes = channels - firstChannel < 4 ? channels - firstChannel : 4;
+
+            for (std::uint32_t frame = 0; frame < count; ++frame)
+            {
+                const auto frameSamples = block + frame * channels + firstChannel;
+                if (lanes == 4)
+                    scratch[frame] = Float4::load(frameSamples);
+                else
+                {
+                    float values[4] = {};
+                    for (std::size_t lane = 0; lane < lanes; ++lane) values[lane] = frameSamples[lane];
+                    scratch[frame] = Float4::load(values);
+                }
+            }
+
+            // the guard keeps the states of decaying filters out of the denormals
+            const auto guard = Float4::broadcast(denormalGuard);
+            for (std::size_t band = 0; band < bandCount; ++band)
+            {
+                auto& filter = filters[group * bandCount + band];
+                for (std::uint32_t frame = 0; frame < count; ++frame)
+                    scratch[frame] = filter.process(scratch[frame] + guard);
+            }
+
+            for (std::uint32_t frame = 0; frame < count; ++frame)
+            {
+                const auto frameSamples = block + frame * channels + firstChannel;
+                if (lanes == 4)
+                    scratch[frame].store(frameSamples);
+                else
+                {
+                    float values[4];
+                    scratch[frame].store(values);
+                    for (std::size_t lane = 0; lane < lanes; ++lane) frameSamples[lane] = values[lane];
+                }
+            }
+        }
+
+        // with the mutex locked
+        void publish() noexcept
+        {
+            if (!published) return;
+
+            const auto currentSequence = sequence.load(std::memory_order_relaxed);
+            sequence.store(currentSequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for (std::size_t i = 0; i < bands.size(); ++i)
+            {
+                const auto coefficients = getCoefficients(bands[i], sampleRate);
+                published[i * 5 + 0].store(coefficients.b0, std::memory_order_relaxed);
+                published[i * 5 + 1].store(coefficients.b1, std::memory_order_relaxed);
+                published[i * 5 + 2].store(coefficients.b2, std::memory_order_relaxed);
+                published[i * 5 + 3].store(coefficients.a1, std::memory_order_relaxed);
+                published[i * 5 + 4].store(coefficients.a2, std::memory_order_relaxed);
+            }
+
+            sequence.store(currentSequence + 2, std::memory_order_release);
+        }
+
+        // a torn read is dropped and retried in the next sub-block
+        void readTargets() noexcept
+        {
+            const auto firstSequence = sequence.load(std::memory_order_acquire);
+            if (firstSequence == readSequence || (firstSequence & 1)) return;
+
+            for (std::size_t i = 0; i < pending.size(); ++i)
+            {
+                pending[i].b0 = published[i * 5 + 0].load(std::memory_order_relaxed);
+                pending[i].b1 = published[i * 5 + 1].load(std::memory_order_relaxed);
+                pending[i].b2 = published[i * 5 + 2].load(std::memory_order_relaxed);
+                pending[i].a1 = published[i * 5 + 3].load(std::memory_order_relaxed);
+                pending[i].a2 = published[i * 5 + 4].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            // the glide keeps going towards the last complete targets
+            if (sequence.load(std::memory_order_relaxed) != firstSequence) return;
+
+            target.swap(pending);
+            readSequence = firstSequence;
+            smoothing = true;
+        }
+
+        void smooth() noexcept
+        {
+            constexpr float epsilon = 1e-6F;
+            bool settled = true;
+
+            const auto step = [this, &settled](float& value, float goal) noexcept {
+                value += (goal - value) * smoothingFactor;
+                if (std::fabs(goal - value) > epsilon) settled = false;
+                else value = goal;
+            };
+
+            for (std::size_t i = 0; i < current.size(); ++i)
+            {
+                step(current[i].b0, target[i].b0);
+                step(current[i].b1, target[i].b1);
+                step(current[i].b2, target[i].b2);
+                step(current[i].a1, target[i].a1);
+                step(current[i].a2, target[i].a2);
+            }
+
+            smoothing = !settled;
+            updateFilters();
+        }
+
+        void updateFilters() noexcept
+        {
+            for (std::size_t group = 0; group < groups; ++group)
+                for (std::size_t band = 0; band < bandCount; ++band)
+                {
+                    BiquadCoefficients lanes[4];
+                    for (std::size_t lane = 0; lane < 4; ++lane)
+                    {
+                        const auto channel = group * 4 + lane;
+                        if (channel < channels) lanes[lane] = current[band * channels + channel];
+                    }
+                    filters[group * bandCount + band].setCoefficients(lanes);
+                }
+        }
+
+        std::size_t bandCount;
+        float smoothingTime; // in seconds
+
+        // owned by the control threads
+        std::mutex mutex;
+        std::vector<EqualizerBand> bands; // band major, per channel after prepare()
+        std::uint32_t sampleRate = 0;
+        std::uint16_t channels = 0;
+
+        std::atomic<std::uint32_t> sequence{0};
+        std::unique_ptr<std::atomic<float>[]> published;
+
+        // owned by the render thread
+        std::uint32_t readSequence = 0;
+        std::vector<BiquadCoefficients> current;
+        std::vector<BiquadCoefficients> target;
+        std::vector<BiquadCoefficients> pending; // read into, so a torn read leaves the targets alone
+        bool smoothing = false;
+        float smoothingFactor = 1.0F;
+        std::size_t groups = 0;
+        std::vector<Biquad4> filters;
+        std::vector<Float4> scratch;
+    };
+}
+
+#endif // DSP_EQUALIZER_HPP
@@ -0,0 +1,168 @@
+#ifndef DSP_FFT_HPP
+#define DSP_FFT_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "../SampleBuffer.hpp"
+
+namespace pcmplayer::dsp
+{
+    // Real FFT of a power of two size with the spectrum in separate real and
+    // imaginary arrays of size / 2 + 1 bins. The inverse is not scaled, so a
+    // round trip multiplies the samples by the size.
+    class Fft final
+    {
+    public:
+        explicit Fft(std::size_t initSize):
+            size{initSize},
+            half{initSize / 2}
+        {
+            if (size < 4 || (size & (size - 1)) != 0)
+                throw std::runtime_error("FFT size must be a power of two");
+
+            constexpr double pi = 3.14159265358979323846;
+
+            // twiddles of the half size complex FFT and of the real split
+            twiddleReal.resize(half / 2);
+            twiddleImag.resize(half / 2);
+            for (std::size_t i = 0; i < half / 2; ++i)
+            {
+                twiddleReal[i] = static_cast<float>(std::cos(2.0 * pi * i / half));
+                twiddleImag[i] = static_cast<float>(-std::sin(2.0 * pi * i / half));
+            }
+
+            splitReal.resize(half + 1);
+            splitImag.resize(half + 1);
+            for (std::size_t i = 0; i <= half; ++i)
+            {
+                splitReal[i] = static_cast<float>(std::cos(2.0 * pi * i / size));
+                splitImag[i] = static_cast<float>(-std::sin(2.0 * pi * i / size));
+            }
+
+            reversed.resize(half);
+            std::size_t bits = 0;
+            while ((std::size_t{1} << bits) < half) ++bits;
+            for (std::size_t i = 0; i < half; ++i)
+            {
+                std::size_t result = 0;
+                for (std::size_t bit = 0; bit < bits; ++bit)
+                    if (i & (std::size_t{1} << bit)) result |= std::size_t{1} << (bits - 1 - bit);
+                reversed[i] = static_cast<std::uint32_t>(result);
+            }
+
+            workReal.resize(half);
+            workImag.resize(half);
+        }
+
+        std::size_t getSize() const noexcept { return size; }
+        std::size_t getBins() const noexcept { return half + 1; }
+
+        // size samples to size / 2 + 1 bins, does not allocate
+        void forward(const float* input, float* real, float* imag) noexcept
+        {
+            // the even samples as the real and the odd ones as the imaginary part
+            for (std::size_t i = 0; i < half; ++i)
+            {
+                workReal[reversed[i]] = input[2 * i];
+                workImag[reversed[i]] = input[2 * i + 1];
+            }
+
+            transform(false);
+
+            real[0] = workReal[0] + workImag[0];
+            imag[0] = 0.0F;
+            real[half] = workReal[0] - workImag[0];
+            imag[half] = 0.0F;
+
+            for (std::size_t k = 1; k < half; ++k)
+            {
+                const auto zr = workReal[k];
+                const auto zi = workImag[k];
+                const auto cr = workReal[half - k];
+                const auto ci = -workImag[half - k];
+
+                // the spectra of the even and the odd samples
+                const auto evenReal = 0.5F * (zr + cr);
+                const auto evenImag = 0.5F * (zi + ci);
+                const auto oddReal = 0.5F * (zi - ci);
+                const auto oddImag = -0.5F * (zr - cr);
+
+                real[k] = evenReal + splitReal[k] * oddReal - splitImag[k] * oddImag;
+                imag[k] = evenImag + splitReal[k] * oddImag + splitImag[k] * oddReal;
+            }
+        }
+
+        // size / 2 + 1 bins to size samples, does not allocate
+        void inverse(const float* real, const float* imag, float* output) noexcept
+        {
+            for (std::size_t k = 0; k < half; ++k)
+            {
+                const auto xr = real[k];
+                const auto xi = imag[k];
+                const auto cr = real[half - k];
+                const auto ci = -imag[half - k];
+
+                const auto evenReal = xr + cr;
+                const auto evenImag = xi + ci;
+
+                // divided by the twiddle, which is on the unit circle
+                const auto differenceReal = xr - cr;
+                const auto differenceImag = xi - ci;
+                const auto oddReal = differenceReal * splitReal[k] + differenceImag * splitImag[k];
+                const auto oddImag = differenceImag * splitReal[k] - differenceReal * splitImag[k];
+
+                workReal[reversed[k]] = evenReal - oddImag;
+                workImag[reversed[k]] = evenImag + oddReal;
+            }
+
+            transform(true);
+
+            for (std::size_t i = 0; i < half; ++i)
+            {
+                output[2 * i] = workReal[i];
+                output[2 * i + 1] = workImag[i];
+            }
+        }
+
+    private:
+        // in place radix-2 on bit-reversed input
+        void transform(bool inverse) noexcept
+        {
+            const float sign = inverse ? -1.0F : 1.0F;
+
+            for (std::size_t length = 2; length <= half; length *= 2)
+            {
+                const auto step = half / length;
+                for (std::size_t first = 0; first < half; first += length)
+                    for (std::size_t i = 0; i < length / 2; ++i)
+                    {
+                        const auto wr = twiddleReal[i * step];
+                        const auto wi = sign * twiddleImag[i * step];
+                        const auto a = first + i;
+                        const auto b = a + length / 2;
+
+                        const auto tr = workReal[b] * wr - workImag[b] * wi;
+                        const auto ti = workReal[b] * wi + workImag[b] * wr;
+                        workReal[b] = workReal[a] - tr;
+                        workImag[b] = workImag[a] - ti;
+                        workReal[a] += tr;
+                        workImag[a] += ti;
+                    }
+            }
+        }
+
+        std::size_t size;
+        std::size_t half;
+        SampleBuffer twiddleReal;
+        SampleBuffer twiddleImag;
+        SampleBuffer splitReal;
+        SampleBuffer splitImag;
+        std::vector<std::uint32_t> reversed;
+        SampleBuffer workReal;
+        SampleBuffer workImag;
+    };
+}
+
+#endif // DSP_FFT_HPP
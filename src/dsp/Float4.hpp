@@ -0,0 +1,115 @@
+#ifndef DSP_FLOAT4_HPP
+#define DSP_FLOAT4_HPP
+
+#include <cstdint>
+#include <cstring>
+#include "../Simd.hpp"
+
+namespace pcmplayer::dsp
+{
+    // Four float lanes, e.g. four channels processed in parallel
+    struct Float4 final
+    {
+#if defined(PCMPLAYER_SSE2)
+        __m128 value;
+
+        static Float4 load(const float* source) noexcept { return {_mm_loadu_ps(source)}; }
+        static Float4 broadcast(float scalar) noexcept { return {_mm_set1_ps(scalar)}; }
+        void store(float* destination) const noexcept { _mm_storeu_ps(destination, value); }
+#elif defined(PCMPLAYER_NEON)
+        float32x4_t value;
+
+        static Float4 load(const float* source) noexcept { return {vld1q_f32(source)}; }
+        static Float4 broadcast(float scalar) noexcept { return {vdupq_n_f32(scalar)}; }
+        void store(float* destination) const noexcept { vst1q_f32(destination, value); }
+#else
+        float value[4];
+
+        static Float4 load(const float* source) noexcept { return {{source[0], source[1], source[2], source[3]}}; }
+        static Float4 broadcast(float scalar) noexcept { return {{scalar, scalar, scalar, scalar}}; }
+        void store(float* destination) const noexcept
+        {
+            for (int i = 0; i < 4; ++i) destination[i] = value[i];
+        }
+#endif
+
+        static Float4 zero() noexcept { return broadcast(0.0F); }
+    };
+
+#if defined(PCMPLAYER_SSE2)
+    inline Float4 operator+(Float4 a, Float4 b) noexcept { return {_mm_add_ps(a.value, b.value)}; }
+    inline Float4 operator-(Float4 a, Float4 b) noexcept { return {_mm_sub_ps(a.value, b.value)}; }
+    inline Float4 operator*(Float4 a, Float4 b) noexcept { return {_mm_mul_ps(a.value, b.value)}; }
+    inline Float4 maximum(Float4 a, Float4 b) noexcept { return {_mm_max_ps(a.value, b.value)}; }
+    inline Float4 minimum(Float4 a, Float4 b) noexcept { return {_mm_min_ps(a.value, b.value)}; }
+    inline Float4 abs(Float4 a) noexcept { return {_mm_andnot_ps(_mm_set1_ps(-0.0F), a.value)}; }
+    inline Float4 operator|(Float4 a, Float4 b) noexcept { return {_mm_or_ps(a.value, b.value)}; }
+#elif defined(PCMPLAYER_NEON)
+    inline Float4 operator+(Float4 a, Float4 b) noexcept { return {vaddq_f32(a.value, b.value)}; }
+    inline Float4 operator-(Float4 a, Float4 b) noexcept { return {vsubq_f32(a.value, b.value)}; }
+    inline Float4 operator*(Float4 a, Float4 b) noexcept { return {vmulq_f32(a.value, b.value)}; }
+    inline Float4 maximum(Float4 a, Float4 b) noexcept { return {vmaxq_f32(a.value, b.value)}; }
+    inline Float4 minimum(Float4 a, Float4 b) noexcept { return {vminq_f32(a.value, b.value)}; }
+    inline Float4 abs(Float4 a) noexcept { return {vabsq_f32(a.value)}; }
+    inline Float4 operator|(Float4 a, Float4 b) noexcept
+    {
+        return {vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.value), vreinterpretq_u32_f32(b.value)))};
+    }
+#else
+    inline Float4 operator+(Float4 a, Float4 b) noexcept
+    {
+        return {{a.value[0] + b.value[0], a.value[1] + b.value[1], a.value[2] + b.value[2], a.value[3] + b.value[3]}};
+    }
+
+    inline Float4 operator-(Float4 a, Float4 b) noexcept
+    {
+        return {{a.value[0] - b.value[0], a.value[1] - b.value[1], a.value[2] - b.value[2], a.value[3] - b.value[3]}};
+    }
+
+    inline Float4 operator*(Float4 a, Float4 b) noexcept
+    {
+        return {{a.value[0] * b.value[0], a.value[1] * b.value[1], a.value[2] * b.value[2], a.value[3] * b.value[3]}};
+    }
+
+    inline Float4 maximum(Float4 a, Float4 b) noexcept
+    {
+        Float4 result;
+        for (int i = 0; i < 4; ++i) result.value[i] = a.value[i] > b.value[i] ? a.value[i] : b.value[i];
+        return result;
+    }
+
+    inline Float4 minimum(Float4 a, Float4 b) noexcept
+    {
+        Float4 result;
+        for (int i = 0; i < 4; ++i) result.value[i] = a.value[i] < b.value[i] ? a.value[i] : b.value[i];
+        return result;
+    }
+
+    inline Float4 abs(Float4 a) noexcept
+    {
+        Float4 result;
+        for (int i = 0; i < 4; ++i) result.value[i] = a.value[i] < 0.0F ? -a.value[i] : a.value[i];
+        return result;
+    }
+
+    // of the bits
+    inline Float4 operator|(Float4 a, Float4 b) noexcept
+    {
+        Float4 result;
+        for (int i = 0; i < 4; ++i)
+        {
+            std::uint32_t x;
+            std::uint32_t y;
+            std::memcpy(&x, &a.value[i], sizeof(x));
+            std::memcpy(&y, &b.value[i], sizeof(y));
+            x |= y;
+            std::memcpy(&result.value[i], &x, sizeof(x));
+        }
+        return result;
+    }
+#endif
+
+    inline Float4& operator+=(Float4& a, Float4 b) noexcept { return a = a + b; }
+}
+
+#endif // DSP_FLOAT4_HPP
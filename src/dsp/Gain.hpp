@@ -0,0 +1,63 @@
+#ifndef DSP_GAIN_HPP
+#define DSP_GAIN_HPP
+
+#include <cstdint>
+#include "Float4.hpp"
+#include "Processor.hpp"
+
+namespace pcmplayer::dsp
+{
+    // Linear gain that ramps over a block when it changes
+    class Gain final: public Processor
+    {
+    public:
+        explicit Gain(float initGain = 1.0F) noexcept: gain{initGain}, currentGain{initGain} {}
+
+        // from any thread
+        void setGain(float newGain) noexcept { gain.set(newGain); }
+        float getGain() const noexcept { return gain.get(); }
+
+        void prepare(std::uint32_t, std::uint32_t, std::uint16_t newChannels) final
+        {
+            channels = newChannels;
+        }
+
+        void process(float* samples, std::uint32_t frames) noexcept final
+        {
+            const auto targetGain = gain.get();
+
+            if (targetGain != currentGain)
+            {
+                const auto step = (targetGain - currentGain) / static_cast<float>(frames);
+                for (std::uint32_t frame = 0; frame < frames; ++frame)
+                {
+                    currentGain += step;
+                    for (std::uint16_t channel = 0; channel < channels; ++channel)
+                        samples[frame * channels + channel] *= currentGain;
+                }
+                currentGain = targetGain;
+                return;
+            }
+
+            const auto factor = Float4::broadcast(currentGain);
+            const std::size_t sampleCount = static_cast<std::size_t>(frames) * channels;
+            std::size_t i = 0;
+            for (; i + 4 <= sampleCount; i += 4)
+                (Float4::load(samples + i) * factor).store(samples + i);
+            for (; i < sampleCount; ++i)
+                samples[i] *= currentGain;
+        }
+
+        void reset() noexcept final { currentGain = gain.get(); }
+
+        // silence in, silence out
+        std::uint32_t getTail() const noexcept final { return 0; }
+
+    private:
+        Parameter gain;
+        float currentGain;
+        std::uint16_t channels = 0;
+    };
+}
+
+#endif // DSP_GAIN_HPP
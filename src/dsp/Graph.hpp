@@ -0,0 +1,429 @@
+#ifndef DSP_GRAPH_HPP
+#define DSP_GRAPH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../RenderThread.hpp"
+#include "../SampleBuffer.hpp"
+#include "../Semaphore.hpp"
+#include "../Simd.hpp"
+#include "../Source.hpp"
+#include "Float4.hpp"
+#include "Processor.hpp"
+#include "Silence.hpp"
+
+namespace pcmplayer::dsp
+{
+    // A directed acyclic graph of sources, buses and processors whose
+    // output node is read like a source. Every block the render thread and
+    // a pool of workers run the nodes whose inputs are done, tracked by
+    // atomic counters of the unfinished inputs, so independent branches
+    // run on different cores.
+    class Graph final: public Source
+    {
+    public:
+        using Node = std::size_t;
+
+        explicit Graph(std::uint16_t initChannels, std::uint32_t initMaxBlockSize = 256):
+            channels{initChannels},
+            maxBlockSize{initMaxBlockSize}
+        {
+            if (channels == 0)
+                throw std::runtime_error("Invalid channel count");
+
+            if (maxBlockSize == 0)
+                throw std::runtime_error("Invalid block size");
+        }
+
+        ~Graph()
+        {
+            stopWorkers();
+        }
+
+        Graph(const Graph&) = delete;
+        Graph& operator=(const Graph&) = delete;
+
+        // the nodes and the connections must be added before prepare()
+
+        // reads the source, which must outlive the graph
+        Node addSource(Source& source)
+        {
+            return addNode(&source, nullptr);
+        }
+
+        // sums the inputs
+        Node addBus()
+        {
+            return addNode(nullptr, nullptr);
+        }
+
+        // sums the inputs and runs the processor on them, it must outlive the graph
+        Node addProcessor(Processor& processor)
+        {
+            return addNode(nullptr, &processor);
+        }
+
+        void connect(Node from, Node to, float gain = 1.0F)
+        {
+            if (from >= nodes.size() || to >= nodes.size() || from == to)
+                throw std::out_of_range("Invalid node");
+
+            if (nodes[to].source)
+                throw std::runtime_error("A source can not have inputs");
+
+            nodes[to].inputs.push_back(Input{from, gain});
+            nodes[from].outputs.push_back(to);
+        }
+
+        // Sorts the nodes, prepares the processors, allocates the buffers
+        // and starts the workers, none for running every node on the render
+        // thread. Without settings the workers take those of the player that
+        // plays the graph. If a worker can not be configured, every node runs
+        // on the render thread instead.
+        void prepare(std::uint32_t sampleRate, Node output, std::size_t workerCount,
+                     const std::optional<RenderThreadSettings>& workerSettings = std::nullopt)
+        {
+            if (output >= nodes.size())
+                throw std::out_of_range("Invalid node");
+
+            if (ready)
+                throw std::runtime_error("Graph is already prepared");
+
+            outputNode = output;
+            sort();
+
+            for (auto& node : nodes)
+            {
+                node.buffer.assign(static_cast<std::size_t>(maxBlockSize) * channels, 0.0F);
+                node.silent = true;
+                node.cleared = true;
+                node.gate.reset();
+                if (node.processor) node.processor->prepare(sampleRate, maxBlockSize, channels);
+            }
+
+            // the longest chain of processor latencies is played out after the end of the sources
+            std::vector<std::uint64_t> latencies(nodes.size(), 0);
+            for (const auto node : order)
+            {
+                for (const auto& input : nodes[node].inputs)
+                    latencies[node] = std::max(latencies[node], latencies[input.node]);
+                if (nodes[node].processor) latencies[node] += nodes[node].processor->getLatency();
+            }
+            flushFrames = latencies[outputNode];
+
+            ready = std::make_unique<std::atomic<Node>[]>(nodes.size());
+            pending = std::make_unique<std::atomic<std::size_t>[]>(nodes.size());
+
+            inheritSettings = !workerSettings;
+            startWorkers(workerCount, workerSettings ? *workerSettings : RenderThreadSettings{});
+        }
+
+        // restarts the workers with the settings if none were given to prepare()
+        void setRenderThreadSettings(const RenderThreadSettings& settings) final
+        {
+            if (!inheritSettings || workers.empty()) return;
+
+            // every worker on its own core, the memory is already locked for the whole process
+            auto workerSettings = settings;
+            workerSettings.cpu = -1;
+            workerSettings.lockMemory = false;
+
+            const auto workerCount = workers.size();
+            stopWorkers();
+            startWorkers(workerCount, workerSettings);
+        }
+
+        // the frames played out after the end of the sources
+        std::uint64_t getLatency() const noexcept { return flushFrames; }
+
+        // false if the workers have been stopped after an error
+        bool isParallel() const noexcept { return !workers.empty(); }
+
+        std::uint32_t read(float* output, std::uint32_t frames) noexcept final
+        {
+            std::uint32_t written = 0;
+
+            while (written < frames && !finished)
+            {
+                const auto count = frames - written < maxBlockSize ? frames - written : maxBlockSize;
+                auto rendered = renderBlock(count);
+
+                if (rendered < count && flushed < flushFrames)
+                {
+                    const auto flush = static_cast<std::uint32_t>(std::min<std::uint64_t>(count - rendered, flushFrames - flushed));
+                    rendered += flush;
+                    flushed += flush;
+                }
+
+                const auto& buffer = nodes[outputNode].buffer;
+                std::copy(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(rendered) * channels,
+                          output + static_cast<std::size_t>(written) * channels);
+                written += rendered;
+
+                if (rendered < count) finished = true;
+            }
+
+            return written;
+        }
+
+        bool isFinished() const noexcept final { return finished; }
+
+    private:
+        static constexpr Node none = std::numeric_limits<Node>::max();
+
+        struct Input final
+        {
+            Node node;
+            float gain;
+        };
+
+        struct NodeData final
+        {
+            Source* source = nullptr;
+            Processor* processor = nullptr;
+            std::vector<Input> inputs;
+            std::vector<Node> outputs;
+            SampleBuffer buffer;
+            std::uint32_t readFrames = 0; // of a source in the current block
+            bool silent = true; // the current block of the buffer
+            bool cleared = true; // the whole buffer
+            SilenceGate gate;
+        };
+
+        Node addNode(Source* source, Processor* processor)
+        {
+            if (ready)
+                throw std::runtime_error("Graph is already prepared");
+
+            nodes.emplace_back();
+            nodes.back().source = source;
+            nodes.back().processor = processor;
+            return nodes.size() - 1;
+        }
+
+        // the topological order, the nodes without inputs first
+        void sort()
+        {
+            std::vector<std::size_t> inputCounts(nodes.size());
+            for (std::size_t i = 0; i < nodes.size(); ++i)
+                inputCounts[i] = nodes[i].inputs.size();
+
+            order.clear();
+            for (std::size_t i = 0; i < nodes.size(); ++i)
+                if (inputCounts[i] == 0) order.push_back(i);
+
+            for (std::size_t i = 0; i < order.size(); ++i)
+                for (const auto next : nodes[order[i]].outputs)
+                    if (--inputCounts[next] == 0) order.push_back(next);
+
+            if (order.size() != nodes.size())
+                throw std::runtime_error("Graph has a cycle");
+
+            rootCount = 0;
+            while (rootCount < order.size() && nodes[order[rootCount]].inputs.empty()) ++rootCount;
+        }
+
+        // returns the frames up to the end of the last source
+        std::uint32_t renderBlock(std::uint32_t frames) noexcept
+        {
+            blockFrames = frames;
+
+            if (!isParallel())
+            {
+                for (const auto node : order) execute(node);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < nodes.size(); ++i)
+                {
+                    ready[i].store(none, std::memory_order_relaxed);
+                    pending[i].store(nodes[i].inputs.size(), std::memory_order_relaxed);
+                }
+
+                pushIndex.store(0, std::memory_order_relaxed);
+                remaining.store(nodes.size(), std::memory_order_relaxed);
+                for (std::size_t i = 0; i < rootCount; ++i) push(order[i]);
+
+                // publishes the reset to the workers that claim a node
+                popIndex.store(0, std::memory_order_release);
+
+                for (std::size_t i = 0; i < workers.size(); ++i) semaphore.signal();
+
+                work();
+
+                while (remaining.load(std::memory_order_acquire) != 0) pause();
+            }
+
+            bool hasSources = false;
+            std::uint32_t result = 0;
+            for (const auto& node : nodes)
+                if (node.source)
+                {
+                    hasSources = true;
+                    if (node.readFrames > result) result = node.readFrames;
+                }
+
+            return hasSources ? result : frames;
+        }
+
+        void startWorkers(std::size_t workerCount, const RenderThreadSettings& settings)
+        {
+            running = true;
+            for (std::size_t i = 0; i < workerCount; ++i)
+                workers.push_back(std::make_unique<RenderThread>(settings, [this]() { runWorker(); }));
+
+            // a worker that is not real-time would hold up a real-time render thread
+            for (std::size_t i = 0; i < workers.size(); ++i) started.wait();
+            for (const auto& worker : workers)
+                if (worker->getError())
+                {
+                    stopWorkers();
+                    break;
+                }
+        }
+
+        void runWorker() noexcept
+        {
+            started.signal();
+
+            for (;;)
+            {
+                semaphore.wait();
+                if (!running) break;
+
+                RenderScope renderScope;
+                work();
+            }
+        }
+
+        void stopWorkers() noexcept
+        {
+            running = false;
+            for (std::size_t i = 0; i < workers.size(); ++i) semaphore.signal();
+            workers.clear();
+        }
+
+        // runs the ready nodes until all of them have been claimed
+        void work() noexcept
+        {
+            for (;;)
+            {
+                const auto index = popIndex.fetch_add(1, std::memory_order_acq_rel);
+                if (index >= nodes.size()) return;
+
+                Node node;
+                while ((node = ready[index].load(std::memory_order_acquire)) == none) pause();
+
+                execute(node);
+
+                for (const auto next : nodes[node].outputs)
+                    if (pending[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        push(next);
+
+                remaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        void push(Node node) noexcept
+        {
+            const auto index = pushIndex.fetch_add(1, std::memory_order_relaxed);
+            ready[index].store(node, std::memory_order_release);
+        }
+
+        void execute(Node index) noexcept
+        {
+            auto& node = nodes[index];
+            const std::size_t sampleCount = static_cast<std::size_t>(blockFrames) * channels;
+            const auto buffer = node.buffer.data();
+
+            if (node.source)
+            {
+                node.readFrames = node.source->isFinished() ? 0 : node.source->read(buffer, blockFrames);
+                std::fill(buffer + static_cast<std::size_t>(node.readFrames) * channels, buffer + sampleCount, 0.0F);
+                node.silent = node.readFrames == 0 || isSilent(buffer, static_cast<std::size_t>(node.readFrames) * channels);
+                return;
+            }
+
+            // the silent inputs are not mixed
+            bool silent = true;
+            for (const auto& input : node.inputs)
+                if (!nodes[input.node].silent) silent = false;
+
+            if (silent)
+            {
+                if (!node.cleared) std::fill(node.buffer.begin(), node.buffer.end(), 0.0F);
+                node.cleared = true;
+            }
+            else
+            {
+                std::fill(buffer, buffer + sampleCount, 0.0F);
+                node.cleared = false;
+            }
+
+            for (const auto& input : node.inputs)
+            {
+                if (nodes[input.node].silent) continue;
+
+                const auto source = nodes[input.node].buffer.data();
+                const auto gain = Float4::broadcast(input.gain);
+
+                std::size_t i = 0;
+                for (; i + 4 <= sampleCount; i += 4)
+                    (Float4::load(buffer + i) + Float4::load(source + i) * gain).store(buffer + i);
+                for (; i < sampleCount; ++i)
+                    buffer[i] += source[i] * input.gain;
+            }
+
+            if (node.processor)
+            {
+                silent = node.gate.process(*node.processor, buffer, blockFrames, channels, silent);
+                if (!silent) node.cleared = false;
+            }
+
+            node.silent = silent;
+        }
+
+        static void pause() noexcept
+        {
+#if defined(PCMPLAYER_SSE2)
+            _mm_pause();
+#else
+            std::this_thread::yield();
+#endif
+        }
+
+        std::uint16_t channels;
+        std::uint32_t maxBlockSize;
+
+        std::vector<NodeData> nodes;
+        std::vector<Node> order;
+        std::size_t rootCount = 0;
+        Node outputNode = 0;
+        std::uint32_t blockFrames = 0;
+        std::uint64_t flushFrames = 0;
+        std::uint64_t flushed = 0;
+        bool finished = false;
+
+        // the nodes in the order they became ready, claimed by popIndex
+        std::unique_ptr<std::atomic<Node>[]> ready;
+        std::unique_ptr<std::atomic<std::size_t>[]> pending; // unfinished inputs of every node
+        std::atomic<std::size_t> pushIndex{0};
+        std::atomic<std::size_t> popIndex{std::numeric_limits<std::size_t>::max() / 2};
+        std::atomic<std::size_t> remaining{0};
+
+        std::atomic<bool> running{true};
+        Semaphore semaphore;
+        Semaphore started; // signaled by every worker once it has been configured
+        std::vector<std::unique_ptr<RenderThread>> workers;
+        bool inheritSettings = false;
+    };
+}
+
+#endif // DSP_GRAPH_HPP
@@ -0,0 +1,195 @@
+#ifndef DSP_LIMITER_HPP
+#define DSP_LIMITER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "../SampleBuffer.hpp"
+#include "Float4.hpp"
+#include "Processor.hpp"
+
+namespace pcmplayer::dsp
+{
+    struct LimiterSettings final
+    {
+        float threshold = 1.0F; // linear, the output never exceeds it
+        float lookahead = 0.005F; // in seconds, delays the output
+        float attack = 0.005F; // in seconds, at most the lookahead
+        float release = 0.05F; // in seconds
+    };
+
+    // Lookahead brickwall limiter with a gain shared by all the channels.
+    // The gain is held at the minimum needed over the lookahead window and
+    // ramped down over the attack, so it reaches the gain of a peak before
+    // the peak leaves the delay line.
+    class Limiter final: public Processor
+    {
+    public:
+        explicit Limiter(const LimiterSettings& initSettings):
+            settings{initSettings},
+            threshold{initSettings.threshold}
+        {
+            if (!(settings.threshold > 0.0F))
+                throw std::runtime_error("Invalid limiter threshold");
+        }
+
+        // from any thread, the lookahead and the attack are fixed at prepare()
+        void setThreshold(float newThreshold) noexcept
+        {
+            if (newThreshold > 0.0F) threshold.set(newThreshold);
+        }
+
+        void prepare(std::uint32_t sampleRate, std::uint32_t, std::uint16_t newChannels) final
+        {
+            if (newChannels == 0)
+                throw std::runtime_error("Invalid channel count");
+
+            channels = newChannels;
+            latency = toFrames(settings.lookahead, sampleRate);
+            window = latency + 1;
+            attackFrames = toFrames(settings.attack, sampleRate);
+            if (attackFrames < 1) attackFrames = 1;
+            if (attackFrames > window) attackFrames = window;
+            releaseCoefficient = settings.release > 0.0F ?
+                1.0F - std::exp(-1.0F / (settings.release * static_cast<float>(sampleRate))) : 1.0F;
+            tail = latency + attackFrames + toFrames(settings.release * 10.0F, sampleRate);
+
+            delayLine.assign(static_cast<std::size_t>(latency) * channels, 0.0F);
+            wedge.assign(window, Entry{0, 1.0F});
+            attackRing.assign(attackFrames, 1.0F);
+            gains.assign(static_cast<std::size_t>(blockSize) * channels, 1.0F);
+
+            reset();
+        }
+
+        // in frames
+        std::uint32_t getLatency() const noexcept final { return latency; }
+
+        // until the gain has recovered from the last peak
+        std::uint32_t getTail() const noexcept final { return tail; }
+
+        void reset() noexcept final
+        {
+            std::fill(delayLine.begin(), delayLine.end(), 0.0F);
+            delayPosition = 0;
+            wedgeFirst = 0;
+            wedgeSize = 0;
+            index = 0;
+            envelope = 1.0F;
+            std::fill(attackRing.begin(), attackRing.end(), 1.0F);
+            attackPosition = 0;
+            attackSum = attackFrames;
+        }
+
+        // in place on interleaved samples of any length
+        void process(float* samples, std::uint32_t frames) noexcept final
+        {
+            const auto currentThreshold = threshold.get();
+
+            for (std::uint32_t first = 0; first < frames; first += blockSize)
+            {
+                const auto count = frames - first < blockSize ? frames - first : blockSize;
+                const auto block = samples + static_cast<std::size_t>(first) * channels;
+
+                for (std::uint32_t frame = 0; frame < count; ++frame)
+                {
+                    const auto frameSamples = block + static_cast<std::size_t>(frame) * channels;
+
+                    float peak = 0.0F;
+                    for (std::uint16_t channel = 0; channel < channels; ++channel)
+                    {
+                        const auto value = std::fabs(frameSamples[channel]);
+                        if (value > peak) peak = value;
+                    }
+
+                    const auto gain = getGain(peak > currentThreshold ? currentThreshold / peak : 1.0F);
+                    std::fill(gains.begin() + frame * channels, gains.begin() + (frame + 1) * channels, gain);
+
+                    if (latency)
+                    {
+                        std::swap_ranges(frameSamples, frameSamples + channels,
+                                         delayLine.begin() + static_cast<std::size_t>(delayPosition) * channels);
+                        if (++delayPosition == latency) delayPosition = 0;
+                    }
+                }
+
+                const std::size_t sampleCount = static_cast<std::size_t>(count) * channels;
+                std::size_t i = 0;
+                for (; i + 4 <= sampleCount; i += 4)
+                    (Float4::load(block + i) * Float4::load(gains.data() + i)).store(block + i);
+                for (; i < sampleCount; ++i)
+                    block[i] *= gains[i];
+            }
+        }
+
+    private:
+        static constexpr std::uint32_t blockSize = 256; // in frames
+
+        struct Entry final
+        {
+            std::uint64_t index;
+            float gain;
+        };
+
+        static std::uint32_t toFrames(float seconds, std::uint32_t sampleRate) noexcept
+        {
+            return seconds > 0.0F ? static_cast<std::uint32_t>(seconds * static_cast<float>(sampleRate) + 0.5F) : 0;
+        }
+
+        // the gain of the frame leaving the delay line
+        float getGain(float required) noexcept
+        {
+            // the minimum over the window from a monotonic wedge, amortized O(1)
+            while (wedgeSize && wedge[(wedgeFirst + wedgeSize - 1) % window].gain >= required)
+                --wedgeSize;
+
+            if (wedgeSize && index - wedge[wedgeFirst].index >= window)
+            {
+                wedgeFirst = (wedgeFirst + 1) % window;
+                --wedgeSize;
+            }
+
+            wedge[(wedgeFirst + wedgeSize) % window] = Entry{index++, required};
+            ++wedgeSize;
+
+            const auto held = wedge[wedgeFirst].gain;
+            envelope = held < envelope ? held : envelope + (held - envelope) * releaseCoefficient;
+
+            // moving average over the attack, never above the held gain of the delayed frame
+            attackSum += envelope - attackRing[attackPosition];
+            attackRing[attackPosition] = envelope;
+            if (++attackPosition == attackFrames) attackPosition = 0;
+
+            return static_cast<float>(attackSum / attackFrames);
+        }
+
+        LimiterSettings settings;
+        Parameter threshold;
+
+        std::uint16_t channels = 0;
+        std::uint32_t latency = 0; // in frames
+        std::uint32_t tail = 0; // in frames
+        std::uint32_t window = 1; // in frames
+        std::uint32_t attackFrames = 1;
+        float releaseCoefficient = 1.0F;
+
+        SampleBuffer delayLine;
+        std::uint32_t delayPosition = 0;
+
+        std::vector<Entry> wedge;
+        std::uint32_t wedgeFirst = 0;
+        std::uint32_t wedgeSize = 0;
+        std::uint64_t index = 0;
+
+        float envelope = 1.0F;
+        SampleBuffer attackRing;
+        std::uint32_t attackPosition = 0;
+        double attackSum = 0.0;
+
+        SampleBuffer gains;
+    };
+}
+
+#endif // DSP_LIMITER_HPP
@@ -0,0 +1,85 @@
+#ifndef DSP_LOOKAHEADBUFFER_HPP
+#define DSP_LOOKAHEADBUFFER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include "../SampleBuffer.hpp"
+#include "../Source.hpp"
+
+namespace pcmplayer::dsp
+{
+    // A window of the frames of a source that is read ahead in large reads,
+    // for the processors that need the frames around their read position
+    class LookaheadBuffer final
+    {
+    public:
+        // the padding is the number of silent frames before the first one
+        LookaheadBuffer(Source& initSource, std::uint16_t initChannels, std::uint32_t initCapacity, std::uint32_t padding):
+            source{initSource},
+            channels{initChannels},
+            capacity{initCapacity},
+            buffer(static_cast<std::size_t>(initCapacity) * initChannels, 0.0F),
+            bufferStart{-static_cast<std::int64_t>(padding < initCapacity ? padding : initCapacity)},
+            bufferFrames{padding < initCapacity ? padding : initCapacity}
+        {
+        }
+
+        LookaheadBuffer(const LookaheadBuffer&) = delete;
+        LookaheadBuffer& operator=(const LookaheadBuffer&) = delete;
+
+        // Returns the frames from the first one on, silent after the end of
+        // the source. The first frame must not decrease between the calls
+        // and the count must not exceed the capacity.
+        const float* get(std::int64_t first, std::uint32_t count) noexcept
+        {
+            for (;;)
+            {
+                // the frames before the first one are not needed anymore
+                if (first > bufferStart)
+                {
+                    const auto discard = static_cast<std::uint32_t>(first - bufferStart < bufferFrames ? first - bufferStart : bufferFrames);
+                    std::copy(buffer.begin() + discard * channels, buffer.begin() + bufferFrames * channels, buffer.begin());
+                    bufferStart += discard;
+                    bufferFrames -= discard;
+                    if (bufferFrames == 0) bufferStart = first;
+                }
+
+                if (bufferStart + bufferFrames >= first + count) break;
+
+                const auto space = capacity - bufferFrames;
+                const auto destination = buffer.data() + static_cast<std::size_t>(bufferFrames) * channels;
+                const auto readFrames = ended ? 0 : source.read(destination, space);
+
+                if (readFrames < space)
+                {
+                    if (!ended) endFrame = bufferStart + bufferFrames + readFrames;
+                    ended = true;
+                    std::fill(destination + readFrames * channels, destination + space * channels, 0.0F);
+                }
+
+                bufferFrames += space;
+            }
+
+            return buffer.data() + static_cast<std::size_t>(first - bufferStart) * channels;
+        }
+
+        // true if the frame is after the end of the source, known only
+        // once a read has reached the end
+        bool hasEnded(std::int64_t frame) const noexcept
+        {
+            return ended && frame >= endFrame;
+        }
+
+    private:
+        Source& source;
+        std::uint16_t channels;
+        std::uint32_t capacity; // in frames
+        SampleBuffer buffer;
+        std::int64_t bufferStart; // the frame of the source at the start of the buffer
+        std::uint32_t bufferFrames;
+        bool ended = false;
+        std::int64_t endFrame = 0;
+    };
+}
+
+#endif // DSP_LOOKAHEADBUFFER_HPP
@@ -0,0 +1,453 @@
+#ifndef DSP_LOUDNESS_HPP
+#define DSP_LOUDNESS_HPP
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Biquad.hpp"
+#include "Float4.hpp"
+
+namespace pcmplayer::dsp
+{
+    // Pre-filter (a high shelf) and RLB high-pass of the K-weighting of ITU-R BS.1770
+    inline std::array<BiquadCoefficients, 2> getKWeighting(std::uint32_t sampleRate) noexcept
+    {
+        constexpr double pi = 3.14159265358979323846;
+        std::array<BiquadCoefficients, 2> result;
+
+        {
+            const double f0 = 1681.974450955533;
+            const double gain = 3.999843853973347;
+            const double q = 0.7071752369554196;
+
+            const double k = std::tan(pi * f0 / sampleRate);
+            const double vh = std::pow(10.0, gain / 20.0);
+            const double vb = std::pow(vh, 0.4996667741545416);
+            const double a0 = 1.0 + k / q + k * k;
+
+            result[0].b0 = static_cast<float>((vh + vb * k / q + k * k) / a0);
+            result[0].b1 = static_cast<float>(2.0 * (k * k - vh) / a0);
+            result[0].b2 = static_cast<float>((vh - vb * k / q + k * k) / a0);
+            result[0].a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+            result[0].a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+        }
+
+        {
+            const double f0 = 38.13547087602444;
+            const double q = 0.5003270373238773;
+
+            const double k = std::tan(pi * f0 / sampleRate);
+            const double a0 = 1.0 + k / q + k * k;
+
+            result[1].b0 = 1.0F;
+            result[1].b1 = -2.0F;
+            result[1].b2 = 1.0F;
+            result[1].a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+            result[1].a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+        }
+
+        return result;
+    }
+
+    // Finds the peaks between the samples by upsampling four times with a
+    // windowed-sinc polyphase filter, one signal per lane
+    class TruePeak4 final
+    {
+    public:
+        static constexpr std::size_t factor = 4;
+        static constexpr std::size_t tapsPerPhase = 13;
+
+        // returns the largest absolute value of the upsampled signal
+        Float4 process(Float4 input) noexcept
+        {
+            history[position] = input;
+            history[position + tapsPerPhase] = input;
+
+            const auto& coefficients = getCoefficients();
+
+            // the first phase only delays the input
+            auto peak = abs(history[position + tapsPerPhase / 2]);
+
+            for (std::size_t phase = 1; phase < factor; ++phase)
+            {
+                auto sum = Float4::zero();
+                for (std::size_t tap = 0; tap < tapsPerPhase; ++tap)
+                    sum += Float4::broadcast(coefficients[phase][tap]) * history[position + tap];
+                peak = maximum(peak, abs(sum));
+            }
+
+            position = position == 0 ? tapsPerPhase - 1 : position - 1;
+            return peak;
+        }
+
+    private:
+        using Coefficients = std::array<std::array<float, tapsPerPhase>, factor>;
+
+        static const Coefficients& getCoefficients() noexcept
+        {
+            static const Coefficients coefficients = []() noexcept {
+                constexpr double pi = 3.14159265358979323846;
+                constexpr std::size_t length = factor * (tapsPerPhase - 1) + 1;
+                constexpr double center = (length - 1) / 2.0;
+
+                Coefficients result{};
+                for (std::size_t phase = 0; phase < factor; ++phase)
+                {
+                    double sum = 0.0;
+                    for (std::size_t tap = 0; tap < tapsPerPhase && tap * factor + phase < length; ++tap)
+                    {
+                        const auto n = static_cast<double>(tap * factor + phase);
+                        const auto x = (n - center) / factor;
+                        const auto sinc = x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+                        const auto window = 0.42 - 0.5 * std::cos(2.0 * pi * n / (length - 1)) + 0.08 * std::cos(4.0 * pi * n / (length - 1));
+                        result[phase][tap] = static_cast<float>(sinc * window);
+                        sum += sinc * window;
+                    }
+
+                    // unity gain for every phase
+                    for (auto& coefficient : result[phase])
+                        coefficient = static_cast<float>(coefficient / sum);
+                }
+                return result;
+            }();
+
+            return coefficients;
+        }
+
+        // newest first from the position, stored twice to avoid wrapping
+        Float4 history[tapsPerPhase * 2] = {};
+        std::size_t position = 0;
+    };
+
+    // Loudness (ITU-R BS.1770-4 / EBU R128), true peak, sample peak and RMS of
+    // interleaved samples, fed in blocks of any size. The channels are
+    // filtered in SIMD lanes, four at a time.
+    class LoudnessMeter final
+    {
+    public:
+        LoudnessMeter(std::uint32_t initSampleRate, std::uint16_t initChannels):
+            sampleRate{initSampleRate},
+            channels{initChannels},
+            subBlockFrames{(initSampleRate + 5) / 10},
+            groups((initChannels + 3) / 4)
+        {
+            if (channels == 0)
+                throw std::runtime_error("Invalid channel count");
+            if (sampleRate == 0)
+                throw std::runtime_error("Invalid sample rate");
+
+            const auto kWeighting = getKWeighting(sampleRate);
+
+            for (std::size_t group = 0; group < groups.size(); ++group)
+            {
+                groups[group].shelf.setCoefficients(kWeighting[0]);
+                groups[group].highPass.setCoefficients(kWeighting[1]);
+
+                float weights[4];
+                for (std::size_t lane = 0; lane < 4; ++lane)
+                    weights[lane] = getChannelWeight(group * 4 + lane);
+                groups[group].weights = Float4::load(weights);
+            }
+        }
+
+        void process(const float* samples, std::size_t frames) noexcept
+        {
+            process(samples, frames, true);
+        }
+
+        // Flushes the true-peak filter at the end of the signal
+        void finish() noexcept
+        {
+            for (auto& group : groups)
+                for (std::size_t i = 0; i < TruePeak4::tapsPerPhase; ++i)
+                    group.truePeakValue = maximum(group.truePeakValue, group.truePeak.process(Float4::zero()));
+        }
+
+        // linear values, the largest of all channels
+        float getSamplePeak() const noexcept { return getPeak(samplePeak, &Group::samplePeak); }
+        float getTruePeak() const noexcept { return getPeak(truePeak, &Group::truePeakValue); }
+
+        // of the unweighted samples of all channels
+        float getRms() const noexcept
+        {
+            double sum = squares;
+            for (const auto& group : groups)
+                sum += getSum(group.squares);
+
+            const auto count = static_cast<double>(measuredFrames) * channels;
+            return count > 0.0 ? static_cast<float>(std::sqrt(sum / count)) : 0.0F;
+        }
+
+        // in LUFS, of the last 400 ms and 3 s
+        double getMomentaryLoudness() const noexcept { return getWindowLoudness(subBlocks.size(), momentaryBlocks); }
+        double getShortTermLoudness() const noexcept { return getWindowLoudness(subBlocks.size(), shortTermBlocks); }
+
+        double getMaxMomentaryLoudness() const noexcept { return getMaxLoudness(momentaryBlocks); }
+        double getMaxShortTermLoudness() const noexcept { return getMaxLoudness(shortTermBlocks); }
+
+        // Gated loudness of the whole signal in LUFS, -infinity if it is
+        // shorter than 400 ms or everything is below the absolute gate
+        double getIntegratedLoudness() const noexcept
+        {
+            constexpr double absoluteGate = -70.0;
+            constexpr double relativeGate = -10.0;
+
+            double sum = 0.0;
+            std::size_t count = 0;
+            for (std::size_t end = momentaryBlocks; end <= subBlocks.size(); ++end)
+                if (const auto power = getWindowPower(end, momentaryBlocks); getLoudness(power) > absoluteGate)
+                {
+                    sum += power;
+                    ++count;
+                }
+
+            if (count == 0) return -std::numeric_limits<double>::infinity();
+
+            const auto gate = getLoudness(sum / count) + relativeGate;
+
+            sum = 0.0;
+            count = 0;
+            for (std::size_t end = momentaryBlocks; end <= subBlocks.size(); ++end)
+                if (const auto power = getWindowPower(end, momentaryBlocks);
+                    getLoudness(power) > absoluteGate && getLoudness(power) > gate)
+                {
+                    sum += power;
+                    ++count;
+                }
+
+            return count ? getLoudness(sum / count) : -std::numeric_limits<double>::infinity();
+        }
+
+        // Continues with the measurement of the signal that directly follows,
+        // this meter must have stopped at the end of a 100 ms block
+        void append(const LoudnessMeter& next)
+        {
+            if (position != 0 || next.sampleRate != sampleRate || next.channels != channels)
+                throw std::runtime_error("Meters do not follow each other");
+
+            samplePeak = getSamplePeak() > next.samplePeak ? getSamplePeak() : next.samplePeak;
+            truePeak = getTruePeak() > next.truePeak ? getTruePeak() : next.truePeak;
+            squares += next.squares;
+            for (const auto& group : groups)
+                squares += getSum(group.squares);
+            measuredFrames += next.measuredFrames;
+
+            subBlocks.insert(subBlocks.end(), next.subBlocks.begin(), next.subBlocks.end());
+            groups = next.groups;
+            position = next.position;
+        }
+
+        // Measures a whole buffer, split into segments that are measured in parallel
+        static LoudnessMeter analyze(const float* samples, std::size_t frames,
+                                     std::uint32_t sampleRate, std::uint16_t channels,
+                                     std::size_t threadCount = 0)
+        {
+            if (threadCount == 0)
+                threadCount = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+
+            LoudnessMeter result(sampleRate, channels);
+            const std::size_t blockFrames = result.subBlockFrames;
+            const auto blockCount = (frames + blockFrames - 1) / blockFrames;
+            const auto segmentCount = blockCount < threadCount ? (blockCount ? blockCount : 1) : threadCount;
+            const auto segmentFrames = (blockCount + segmentCount - 1) / segmentCount * blockFrames;
+
+            // the filters settle on the samples before the segment
+            const std::size_t warmUpFrames = blockFrames;
+
+            std::vector<LoudnessMeter> meters(segmentCount, result);
+            std::vector<std::thread> threads;
+
+            for (std::size_t segment = 0; segment < segmentCount; ++segment)
+                threads.emplace_back([&meters, segment, samples, frames, channels, segmentFrames, warmUpFrames, segmentCount]() noexcept {
+                    const auto start = segment * segmentFrames < frames ? segment * segmentFrames : frames;
+                    const auto end = start + segmentFrames < frames ? start + segmentFrames : frames;
+                    const auto warmUpStart = start > warmUpFrames ? start - warmUpFrames : 0;
+
+                    auto& meter = meters[segment];
+                    meter.process(samples + warmUpStart * channels, start - warmUpStart, false);
+                    meter.process(samples + start * channels, end - start, true);
+                    if (segment == segmentCount - 1) meter.finish();
+                });
+
+            for (auto& thread : threads) thread.join();
+
+            result = meters.front();
+            for (std::size_t segment = 1; segment < segmentCount; ++segment)
+                result.append(meters[segment]);
+
+            return result;
+        }
+
+    private:
+        static constexpr std::size_t momentaryBlocks = 4; // of 100 ms
+        static constexpr std::size_t shortTermBlocks = 30;
+
+        struct Group final
+        {
+            Biquad4 shelf;
+            Biquad4 highPass;
+            TruePeak4 truePeak;
+            Float4 weights = Float4::zero();
+            Float4 energy = Float4::zero(); // of the current block
+            Float4 squares = Float4::zero(); // of the current block
+            Float4 samplePeak = Float4::zero();
+            Float4 truePeakValue = Float4::zero();
+        };
+
+        // channel weights of BS.1770 for the 5.1 channel order (L, R, C, LFE, Ls, Rs)
+        float getChannelWeight(std::size_t channel) const noexcept
+        {
+            if (channel >= channels) return 0.0F;
+            if (channels == 6 && channel == 3) return 0.0F;
+            if (channels == 6 && channel >= 4) return 1.41F;
+            return 1.0F;
+        }
+
+        static float getSum(Float4 value) noexcept
+        {
+            float lanes[4];
+            value.store(lanes);
+            return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+
+        float getPeak(float value, Float4 Group::*member) const noexcept
+        {
+            for (const auto& group : groups)
+            {
+                float lanes[4];
+                (group.*member).store(lanes);
+                for (const auto lane : lanes)
+                    if (lane > value) value = lane;
+            }
+            return value;
+        }
+
+        static double getLoudness(double power) noexcept
+        {
+            return -0.691 + 10.0 * std::log10(power);
+        }
+
+        // mean weighted power of the blocks that end before the end
+        double getWindowPower(std::size_t end, std::size_t blocks) const noexcept
+        {
+            const auto start = end > blocks ? end - blocks : 0;
+            double sum = 0.0;
+            for (auto block = start; block < end; ++block)
+                sum += subBlocks[block];
+            return end > start ? sum / (static_cast<double>(end - start) * subBlockFrames) : 0.0;
+        }
+
+        double getWindowLoudness(std::size_t end, std::size_t blocks) const noexcept
+        {
+            return getLoudness(getWindowPower(end, blocks));
+        }
+
+        // over the full windows, or a shorter one if there are not enough blocks
+        double getMaxLoudness(std::size_t blocks) const noexcept
+        {
+            if (subBlocks.size() < blocks)
+                return getWindowLoudness(subBlocks.size(), blocks);
+
+            double result = -std::numeric_limits<double>::infinity();
+            for (std::size_t end = blocks; end <= subBlocks.size(); ++end)
+                if (const auto loudness = getWindowLoudness(end, blocks); loudness > result)
+                    result = loudness;
+            return result;
+        }
+
+        // the filters run over unmeasured samples to settle
+        void process(const float* samples, std::size_t frames, bool measure) noexcept
+        {
+            while (frames > 0)
+            {
+                const auto count = subBlockFrames - position < frames ? subBlockFrames - position : frames;
+
+                for (std::size_t group = 0; group < groups.size(); ++group)
+                    processGroup(groups[group], samples + group * 4,
+                                 channels - group * 4 < 4 ? channels - group * 4 : 4, count, measure);
+
+                samples += count * channels;
+                frames -= count;
+
+                if (measure)
+                {
+                    measuredFrames += count;
+                    position += count;
+
+                    if (position == subBlockFrames)
+                    {
+                        double energy = 0.0;
+                        for (auto& group : groups)
+                        {
+                            energy += getSum(group.energy * group.weights);
+                            squares += getSum(group.squares);
+                            group.energy = Float4::zero();
+                            group.squares = Float4::zero();
+                        }
+
+                        subBlocks.push_back(energy);
+                        position = 0;
+                    }
+                }
+            }
+        }
+
+        void processGroup(Group& group, const float* samples, std::size_t laneCount,
+                          std::size_t frames, bool measure) noexcept
+        {
+            auto energy = group.energy;
+            auto squares = group.squares;
+            auto peak = group.samplePeak;
+            auto interpolatedPeak = group.truePeakValue;
+            float lanes[4] = {};
+
+            for (std::size_t frame = 0; frame < frames; ++frame)
+            {
+                const auto frameSamples = samples + frame * channels;
+
+                Float4 input;
+                if (laneCount == 4)
+                    input = Float4::load(frameSamples);
+                else
+                {
+                    for (std::size_t lane = 0; lane < laneCount; ++lane)
+                        lanes[lane] = frameSamples[lane];
+                    input = Float4::load(lanes);
+                }
+
+                const auto filtered = group.highPass.process(group.shelf.process(input));
+                const auto interpolated = group.truePeak.process(input);
+
+                if (measure)
+                {
+                    energy += filtered * filtered;
+                    squares += input * input;
+                    peak = maximum(peak, abs(input));
+                    interpolatedPeak = maximum(interpolatedPeak, interpolated);
+                }
+            }
+
+            group.energy = energy;
+            group.squares = squares;
+            group.samplePeak = peak;
+            group.truePeakValue = interpolatedPeak;
+        }
+
+        std::uint32_t sampleRate;
+        std::uint16_t channels;
+        std::uint32_t subBlockFrames; // 100 ms
+        std::vector<Group> groups;
+        std::vector<double> subBlocks; // weighted energy of every complete block
+        std::uint32_t position = 0; // in the current block
+        std::uint64_t measuredFrames = 0;
+        double squares = 0.0; // of the complete blocks
+        float samplePeak = 0.0F;
+        float truePeak = 0.0F;
+    };
+}
+
+#endif // DSP_LOUDNESS_HPP
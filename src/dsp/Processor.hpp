@@ -0,0 +1,54 @@
+#ifndef DSP_PROCESSOR_HPP
+#define DSP_PROCESSOR_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace pcmplayer::dsp
+{
+    // A value that any thread can set while the render thread reads it
+    class Parameter final
+    {
+    public:
+        explicit Parameter(float initValue = 0.0F) noexcept: value{initValue} {}
+
+        Parameter(const Parameter&) = delete;
+        Parameter& operator=(const Parameter&) = delete;
+
+        void set(float newValue) noexcept { value.store(newValue, std::memory_order_relaxed); }
+        float get() const noexcept { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<float> value;
+    };
+
+    // Processes blocks of interleaved float samples in place
+    class Processor
+    {
+    public:
+        virtual ~Processor() = default;
+
+        // Allocates everything the processing needs, called before the
+        // playback and not from the render thread
+        virtual void prepare(std::uint32_t sampleRate, std::uint32_t maxBlockSize, std::uint16_t channels) = 0;
+
+        // at most maxBlockSize frames, must not block or allocate
+        virtual void process(float* samples, std::uint32_t frames) noexcept = 0;
+
+        // clears the state before a new stream
+        virtual void reset() noexcept {}
+
+        // the delay of the output in frames
+        virtual std::uint32_t getLatency() const noexcept { return 0; }
+
+        // The frames after the input turned silent for which the output can
+        // still be non-silent, including the latency. Silent blocks are not
+        // processed after it, so the default of infiniteTail processes every
+        // block and the processors that know their tail opt in to skipping.
+        virtual std::uint32_t getTail() const noexcept { return infiniteTail; }
+
+        static constexpr std::uint32_t infiniteTail = ~std::uint32_t{0};
+    };
+}
+
+#endif // DSP_PROCESSOR_HPP
@@ -0,0 +1,86 @@
+#ifndef DSP_PROCESSORCHAIN_HPP
+#define DSP_PROCESSORCHAIN_HPP
+
+#include <cstdint>
+#include <vector>
+#include "Processor.hpp"
+#include "Silence.hpp"
+
+namespace pcmplayer::dsp
+{
+    // Runs the processors one after another on blocks of at most the
+    // prepared size, both from the render callback and offline
+    class ProcessorChain final
+    {
+    public:
+        // the processor must outlive the chain and is prepared by it
+        void add(Processor& processor)
+        {
+            processors.push_back(&processor);
+            gates.emplace_back();
+            if (maxBlockSize) processor.prepare(sampleRate, maxBlockSize, channels);
+        }
+
+        void prepare(std::uint32_t newSampleRate, std::uint32_t newMaxBlockSize, std::uint16_t newChannels)
+        {
+            sampleRate = newSampleRate;
+            maxBlockSize = newMaxBlockSize;
+            channels = newChannels;
+
+            for (const auto processor : processors)
+                processor->prepare(sampleRate, maxBlockSize, channels);
+        }
+
+        bool empty() const noexcept { return processors.empty(); }
+
+        // Any number of frames, split into blocks. The processors skip the
+        // silent blocks after their tail. Returns whether the result is
+        // silent, silent tells that the input is known to be.
+        bool process(float* samples, std::size_t frames, bool silent = false) noexcept
+        {
+            if (!maxBlockSize) return silent;
+
+            bool result = true;
+
+            for (std::size_t first = 0; first < frames; first += maxBlockSize)
+            {
+                const auto count = static_cast<std::uint32_t>(frames - first < maxBlockSize ? frames - first : maxBlockSize);
+                const auto block = samples + first * channels;
+
+                auto blockSilent = silent || isSilent(block, static_cast<std::size_t>(count) * channels);
+                for (std::size_t i = 0; i < processors.size(); ++i)
+                    blockSilent = gates[i].process(*processors[i], block, count, channels, blockSilent);
+
+                result = result && blockSilent;
+            }
+
+            return result;
+        }
+
+        void reset() noexcept
+        {
+            for (std::size_t i = 0; i < processors.size(); ++i)
+            {
+                processors[i]->reset();
+                gates[i].reset();
+            }
+        }
+
+        std::uint32_t getLatency() const noexcept
+        {
+            std::uint32_t latency = 0;
+            for (const auto processor : processors)
+                latency += processor->getLatency();
+            return latency;
+        }
+
+    private:
+        std::vector<Processor*> processors;
+        std::vector<SilenceGate> gates;
+        std::uint32_t sampleRate = 0;
+        std::uint32_t maxBlockSize = 0;
+        std::uint16_t channels = 0;
+    };
+}
+
+#endif // DSP_PROCESSORCHAIN_HPP
@@ -0,0 +1,67 @@
+#ifndef DSP_SILENCE_HPP
+#define DSP_SILENCE_HPP
+
+#include <cstdint>
+#include "Float4.hpp"
+#include "Processor.hpp"
+
+namespace pcmplayer::dsp
+{
+    // whether all the samples are zero, of either sign
+    inline bool isSilent(const float* samples, std::size_t count) noexcept
+    {
+        // or-ing the bits leaves a lane zero only if all its samples were
+        auto bits = Float4::zero();
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+            bits = bits | Float4::load(samples + i) | Float4::load(samples + i + 4) |
+                Float4::load(samples + i + 8) | Float4::load(samples + i + 12);
+        for (; i + 4 <= count; i += 4)
+            bits = bits | Float4::load(samples + i);
+
+        float lanes[4];
+        abs(bits).store(lanes);
+        if (lanes[0] != 0.0F || lanes[1] != 0.0F || lanes[2] != 0.0F || lanes[3] != 0.0F)
+            return false;
+
+        for (; i < count; ++i)
+            if (samples[i] != 0.0F) return false;
+
+        return true;
+    }
+
+    // Skips a processor once its input has been silent for longer than its
+    // tail, when its output is silent too
+    class SilenceGate final
+    {
+    public:
+        // returns whether the samples are silent after the processor
+        bool process(Processor& processor, float* samples, std::uint32_t frames,
+                     std::uint16_t channels, bool silent) noexcept
+        {
+            if (!silent)
+            {
+                silentFrames = 0;
+                processor.process(samples, frames);
+                return false;
+            }
+
+            const auto tail = processor.getTail();
+            if (tail != Processor::infiniteTail && silentFrames >= tail) return true;
+
+            silentFrames += frames;
+            processor.process(samples, frames);
+            return isSilent(samples, static_cast<std::size_t>(frames) * channels);
+        }
+
+        // the state of the processor has been cleared
+        void reset() noexcept { silentFrames = maxFrames; }
+
+    private:
+        static constexpr std::uint64_t maxFrames = ~std::uint64_t{0};
+
+        std::uint64_t silentFrames = maxFrames; // of the input in a row
+    };
+}
+
+#endif // DSP_SILENCE_HPP
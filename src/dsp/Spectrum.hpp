@@ -0,0 +1,95 @@
+#ifndef DSP_SPECTRUM_HPP
+#define DSP_SPECTRUM_HPP
+
+#include <cmath>
+#include <cstdint>
+#include "../SampleBuffer.hpp"
+#include "AnalysisTap.hpp"
+#include "Fft.hpp"
+
+namespace pcmplayer::dsp
+{
+    // The magnitude spectrum of the latest frames of an analysis tap, for a
+    // display on a thread other than the render thread. The channels are
+    // summed and Hann windowed, a full scale sine is at 0 dBFS.
+    class Spectrum final
+    {
+    public:
+        // a power of two size, size / 2 + 1 bins
+        explicit Spectrum(std::size_t size):
+            fft{size},
+            window(size),
+            input(size),
+            real(fft.getBins()),
+            imag(fft.getBins()),
+            magnitudes(fft.getBins(), minimum)
+        {
+            constexpr double pi = 3.14159265358979323846;
+            double sum = 0.0;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / size));
+                sum += window[i];
+            }
+
+            // a sine of amplitude one ends up in a bin with the half of the window sum
+            scale = static_cast<float>(2.0 / sum);
+        }
+
+        std::size_t getSize() const noexcept { return fft.getSize(); }
+        std::size_t getBins() const noexcept { return fft.getBins(); }
+
+        double getFrequency(std::size_t bin, std::uint32_t sampleRate) const noexcept
+        {
+            return static_cast<double>(bin) * sampleRate / static_cast<double>(fft.getSize());
+        }
+
+        // Takes the latest frames of the tap, returns false and keeps the
+        // previous magnitudes if there are not enough of them yet
+        bool update(const AnalysisTap& tap)
+        {
+            const auto channels = tap.getChannels();
+            const auto size = fft.getSize();
+            frames.resize(size * channels);
+
+            if (channels == 0 || !tap.copyLatest(frames.data(), static_cast<std::uint32_t>(size)))
+                return false;
+
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                float sum = 0.0F;
+                for (std::uint16_t channel = 0; channel < channels; ++channel)
+                    sum += frames[i * channels + channel];
+                input[i] = sum * window[i] / channels;
+            }
+
+            fft.forward(input.data(), real.data(), imag.data());
+
+            for (std::size_t bin = 0; bin < magnitudes.size(); ++bin)
+            {
+                const auto magnitude = std::sqrt(real[bin] * real[bin] + imag[bin] * imag[bin]) * scale;
+                const auto decibels = magnitude > 0.0F ? 20.0F * std::log10(magnitude) : minimum;
+                magnitudes[bin] = decibels > minimum ? decibels : minimum;
+            }
+
+            return true;
+        }
+
+        // in dBFS, at least the minimum
+        const SampleBuffer& getMagnitudes() const noexcept { return magnitudes; }
+
+        static constexpr float minimum = -144.0F;
+
+    private:
+        Fft fft;
+        SampleBuffer window;
+        SampleBuffer frames;
+        SampleBuffer input;
+        SampleBuffer real;
+        SampleBuffer imag;
+        SampleBuffer magnitudes;
+        float scale = 1.0F;
+    };
+}
+
+#endif // DSP_SPECTRUM_HPP
@@ -0,0 +1,220 @@
+#ifndef DSP_TIMESTRETCH_HPP
+#define DSP_TIMESTRETCH_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include "../SampleBuffer.hpp"
+#include "../Source.hpp"
+#include "Float4.hpp"
+#include "LookaheadBuffer.hpp"
+#include "Processor.hpp"
+
+namespace pcmplayer::dsp
+{
+    // Changes the tempo of a source without changing its pitch with WSOLA:
+    // Hann windowed grains overlap by a half, each one taken from around
+    // its nominal position where it best continues the previous grain
+    class TimeStretch final: public Source
+    {
+    public:
+        TimeStretch(Source& source, std::uint16_t initChannels, std::uint32_t sampleRate, float initMaxRate = 4.0F):
+            channels{initChannels},
+            maxRate{initMaxRate},
+            rate{1.0F},
+            grainSize{getGrainSize(sampleRate)},
+            hop{grainSize / 2},
+            tolerance{grainSize / 4},
+            input{source, initChannels,
+                  static_cast<std::uint32_t>(std::ceil(hop * (initMaxRate > 1.0F ? initMaxRate : 1.0F))) + 2 * tolerance + 2 * grainSize,
+                  hop + tolerance},
+            window(grainSize),
+            overlap(static_cast<std::size_t>(grainSize) * initChannels, 0.0F),
+            mix(2 * tolerance + grainSize, 0.0F),
+            pattern(hop, 0.0F)
+        {
+            if (channels == 0)
+                throw std::runtime_error("Invalid channel count");
+
+            if (!(maxRate > 0.0F))
+                throw std::runtime_error("Invalid maximum rate");
+
+            // a periodic Hann window sums to one at half overlap
+            constexpr double pi = 3.14159265358979323846;
+            for (std::uint32_t i = 0; i < grainSize; ++i)
+                window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / grainSize));
+        }
+
+        // from any thread, 2 plays twice as fast and 0 freezes
+        void setRate(float newRate) noexcept
+        {
+            rate.set(newRate < 0.0F ? 0.0F : newRate > maxRate ? maxRate : newRate);
+        }
+
+        float getRate() const noexcept { return rate.get(); }
+
+        std::uint32_t read(float* output, std::uint32_t frames) noexcept final
+        {
+            std::uint32_t written = 0;
+
+            while (written < frames)
+            {
+                if (readyFrames == 0)
+                {
+                    if (finished) break;
+                    addGrain();
+                }
+
+                const auto count = frames - written < readyFrames ? frames - written : readyFrames;
+                const auto first = static_cast<std::size_t>(hop - readyFrames) * channels;
+                std::copy(overlap.begin() + first, overlap.begin() + first + count * channels,
+                          output + static_cast<std::size_t>(written) * channels);
+
+                readyFrames -= count;
+                written += count;
+            }
+
+            return written;
+        }
+
+        bool isFinished() const noexcept final { return finished && readyFrames == 0; }
+
+    private:
+        // around 40 ms, a power of two
+        static std::uint32_t getGrainSize(std::uint32_t sampleRate) noexcept
+        {
+            std::uint32_t size = 256;
+            while (size < sampleRate / 25) size *= 2;
+            return size;
+        }
+
+        // overlaps the next grain and makes the first hop of the output ready
+        void addGrain() noexcept
+        {
+            // the previous ready hop was read, so shift the overlap
+            std::copy(overlap.begin() + static_cast<std::size_t>(hop) * channels, overlap.end(), overlap.begin());
+            std::fill(overlap.end() - static_cast<std::size_t>(hop) * channels, overlap.end(), 0.0F);
+
+            const auto target = static_cast<std::int64_t>(std::floor(nominal));
+
+            // ends once the center of the grain would be after the end of the source
+            if (input.hasEnded(target + hop))
+            {
+                // the tail of the last grain
+                finished = true;
+                readyFrames = hop;
+                return;
+            }
+
+            // the search range and the natural continuation of the previous grain
+            const auto searchFirst = target - tolerance;
+            const auto searchLast = searchFirst + 2 * tolerance + grainSize;
+            const auto first = started && previousStart + hop < searchFirst ? previousStart + hop : searchFirst;
+            const auto last = started && previousStart + 2 * hop > searchLast ? previousStart + 2 * hop : searchLast;
+            const auto samples = input.get(first, static_cast<std::uint32_t>(last - first));
+
+            auto start = target;
+            if (started)
+            {
+                downmix(samples + static_cast<std::size_t>(previousStart + hop - first) * channels, pattern.data(), hop);
+                downmix(samples + static_cast<std::size_t>(searchFirst - first) * channels, mix.data(), 2 * tolerance + grainSize);
+                start = searchFirst + findBestOffset();
+            }
+
+            const auto grain = samples + static_cast<std::size_t>(start - first) * channels;
+            for (std::uint32_t frame = 0; frame < grainSize; ++frame)
+                for (std::uint16_t channel = 0; channel < channels; ++channel)
+                    overlap[frame * channels + channel] += window[frame] * grain[frame * channels + channel];
+
+            // the first half of the first grain is before the start of the source
+            readyFrames = started ? hop : 0;
+            started = true;
+            previousStart = start;
+            nominal += hop * static_cast<double>(rate.get());
+        }
+
+        void downmix(const float* samples, float* result, std::uint32_t frames) const noexcept
+        {
+            for (std::uint32_t frame = 0; frame < frames; ++frame)
+            {
+                float sum = 0.0F;
+                for (std::uint16_t channel = 0; channel < channels; ++channel)
+                    sum += samples[frame * channels + channel];
+                result[frame] = sum;
+            }
+        }
+
+        // the offset in the search range with the highest normalized cross-correlation
+        std::uint32_t findBestOffset() const noexcept
+        {
+            const auto correlate = [this](std::uint32_t offset) noexcept {
+                auto product = Float4::zero();
+                auto energy = Float4::zero();
+                for (std::uint32_t i = 0; i < hop; i += 4)
+                {
+                    const auto candidate = Float4::load(mix.data() + offset + i);
+                    product += candidate * Float4::load(pattern.data() + i);
+                    energy += candidate * candidate;
+                }
+
+                float values[4];
+                product.store(values);
+                const auto sum = values[0] + values[1] + values[2] + values[3];
+                energy.store(values);
+                const auto norm = values[0] + values[1] + values[2] + values[3];
+                return sum / std::sqrt(norm + 1e-9F);
+            };
+
+            // a coarse search and a refinement around its result
+            std::uint32_t best = tolerance;
+            float bestScore = correlate(best);
+
+            for (std::uint32_t offset = 0; offset <= 2 * tolerance; offset += coarseStep)
+            {
+                const auto score = correlate(offset);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = offset;
+                }
+            }
+
+            const auto center = best;
+            for (std::uint32_t offset = center > coarseStep ? center - coarseStep + 1 : 0;
+                 offset < center + coarseStep && offset <= 2 * tolerance; ++offset)
+            {
+                const auto score = correlate(offset);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = offset;
+                }
+            }
+
+            return best;
+        }
+
+        static constexpr std::uint32_t coarseStep = 4;
+
+        std::uint16_t channels;
+        float maxRate;
+        Parameter rate;
+        std::uint32_t grainSize; // in frames
+        std::uint32_t hop; // in output frames
+        std::uint32_t tolerance; // in frames on each side of the nominal position
+        LookaheadBuffer input;
+
+        SampleBuffer window;
+        SampleBuffer overlap; // the output, the first hop is ready after a grain
+        SampleBuffer mix; // the search range down-mixed
+        SampleBuffer pattern;
+
+        double nominal = -static_cast<double>(hop); // the position of the next grain without the search
+        std::int64_t previousStart = 0;
+        std::uint32_t readyFrames = 0;
+        bool started = false;
+        bool finished = false;
+    };
+}
+
+#endif // DSP_TIMESTRETCH_HPP
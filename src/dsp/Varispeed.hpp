@@ -0,0 +1,143 @@
+#ifndef DSP_VARISPEED_HPP
+#define DSP_VARISPEED_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include "../SampleBuffer.hpp"
+#include "../Source.hpp"
+#include "LookaheadBuffer.hpp"
+#include "Processor.hpp"
+
+namespace pcmplayer::dsp
+{
+    // Plays a source at a variable speed with the pitch following it, like
+    // a tape. Resamples with a windowed-sinc kernel whose cutoff is lowered
+    // when playing faster, so the speed-up does not alias.
+    class Varispeed final: public Source
+    {
+    public:
+        Varispeed(Source& source, std::uint16_t initChannels, float initMaxSpeed = 4.0F):
+            channels{initChannels},
+            maxSpeed{initMaxSpeed},
+            speed{1.0F},
+            maxHalfWidth{static_cast<std::uint32_t>(std::ceil(halfTaps * (initMaxSpeed > 1.0F ? initMaxSpeed : 1.0F)))},
+            input{source, initChannels,
+                  static_cast<std::uint32_t>(std::ceil(chunkSize * initMaxSpeed)) + 2 * maxHalfWidth + 4,
+                  maxHalfWidth + 1},
+            kernel(halfTaps * resolution + 2)
+        {
+            if (channels == 0)
+                throw std::runtime_error("Invalid channel count");
+
+            if (!(maxSpeed > 0.0F))
+                throw std::runtime_error("Invalid maximum speed");
+
+            // a Blackman windowed sinc
+            constexpr double pi = 3.14159265358979323846;
+            for (std::size_t i = 0; i < kernel.size(); ++i)
+            {
+                const auto x = static_cast<double>(i) / resolution;
+                if (x >= halfTaps) continue;
+
+                const auto sinc = i == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+                const auto t = x / halfTaps;
+                const auto window = 0.42 + 0.5 * std::cos(pi * t) + 0.08 * std::cos(2.0 * pi * t);
+                kernel[i] = static_cast<float>(sinc * window);
+            }
+        }
+
+        // from any thread, 1 is the original speed and 0 pauses with silence
+        void setSpeed(float newSpeed) noexcept
+        {
+            speed.set(newSpeed < 0.0F ? 0.0F : newSpeed > maxSpeed ? maxSpeed : newSpeed);
+        }
+
+        float getSpeed() const noexcept { return speed.get(); }
+
+        // the frame of the source at the read position
+        double getPosition() const noexcept { return position; }
+
+        std::uint32_t read(float* output, std::uint32_t frames) noexcept final
+        {
+            const double currentSpeed = speed.get();
+            const double cutoff = currentSpeed > 1.0 ? 1.0 / currentSpeed : 1.0;
+            const double halfWidth = halfTaps / cutoff;
+
+            // holding the interpolated sample would be a DC level
+            if (currentSpeed == 0.0)
+            {
+                if (isFinished()) return 0;
+                std::fill(output, output + static_cast<std::size_t>(frames) * channels, 0.0F);
+                return frames;
+            }
+
+            std::uint32_t written = 0;
+
+            while (written < frames)
+            {
+                const auto count = frames - written < chunkSize ? frames - written : chunkSize;
+
+                // from the widest kernel, so the first frame does not decrease when the speed goes up
+                const auto first = static_cast<std::int64_t>(std::floor(position)) + 1 - maxHalfWidth;
+                const auto last = static_cast<std::int64_t>(std::floor(position + (count - 1) * currentSpeed + halfWidth));
+                const auto samples = input.get(first, static_cast<std::uint32_t>(last - first + 1));
+
+                for (std::uint32_t frame = 0; frame < count; ++frame)
+                {
+                    if (input.hasEnded(static_cast<std::int64_t>(std::floor(position)))) return written;
+
+                    const auto destination = output + static_cast<std::size_t>(written) * channels;
+                    for (std::uint16_t channel = 0; channel < channels; ++channel) destination[channel] = 0.0F;
+
+                    const auto tapFirst = static_cast<std::int64_t>(std::floor(position - halfWidth)) + 1;
+                    const auto tapLast = static_cast<std::int64_t>(std::floor(position + halfWidth));
+
+                    for (auto tap = tapFirst; tap <= tapLast; ++tap)
+                    {
+                        const auto weight = static_cast<float>(cutoff) * getKernel((static_cast<double>(tap) - position) * cutoff);
+                        const auto source = samples + static_cast<std::size_t>(tap - first) * channels;
+                        for (std::uint16_t channel = 0; channel < channels; ++channel)
+                            destination[channel] += weight * source[channel];
+                    }
+
+                    position += currentSpeed;
+                    ++written;
+                }
+            }
+
+            return written;
+        }
+
+        bool isFinished() const noexcept final
+        {
+            return input.hasEnded(static_cast<std::int64_t>(std::floor(position)));
+        }
+
+    private:
+        static constexpr std::uint32_t halfTaps = 8; // zero crossings on each side at the original speed
+        static constexpr std::uint32_t resolution = 512; // kernel values between two zero crossings
+        static constexpr std::uint32_t chunkSize = 64; // in output frames
+
+        float getKernel(double x) const noexcept
+        {
+            const auto index = (x < 0.0 ? -x : x) * resolution;
+            const auto whole = static_cast<std::size_t>(index);
+            if (whole + 1 >= kernel.size()) return 0.0F;
+
+            const auto fraction = static_cast<float>(index - static_cast<double>(whole));
+            return kernel[whole] + (kernel[whole + 1] - kernel[whole]) * fraction;
+        }
+
+        std::uint16_t channels;
+        float maxSpeed;
+        Parameter speed;
+        std::uint32_t maxHalfWidth; // in source frames
+        LookaheadBuffer input;
+        SampleBuffer kernel;
+        double position = 0.0; // in source frames
+    };
+}
+
+#endif // DSP_VARISPEED_HPP
@@ -1,13 +1,200 @@
+#include <cmath>
 #include <iostream>
 #include <fstream>
+#include <iomanip>
+#include <memory>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
+#include "Playlist.hpp"
+#include "SampleBuffer.hpp"
+#include "Trace.hpp"
 #include "Wav.hpp"
+#include "dsp/Convolution.hpp"
+#include "dsp/Equalizer.hpp"
+#include "dsp/Gain.hpp"
+#include "dsp/Loudness.hpp"
+#include "dsp/TimeStretch.hpp"
+#include "dsp/Varispeed.hpp"
+#include "null/NullAudioPlayer.hpp"
 #if defined(_WIN32)
 #  include "wasapi/WASAPIAudioPlayer.hpp"
 #  include "windows/Com.hpp"
-#else
+#elif defined(__APPLE__)
 #  include "coreaudio/CAAudioPlayer.hpp"
+#elif defined(__linux__)
+#  include "alsa/ALSAAudioPlayer.hpp"
+#  include "pulseaudio/PAAudioPlayer.hpp"
+#endif
+
+namespace
+{
+    class TraceFile final
+    {
+    public:
+        TraceFile() = default;
+        TraceFile(const TraceFile&) = delete;
+        TraceFile& operator=(const TraceFile&) = delete;
+
+        ~TraceFile()
+        {
+            if (!filename.empty())
+            {
+                std::ofstream file(filename, std::ios::trunc);
+                if (file)
+                    pcmplayer::trace::Tracer::getInstance().write(file);
+            }
+        }
+
+        void open(const std::string& newFilename)
+        {
+            filename = newFilename;
+            pcmplayer::trace::Tracer::getInstance().setEnabled(true);
+        }
+
+    private:
+        std::string filename;
+    };
+
+    constexpr auto defaultDriver =
+#if defined(_WIN32)
+        pcmplayer::Driver::wasapi;
+#elif defined(__APPLE__)
+        pcmplayer::Driver::coreAudio;
+#elif defined(__linux__)
+        pcmplayer::Driver::alsa;
+#else
+        pcmplayer::Driver::none;
+#endif
+
+    pcmplayer::Driver getDriver(const std::string& name)
+    {
+        if (name == "null") return pcmplayer::Driver::none;
+#if defined(_WIN32)
+        if (name == "wasapi") return pcmplayer::Driver::wasapi;
+#elif defined(__APPLE__)
+        if (name == "coreaudio") return pcmplayer::Driver::coreAudio;
+#elif defined(__linux__)
+        if (name == "alsa") return pcmplayer::Driver::alsa;
+        if (name == "pulseaudio") return pcmplayer::Driver::pulseAudio;
+#endif
+        throw std::runtime_error("Unsupported driver " + name);
+    }
+
+    pcmplayer::dsp::EqualizerBand::Type getEqualizerBandType(const std::string& name)
+    {
+        if (name == "peaking") return pcmplayer::dsp::EqualizerBand::Type::peaking;
+        if (name == "lowshelf") return pcmplayer::dsp::EqualizerBand::Type::lowShelf;
+        if (name == "highshelf") return pcmplayer::dsp::EqualizerBand::Type::highShelf;
+        if (name == "highpass") return pcmplayer::dsp::EqualizerBand::Type::highPass;
+        if (name == "lowpass") return pcmplayer::dsp::EqualizerBand::Type::lowPass;
+        throw std::runtime_error("Unsupported band type " + name);
+    }
+
+    pcmplayer::HugePages getHugePages(const std::string& name)
+    {
+        if (name == "none") return pcmplayer::HugePages::none;
+        if (name == "transparent") return pcmplayer::HugePages::transparent;
+        if (name == "explicit") return pcmplayer::HugePages::explicitPages;
+        throw std::runtime_error("Unsupported huge pages " + name);
+    }
+
+    std::vector<pcmplayer::AudioDevice> getAudioDevices(pcmplayer::Driver driver)
+    {
+        switch (driver)
+        {
+#if defined(_WIN32)
+            case pcmplayer::Driver::wasapi: return pcmplayer::wasapi::AudioPlayer::getAudioDevices();
+#elif defined(__APPLE__)
+            case pcmplayer::Driver::coreAudio: return pcmplayer::coreaudio::AudioPlayer::getAudioDevices();
+#elif defined(__linux__)
+            case pcmplayer::Driver::alsa: return pcmplayer::alsa::AudioPlayer::getAudioDevices();
+            case pcmplayer::Driver::pulseAudio: return pcmplayer::pulseaudio::AudioPlayer::getAudioDevices();
 #endif
+            case pcmplayer::Driver::none: return pcmplayer::null::AudioPlayer::getAudioDevices();
+            default: throw std::runtime_error("Unsupported driver");
+        }
+    }
+
+    std::unique_ptr<pcmplayer::AudioPlayer> createAudioPlayer(pcmplayer::Driver driver,
+                                                              pcmplayer::null::Sink& sink,
+                                                              pcmplayer::null::Pacing pacing,
+                                                              [[maybe_unused]] std::uint32_t audioDeviceId,
+                                                              std::uint32_t bufferSize,
+                                                              std::uint32_t sampleRate,
+                                                              pcmplayer::SampleFormat sampleFormat,
+                                                              std::uint16_t channels)
+    {
+        switch (driver)
+        {
+#if defined(_WIN32)
+            case pcmplayer::Driver::wasapi:
+                return std::make_unique<pcmplayer::wasapi::AudioPlayer>(audioDeviceId, bufferSize, sampleRate, sampleFormat, channels);
+#elif defined(__APPLE__)
+            case pcmplayer::Driver::coreAudio:
+                return std::make_unique<pcmplayer::coreaudio::AudioPlayer>(audioDeviceId, bufferSize, sampleRate, sampleFormat, channels);
+#elif defined(__linux__)
+            case pcmplayer::Driver::alsa:
+                return std::make_unique<pcmplayer::alsa::AudioPlayer>(audioDeviceId, bufferSize, sampleRate, sampleFormat, channels);
+            case pcmplayer::Driver::pulseAudio:
+                return std::make_unique<pcmplayer::pulseaudio::AudioPlayer>(audioDeviceId, bufferSize, sampleRate, sampleFormat, channels);
+#endif
+            case pcmplayer::Driver::none:
+                return std::make_unique<pcmplayer::null::AudioPlayer>(sink, pacing, bufferSize, sampleRate, sampleFormat, channels);
+            default: throw std::runtime_error("Unsupported driver");
+        }
+    }
+
+    void printPlayerMetrics(const pcmplayer::Metrics& metrics)
+    {
+        const auto callbacks = metrics.getCallbacks();
+
+        std::cout << "Callbacks: " << callbacks << '\n';
+        std::cout << "Frames rendered: " << metrics.getFramesRendered() << '\n';
+        std::cout << "Underruns: " << metrics.getUnderruns() << '\n';
+        std::cout << "Xruns: " << metrics.getXruns() << '\n';
+        std::cout << "Errors: " << metrics.getErrors() << '\n';
+        std::cout << "Missed deadlines: " << metrics.getMissedDeadlines() << '\n';
+        std::cout << "Load: " << metrics.getLoad() * 100.0 << "%\n";
+
+        if (callbacks)
+        {
+            std::cout << "Callback duration: avg " << metrics.getTotalDuration() / callbacks / 1000U <<
+                " us, max " << metrics.getMaxDuration() / 1000U <<
+                " us, budget " << metrics.getTotalBudget() / callbacks / 1000U << " us\n";
+            std::cout << "Wake-up jitter: avg " << metrics.getTotalJitter() / callbacks / 1000U <<
+                " us, max " << metrics.getMaxJitter() / 1000U << " us\n";
+        }
+
+        for (std::size_t bucket = 0; bucket < pcmplayer::Metrics::bucketCount; ++bucket)
+            if (const auto count = metrics.getHistogram(bucket))
+                std::cout << '<' << (2U << bucket) << " us:\t" << count << '\n';
+    }
+
+    void printLoudness(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Failed to open " + filename);
+
+        const Wav wav(file);
+        const auto meter = pcmplayer::dsp::LoudnessMeter::analyze(wav.getSamples().data(),
+                                                                  wav.getFrames(),
+                                                                  wav.getSampleRate(),
+                                                                  wav.getChannels());
+
+        const auto decibels = [](float value) { return 20.0 * std::log10(value); };
+
+        std::cout << filename << ":\n" << std::fixed << std::setprecision(1);
+        std::cout << "Integrated loudness: " << meter.getIntegratedLoudness() << " LUFS\n";
+        std::cout << "Maximum momentary loudness: " << meter.getMaxMomentaryLoudness() << " LUFS\n";
+        std::cout << "Maximum short-term loudness: " << meter.getMaxShortTermLoudness() << " LUFS\n";
+        std::cout << "Sample peak: " << decibels(meter.getSamplePeak()) << " dBFS\n";
+        std::cout << "True peak: " << decibels(meter.getTruePeak()) << " dBTP\n";
+        std::cout << "RMS: " << decibels(meter.getRms()) << " dBFS\n";
+    }
+}
 
 int main(int argc, char* argv[])
 {
@@ -15,6 +202,8 @@ int main(int argc, char* argv[])
     pcmplayer::Com com;
 #endif
 
+    TraceFile traceFile;
+
     try
     {
         enum class Output
@@ -23,10 +212,30 @@ int main(int argc, char* argv[])
             device
         };
         Output output = Output::device;
-        std::string inputFilename;
+        std::vector<std::string> inputFilenames;
+        std::uint32_t crossfade = 0; // in milliseconds
+        std::optional<std::uint32_t> loopCount;
+        float speed = 1.0F; // with the pitch
+        float tempo = 1.0F; // without the pitch
         std::string outputFilename;
         std::uint32_t outputDeviceId = 0;
-        std::size_t delay = 0;
+        pcmplayer::Driver driver = defaultDriver;
+        pcmplayer::null::Pacing pacing = pcmplayer::null::Pacing::realTime;
+        bool listDevices = false;
+        bool analyze = false;
+        std::uint64_t delay = 0; // in frames
+        bool printMetrics = false;
+        bool dither = false;
+        std::optional<float> limiterThreshold; // in dBFS
+        float gain = 0.0F; // in dB
+        std::string impulseResponseFilename;
+        std::vector<pcmplayer::dsp::EqualizerBand> equalizerBands;
+        bool bitExact = false;
+        std::uint32_t bufferSize = 512;
+        std::uint32_t minBufferSize = 0;
+        std::uint32_t maxBufferSize = 0;
+        pcmplayer::RenderThreadSettings renderThreadSettings;
+        bool configureRenderThread = false;
 
         for (int arg = 1; arg < argc; ++arg)
             if (std::string(argv[arg]) == "--help")
@@ -37,7 +246,7 @@ int main(int argc, char* argv[])
             else if (std::string(argv[arg]) == "--input")
             {
                 if (++arg >= argc) throw std::runtime_error("Expected a parameter");
-                inputFilename = argv[arg];
+                inputFilenames.push_back(argv[arg]);
             }
             else if (std::string(argv[arg]) == "--output-file")
             {
@@ -46,17 +255,16 @@ int main(int argc, char* argv[])
                 output = Output::file;
             }
             else if (std::string(argv[arg]) == "--devices")
+                listDevices = true;
+            else if (std::string(argv[arg]) == "--analyze")
+                analyze = true;
+            else if (std::string(argv[arg]) == "--driver")
             {
-#if defined(_WIN32)
-                const auto audioDevices = pcmplayer::wasapi::AudioPlayer::getAudioDevices();
-#else
-                const auto audioDevices = pcmplayer::coreaudio::AudioPlayer::getAudioDevices();
-#endif
-                for (const auto& audioDevice : audioDevices)
-                    std::cout << audioDevice.getId() << ":\t" << audioDevice.getName() << '\n';
-
-                return EXIT_SUCCESS;
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                driver = getDriver(argv[arg]);
             }
+            else if (std::string(argv[arg]) == "--fast")
+                pacing = pcmplayer::null::Pacing::asFastAsPossible;
             else if (std::string(argv[arg]) == "--output-device")
             {
                 if (++arg >= argc) throw std::runtime_error("Expected a parameter");
@@ -66,51 +274,305 @@ int main(int argc, char* argv[])
             else if (std::string(argv[arg]) == "--delay")
             {
                 if (++arg >= argc) throw std::runtime_error("Expected a parameter");
-                delay = static_cast<size_t>(std::stoi(argv[arg], nullptr, 10));
+                delay = std::stoull(argv[arg], nullptr, 10);
+            }
+            else if (std::string(argv[arg]) == "--loop")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                loopCount = static_cast<std::uint32_t>(std::stoi(argv[arg]));
+            }
+            else if (std::string(argv[arg]) == "--speed")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                speed = std::stof(argv[arg]);
+            }
+            else if (std::string(argv[arg]) == "--tempo")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                tempo = std::stof(argv[arg]);
+            }
+            else if (std::string(argv[arg]) == "--crossfade")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                crossfade = static_cast<std::uint32_t>(std::stoi(argv[arg]));
+            }
+            else if (std::string(argv[arg]) == "--buffer-size")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                bufferSize = static_cast<std::uint32_t>(std::stoi(argv[arg]));
+            }
+            else if (std::string(argv[arg]) == "--adaptive-buffer-size")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                minBufferSize = static_cast<std::uint32_t>(std::stoi(argv[arg]));
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                maxBufferSize = static_cast<std::uint32_t>(std::stoi(argv[arg]));
             }
+            else if (std::string(argv[arg]) == "--realtime")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                renderThreadSettings.policy = pcmplayer::RenderThreadSettings::Policy::fifo;
+                renderThreadSettings.priority = std::stoi(argv[arg]);
+                configureRenderThread = true;
+            }
+            else if (std::string(argv[arg]) == "--cpu")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                renderThreadSettings.cpu = std::stoi(argv[arg]);
+                configureRenderThread = true;
+            }
+            else if (std::string(argv[arg]) == "--lock-memory")
+            {
+                renderThreadSettings.lockMemory = true;
+                renderThreadSettings.stackPrefaultSize = 256 * 1024;
+                configureRenderThread = true;
+            }
+            else if (std::string(argv[arg]) == "--huge-pages")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                // before any sample buffer is allocated
+                pcmplayer::SampleAllocatorSettings allocatorSettings;
+                allocatorSettings.hugePages = getHugePages(argv[arg]);
+                pcmplayer::setSampleAllocatorSettings(allocatorSettings);
+            }
+            else if (std::string(argv[arg]) == "--dither")
+                dither = true;
+            else if (std::string(argv[arg]) == "--gain")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                gain = std::stof(argv[arg]);
+            }
+            else if (std::string(argv[arg]) == "--eq")
+            {
+                pcmplayer::dsp::EqualizerBand band;
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                band.type = getEqualizerBandType(argv[arg]);
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                band.frequency = std::stof(argv[arg]);
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                band.gain = std::stof(argv[arg]);
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                band.q = std::stof(argv[arg]);
+                equalizerBands.push_back(band);
+            }
+            else if (std::string(argv[arg]) == "--convolve")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                impulseResponseFilename = argv[arg];
+            }
+            else if (std::string(argv[arg]) == "--limiter")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                limiterThreshold = std::stof(argv[arg]);
+            }
+            else if (std::string(argv[arg]) == "--bit-exact")
+                bitExact = true;
+            else if (std::string(argv[arg]) == "--metrics")
+                printMetrics = true;
+            else if (std::string(argv[arg]) == "--trace")
+            {
+                if (++arg >= argc) throw std::runtime_error("Expected a parameter");
+                traceFile.open(argv[arg]);
+            }
+
+        if (listDevices)
+        {
+            for (const auto& audioDevice : getAudioDevices(driver))
+                std::cout << audioDevice.getId() << ":\t" << audioDevice.getName() << '\n';
+
+            return EXIT_SUCCESS;
+        }
 
-        if (inputFilename.empty())
+        if (inputFilenames.empty())
             throw std::runtime_error("Missing input");
 
-        std::ifstream inputFile(inputFilename, std::ios::binary);
+        if (analyze)
+        {
+            for (const auto& filename : inputFilenames)
+                printLoudness(filename);
+
+            return EXIT_SUCCESS;
+        }
+
+        // the first input sets the format of the whole playlist
+        std::ifstream inputFile(inputFilenames.front(), std::ios::binary);
         if (!inputFile)
-            throw std::runtime_error("Failed to open " + inputFilename);
+            throw std::runtime_error("Failed to open " + inputFilenames.front());
+
+        Wav input(inputFile, bitExact);
 
-        Wav input(inputFile);
-        std::vector<float> buffer(delay * input.getChannels());
-        buffer.insert(buffer.end(), input.getSamples().begin(), input.getSamples().end());
+        std::ofstream outputFile;
+        std::unique_ptr<pcmplayer::null::Sink> sink;
 
         if (output == Output::file)
         {
-            std::ofstream outputFile(outputFilename, std::ios::binary | std::ios::trunc);
+            // offline bounces are rendered by the null driver as fast as possible
+            outputFile.open(outputFilename, std::ios::binary | std::ios::trunc);
             if (!outputFile)
                 throw std::runtime_error("Failed to open " + outputFilename);
 
-            Wav output(input.getChannels(),
-                       input.getSampleRate(),
-                       static_cast<std::uint32_t>(buffer.size() / input.getChannels()),
-                       buffer);
-            output.save(outputFile);
+            sink = std::make_unique<pcmplayer::null::FileSink>(outputFile,
+                                                               input.getSampleFormat(),
+                                                               input.getChannels(),
+                                                               input.getSampleRate());
+            driver = pcmplayer::Driver::none;
+            pacing = pcmplayer::null::Pacing::asFastAsPossible;
+        }
+        else
+            sink = std::make_unique<pcmplayer::null::DiscardSink>();
 
+        // the processors outlive the player that uses them
+        pcmplayer::dsp::Gain gainProcessor(std::pow(10.0F, gain / 20.0F));
+        std::unique_ptr<pcmplayer::dsp::Convolution> convolution;
+        std::unique_ptr<pcmplayer::dsp::Equalizer> equalizer;
+        if (!equalizerBands.empty())
+        {
+            equalizer = std::make_unique<pcmplayer::dsp::Equalizer>(equalizerBands.size());
+            for (std::size_t band = 0; band < equalizerBands.size(); ++band)
+                equalizer->setBand(band, equalizerBands[band]);
         }
-        else if (output == Output::device)
+
+        if (!impulseResponseFilename.empty())
         {
-#if defined(_WIN32)
-            pcmplayer::wasapi::AudioPlayer audioPlayer(outputDeviceId,
-                                                       512,
-                                                       input.getSampleRate(),
-                                                       pcmplayer::SampleFormat::float32,
-                                                       input.getChannels());
-#else
-            pcmplayer::coreaudio::AudioPlayer audioPlayer(outputDeviceId,
-                                                          512,
-                                                          input.getSampleRate(),
-                                                          pcmplayer::SampleFormat::float32,
-                                                          input.getChannels());
-#endif
+            std::ifstream impulseResponseFile(impulseResponseFilename, std::ios::binary);
+            if (!impulseResponseFile)
+                throw std::runtime_error("Failed to open " + impulseResponseFilename);
 
-            audioPlayer.play(buffer);
+            Wav impulseResponse(impulseResponseFile);
+            convolution = std::make_unique<pcmplayer::dsp::Convolution>(std::move(impulseResponse.getSamples()),
+                                                                        impulseResponse.getChannels(),
+                                                                        impulseResponse.getSampleRate());
         }
+
+        const auto audioPlayer = createAudioPlayer(driver,
+                                                   *sink,
+                                                   pacing,
+                                                   outputDeviceId,
+                                                   maxBufferSize ? maxBufferSize : bufferSize,
+                                                   input.getSampleRate(),
+                                                   input.getSampleFormat(),
+                                                   input.getChannels());
+
+        audioPlayer->setDither(dither);
+
+        if (gain != 0.0F)
+            audioPlayer->addProcessor(gainProcessor);
+
+        if (equalizer)
+            audioPlayer->addProcessor(*equalizer);
+
+        if (convolution)
+            audioPlayer->addProcessor(*convolution);
+
+        if (limiterThreshold)
+        {
+            pcmplayer::dsp::LimiterSettings limiterSettings;
+            limiterSettings.threshold = std::pow(10.0F, *limiterThreshold / 20.0F);
+            audioPlayer->setLimiter(limiterSettings);
+        }
+
+        audioPlayer->setStartFrame(delay);
+
+        // the first loop of the smpl chunk or the whole input, 0 loops indefinitely
+        pcmplayer::Loop loop;
+        if (loopCount)
+        {
+            loop = pcmplayer::Loop{0, input.getFrames(), *loopCount};
+            if (!input.getLoops().empty())
+            {
+                loop.start = static_cast<std::size_t>(input.getLoops().front().start);
+                loop.end = static_cast<std::size_t>(input.getLoops().front().end);
+            }
+            audioPlayer->setLoop(loop);
+        }
+
+        if (configureRenderThread)
+            audioPlayer->setRenderThreadSettings(renderThreadSettings);
+
+        if (maxBufferSize)
+            audioPlayer->setAdaptiveBufferSize(minBufferSize, maxBufferSize);
+
+        if (bitExact && inputFilenames.size() > 1)
+        {
+            std::cerr << "Bit-exact playback of a playlist is not supported, converting\n";
+            bitExact = false;
+        }
+
+        if (bitExact && (speed != 1.0F || tempo != 1.0F))
+        {
+            std::cerr << "Bit-exact playback at a different speed is not supported, converting\n";
+            bitExact = false;
+        }
+
+        if (bitExact && audioPlayer->getSampleFormat() != input.getSampleFormat())
+        {
+            std::cerr << "Device does not support the sample format of the input, converting\n";
+            bitExact = false;
+        }
+
+        // plays the source through the speed and the tempo changes
+        const auto play = [&audioPlayer, &input, speed, tempo](pcmplayer::Source& source) {
+            std::optional<pcmplayer::dsp::Varispeed> varispeed;
+            std::optional<pcmplayer::dsp::TimeStretch> timeStretch;
+            pcmplayer::Source* playedSource = &source;
+
+            if (speed != 1.0F)
+            {
+                varispeed.emplace(*playedSource, input.getChannels(), speed > 4.0F ? speed : 4.0F);
+                varispeed->setSpeed(speed);
+                playedSource = &*varispeed;
+            }
+
+            if (tempo != 1.0F)
+            {
+                timeStretch.emplace(*playedSource, input.getChannels(), input.getSampleRate(), tempo > 4.0F ? tempo : 4.0F);
+                timeStretch->setRate(tempo);
+                playedSource = &*timeStretch;
+            }
+
+            audioPlayer->play(*playedSource);
+        };
+
+        if (inputFilenames.size() > 1)
+        {
+            pcmplayer::Playlist playlist(input.getChannels());
+            playlist.setCrossfadeFrames(static_cast<std::uint32_t>(std::uint64_t(crossfade) * input.getSampleRate() / 1000));
+            playlist.setWaitForDecoder(output == Output::file);
+
+            for (const auto& filename : inputFilenames)
+                playlist.add([filename, channels = input.getChannels(), sampleRate = input.getSampleRate()]() {
+                    std::ifstream file(filename, std::ios::binary);
+                    if (!file)
+                        throw std::runtime_error("Failed to open " + filename);
+
+                    Wav wav(file);
+                    if (wav.getChannels() != channels || wav.getSampleRate() != sampleRate)
+                        throw std::runtime_error("Format of " + filename + " does not match the playlist");
+
+                    return wav.getSamples();
+                });
+
+            play(playlist);
+
+            if (playlist.getFailedItems())
+                std::cerr << "Failed to decode " << playlist.getFailedItems() << " items\n";
+        }
+        else if (bitExact)
+            audioPlayer->playBitExact(input.getData(), input.getSampleFormat());
+        else if (speed != 1.0F || tempo != 1.0F)
+        {
+            pcmplayer::BufferSource source(input.getSamples(), input.getChannels());
+            source.setLoop(loop);
+            play(source);
+        }
+        else
+            audioPlayer->play(input.getSamples());
+
+        if (const auto error = audioPlayer->getRenderThreadError())
+            std::cerr << "Failed to configure the render thread: " << error.message() << '\n';
+
+        if (printMetrics)
+            printPlayerMetrics(audioPlayer->getMetrics());
     }
     catch (const std::exception& exception)
     {
@@ -118,10 +580,5 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    // TODO: pass PCM data to callback
-    // TODO: add delay
-
-    // TODO: save to WAV file
-
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <thread>
+#include "NullAudioPlayer.hpp"
+
+namespace pcmplayer::null
+{
+    AudioPlayer::AudioPlayer(Sink& initSink,
+                             Pacing initPacing,
+                             std::uint32_t initBufferSize,
+                             std::uint32_t initSampleRate,
+                             SampleFormat initSampleFormat,
+                             std::uint16_t initChannels):
+        pcmplayer::AudioPlayer(Driver::none, initBufferSize, initSampleRate, initSampleFormat, initChannels),
+        sink{initSink},
+        pacing{initPacing}
+    {
+        if (bufferSize == 0)
+            throw std::runtime_error("Invalid buffer size");
+
+        // the null device accepts every sample format
+        buffer.resize(static_cast<std::size_t>(bufferSize) * channels * getSampleSize(sampleFormat));
+    }
+
+    void AudioPlayer::start()
+    {
+        startStream();
+        run();
+    }
+
+    void AudioPlayer::stop()
+    {
+        running = false;
+    }
+
+    void AudioPlayer::startStream()
+    {
+        startTime = std::chrono::steady_clock::now();
+        running = true;
+    }
+
+    void AudioPlayer::stopStream()
+    {
+        running = false;
+    }
+
+    void AudioPlayer::setBufferSize(std::uint32_t newBufferSize)
+    {
+        // the buffer is only allocated for the largest size
+        const std::size_t frameSize = static_cast<std::size_t>(channels) * getSampleSize(sampleFormat);
+        if (newBufferSize == 0 || newBufferSize * frameSize > buffer.size())
+            throw std::runtime_error("Invalid buffer size");
+
+        bufferSize = newBufferSize;
+    }
+
+    std::chrono::steady_clock::time_point AudioPlayer::getDeadline() const noexcept
+    {
+        if (pacing == Pacing::asFastAsPossible)
+            return std::chrono::steady_clock::time_point::min();
+
+        // when the device would have played out the previous buffer
+        const std::chrono::duration<double> position(static_cast<double>(getClock()) / sampleRate);
+        return startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(position);
+    }
+
+    bool AudioPlayer::process(WakeupHandle*, std::size_t)
+    {
+        const auto callbackStart = metrics.beginCallback();
+        trace::Scope scope("Null::render");
+        RenderScope renderScope;
+
+        const auto frames = bufferSize;
+        const std::size_t frameSize = static_cast<std::size_t>(channels) * getSampleSize(sampleFormat);
+
+        // the silence after the end of the data is not written
+        const auto firstFrame = getRenderedFrames();
+        const bool hasMoreData = render(frames, buffer.data());
+        sink.write(buffer.data(), (hasMoreData ? frames : getEndFrame() - firstFrame) * frameSize);
+        clock.store(getClock() + frames, std::memory_order_relaxed);
+
+        // the sink consumes the frames right away
+        publishPlaybackPosition(0);
+
+        metrics.endCallback(callbackStart, frames);
+
+        if (hasMoreData)
+            adaptBufferSize();
+
+        return hasMoreData;
+    }
+
+    void AudioPlayer::run()
+    {
+        prepareRenderThread();
+
+        while (running)
+        {
+            if (pacing == Pacing::realTime)
+                std::this_thread::sleep_until(getDeadline());
+
+            if (!process(nullptr, 0))
+                running = false;
+        }
+    }
+
+    std::vector<AudioDevice> AudioPlayer::getAudioDevices()
+    {
+        return {AudioDevice{0, "Null device"}};
+    }
+}
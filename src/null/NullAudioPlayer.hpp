@@ -0,0 +1,60 @@
+#ifndef NULLAUDIOPLAYER_HPP
+#define NULLAUDIOPLAYER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "../AudioPlayer.hpp"
+#include "../AudioDevice.hpp"
+#include "../SampleBuffer.hpp"
+#include "../Scheduler.hpp"
+#include "NullSink.hpp"
+
+namespace pcmplayer::null
+{
+    enum class Pacing
+    {
+        realTime, // one buffer per period of the virtual clock
+        asFastAsPossible
+    };
+
+    // Renders to a sink instead of a device, driven by a virtual clock
+    class AudioPlayer final: public pcmplayer::AudioPlayer, public ScheduledStream
+    {
+    public:
+        AudioPlayer(Sink& initSink,
+                    Pacing initPacing,
+                    std::uint32_t initBufferSize,
+                    std::uint32_t initSampleRate,
+                    SampleFormat initSampleFormat,
+                    std::uint16_t initChannels);
+
+        void start() final;
+        void stop() final;
+
+        void startStream() final;
+        void stopStream() final;
+        std::size_t getWakeupHandles(WakeupHandle*, std::size_t) final { return 0; }
+        std::chrono::steady_clock::time_point getDeadline() const noexcept final;
+        bool process(WakeupHandle*, std::size_t) final;
+
+        // frames rendered since the start
+        std::uint64_t getClock() const noexcept { return clock.load(std::memory_order_relaxed); }
+
+        static std::vector<AudioDevice> getAudioDevices();
+
+    private:
+        void setBufferSize(std::uint32_t newBufferSize) final;
+        void run();
+
+        Sink& sink;
+        Pacing pacing;
+        ByteBuffer buffer;
+        std::chrono::steady_clock::time_point startTime;
+        std::atomic<std::uint64_t> clock{0};
+        std::atomic<bool> running{false};
+    };
+}
+
+#endif // NULLAUDIOPLAYER_HPP
@@ -0,0 +1,134 @@
+#ifndef NULLSINK_HPP
+#define NULLSINK_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include "../SampleFormat.hpp"
+#include "../Wav.hpp"
+
+namespace pcmplayer::null
+{
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+
+        // called with the rendered frames in the device sample format
+        virtual void write(const void* data, std::size_t size) = 0;
+    };
+
+    class DiscardSink final: public Sink
+    {
+    public:
+        void write(const void*, std::size_t size) final
+        {
+            bytesWritten += size;
+        }
+
+        auto getBytesWritten() const noexcept { return bytesWritten; }
+
+    private:
+        std::uint64_t bytesWritten = 0;
+    };
+
+    class MemorySink final: public Sink
+    {
+    public:
+        MemorySink() = default;
+
+        // reserve the capacity up front to keep the writes allocation-free
+        explicit MemorySink(std::size_t capacity)
+        {
+            data.reserve(capacity);
+        }
+
+        void write(const void* buffer, std::size_t size) final
+        {
+            const auto bytes = static_cast<const std::uint8_t*>(buffer);
+            data.insert(data.end(), bytes, bytes + size);
+        }
+
+        auto& getData() const noexcept { return data; }
+
+    private:
+        std::vector<std::uint8_t> data;
+    };
+
+    // Writes a WAV file, the sizes in the header are updated when the sink is finished
+    class FileSink final: public Sink
+    {
+    public:
+        FileSink(std::ostream& initOutput,
+                 SampleFormat sampleFormat,
+                 std::uint16_t initChannels,
+                 std::uint32_t initSampleRate):
+            output{initOutput},
+            formatTag{isFloatingPoint(sampleFormat) ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM},
+            channels{initChannels},
+            sampleRate{initSampleRate},
+            bitsPerSample{static_cast<std::uint16_t>(getSampleSize(sampleFormat) * 8)}
+        {
+            if (sampleFormat == SampleFormat::signedInt24In32)
+                throw std::runtime_error("Sample format not supported by WAV files");
+
+            headerPosition = output.tellp();
+            Wav::writeHeader(output, formatTag, channels, sampleRate, bitsPerSample, 0);
+        }
+
+        ~FileSink() override
+        {
+            try
+            {
+                finish();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        FileSink(const FileSink&) = delete;
+        FileSink& operator=(const FileSink&) = delete;
+
+        // the RIFF size and the padded data chunk must fit in 32 bits
+        static constexpr std::uint64_t maxDataSize = 0xFFFFFFFEU - 36U;
+
+        void write(const void* buffer, std::size_t size) final
+        {
+            if (size > maxDataSize - dataSize)
+                throw std::runtime_error("WAV file size limit exceeded");
+
+            output.write(static_cast<const char*>(buffer), static_cast<std::streamsize>(size));
+            dataSize += size;
+        }
+
+        void finish()
+        {
+            if (finished) return;
+            finished = true;
+
+            // pad the data chunk to an even size, the pad byte is counted in the RIFF size only
+            if (dataSize % 2) output.put(0);
+
+            const auto endPosition = output.tellp();
+            output.seekp(headerPosition);
+            Wav::writeHeader(output, formatTag, channels, sampleRate, bitsPerSample,
+                             static_cast<std::uint32_t>(dataSize));
+            output.seekp(endPosition);
+            output.flush();
+        }
+
+    private:
+        std::ostream& output;
+        std::ostream::pos_type headerPosition;
+        std::uint16_t formatTag;
+        std::uint16_t channels;
+        std::uint32_t sampleRate;
+        std::uint16_t bitsPerSample;
+        std::uint64_t dataSize = 0;
+        bool finished = false;
+    };
+}
+
+#endif // NULLSINK_HPP
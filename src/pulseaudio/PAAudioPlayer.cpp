@@ -0,0 +1,531 @@
+#include "PAAudioPlayer.hpp"
+
+namespace pcmplayer::pulseaudio
+{
+    const ErrorCategory errorCategory{};
+
+    namespace
+    {
+        class MainloopLock final
+        {
+        public:
+            explicit MainloopLock(pa_threaded_mainloop* initMainloop) noexcept:
+                mainloop{initMainloop}
+            {
+                pa_threaded_mainloop_lock(mainloop);
+            }
+
+            ~MainloopLock()
+            {
+                pa_threaded_mainloop_unlock(mainloop);
+            }
+
+            MainloopLock(const MainloopLock&) = delete;
+            MainloopLock& operator=(const MainloopLock&) = delete;
+
+        private:
+            pa_threaded_mainloop* mainloop;
+        };
+
+        void contextStateCallback(pa_context*, void* userdata)
+        {
+            pa_threaded_mainloop_signal(static_cast<pa_threaded_mainloop*>(userdata), 0);
+        }
+
+        void streamStateCallback(pa_stream*, void* userdata)
+        {
+            static_cast<pcmplayer::pulseaudio::AudioPlayer*>(userdata)->streamStateChanged();
+        }
+
+        void writeCallback(pa_stream*, std::size_t nbytes, void* userdata)
+        {
+            auto audioPlayer = static_cast<pcmplayer::pulseaudio::AudioPlayer*>(userdata);
+
+            try
+            {
+                audioPlayer->writeCallback(nbytes);
+            }
+            catch (const std::exception&)
+            {
+                audioPlayer->error(std::current_exception());
+            }
+        }
+
+        void underflowCallback(pa_stream*, void* userdata)
+        {
+            static_cast<pcmplayer::pulseaudio::AudioPlayer*>(userdata)->underflow();
+        }
+
+        void drainCallback(pa_stream*, int, void* userdata)
+        {
+            static_cast<pcmplayer::pulseaudio::AudioPlayer*>(userdata)->drained();
+        }
+
+        // must be called with the mainloop locked
+        void connect(pa_threaded_mainloop* mainloop, pa_context* context)
+        {
+            pa_context_set_state_callback(context, contextStateCallback, mainloop);
+
+            if (pa_context_connect(context, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0)
+                throw std::system_error(pa_context_errno(context), errorCategory, "Failed to connect to the server");
+
+            for (;;)
+            {
+                const auto state = pa_context_get_state(context);
+                if (state == PA_CONTEXT_READY) break;
+                if (!PA_CONTEXT_IS_GOOD(state))
+                    throw std::system_error(pa_context_errno(context), errorCategory, "Failed to connect to the server");
+
+                pa_threaded_mainloop_wait(mainloop);
+            }
+        }
+
+        struct SinkInfo final
+        {
+            std::string name;
+            std::string description;
+        };
+
+        // must be called with the mainloop locked
+        std::vector<SinkInfo> getSinks(pa_threaded_mainloop* mainloop, pa_context* context)
+        {
+            struct Request final
+            {
+                pa_threaded_mainloop* mainloop;
+                std::vector<SinkInfo> sinks;
+            } request{mainloop, {}};
+
+            const auto sinkInfoCallback = [](pa_context*, const pa_sink_info* info, int eol, void* userdata) {
+                auto request = static_cast<Request*>(userdata);
+                if (eol)
+                    pa_threaded_mainloop_signal(request->mainloop, 0);
+                else
+                    request->sinks.push_back(SinkInfo{info->name, info->description});
+            };
+
+            pa_operation* operation = pa_context_get_sink_info_list(context, sinkInfoCallback, &request);
+            if (!operation)
+                throw std::system_error(pa_context_errno(context), errorCategory, "Failed to get sinks");
+
+            while (pa_operation_get_state(operation) == PA_OPERATION_RUNNING)
+                pa_threaded_mainloop_wait(mainloop);
+
+            pa_operation_unref(operation);
+
+            return request.sinks;
+        }
+
+        pa_sample_format_t getFormat(SampleFormat sampleFormat) noexcept
+        {
+            switch (sampleFormat)
+            {
+                case SampleFormat::unsignedInt8: return PA_SAMPLE_U8;
+                case SampleFormat::signedInt16: return PA_SAMPLE_S16NE;
+                case SampleFormat::signedInt24: return PA_SAMPLE_S24NE;
+                case SampleFormat::signedInt24In32: return PA_SAMPLE_S24_32NE;
+                case SampleFormat::signedInt32: return PA_SAMPLE_S32NE;
+                case SampleFormat::float32: return PA_SAMPLE_FLOAT32NE;
+                case SampleFormat::float64: return PA_SAMPLE_INVALID;
+            }
+
+            return PA_SAMPLE_INVALID;
+        }
+    }
+
+    AudioPlayer::AudioPlayer(std::uint32_t audioDeviceId,
+                             std::uint32_t initBufferSize,
+                             std::uint32_t initSampleRate,
+                             SampleFormat initSampleFormat,
+                             std::uint16_t initChannels):
+        pcmplayer::AudioPlayer(Driver::pulseAudio, initBufferSize, initSampleRate, initSampleFormat, initChannels)
+    {
+        if (bufferSize == 0)
+            throw std::runtime_error("Invalid buffer size");
+
+        try
+        {
+            open();
+
+            MainloopLock lock(mainloop);
+            connect(mainloop, context);
+
+            std::string sinkName;
+            if (audioDeviceId != 0)
+            {
+                const auto sinks = getSinks(mainloop, context);
+                if (audioDeviceId > sinks.size())
+                    throw std::runtime_error("Invalid device");
+
+                sinkName = sinks[audioDeviceId - 1].name;
+            }
+
+            connectStream(sinkName);
+        }
+        catch (...)
+        {
+            close();
+            throw;
+        }
+    }
+
+    AudioPlayer::AudioPlayer(const std::string& sinkName,
+                             std::uint32_t initBufferSize,
+                             std::uint32_t initSampleRate,
+                             SampleFormat initSampleFormat,
+                             std::uint16_t initChannels):
+        pcmplayer::AudioPlayer(Driver::pulseAudio, initBufferSize, initSampleRate, initSampleFormat, initChannels)
+    {
+        if (bufferSize == 0)
+            throw std::runtime_error("Invalid buffer size");
+
+        try
+        {
+            open();
+
+            MainloopLock lock(mainloop);
+            connect(mainloop, context);
+            connectStream(sinkName);
+        }
+        catch (...)
+        {
+            close();
+            throw;
+        }
+    }
+
+    void AudioPlayer::open()
+    {
+        mainloop = pa_threaded_mainloop_new();
+        if (!mainloop)
+            throw std::runtime_error("Failed to create mainloop");
+
+        context = pa_context_new(pa_threaded_mainloop_get_api(mainloop), "pcmplayer");
+        if (!context)
+            throw std::runtime_error("Failed to create context");
+
+        if (pa_threaded_mainloop_start(mainloop) < 0)
+            throw std::runtime_error("Failed to start mainloop");
+    }
+
+    void AudioPlayer::connectStream(const std::string& sinkName)
+    {
+        // the server converts every format, so pick the closest one it knows
+        for (const auto candidate : getPreferredSampleFormats(sampleFormat))
+            if (getFormat(candidate) != PA_SAMPLE_INVALID)
+            {
+                sampleFormat = candidate;
+                break;
+            }
+
+        pa_sample_spec sampleSpec;
+        sampleSpec.format = getFormat(sampleFormat);
+        sampleSpec.rate = sampleRate;
+        sampleSpec.channels = static_cast<std::uint8_t>(channels);
+
+        if (!pa_sample_spec_valid(&sampleSpec))
+            throw std::runtime_error("Invalid sample specification");
+
+        frameSize = static_cast<std::uint32_t>(pa_frame_size(&sampleSpec));
+
+        stream = pa_stream_new(context, "Playback", &sampleSpec, nullptr);
+        if (!stream)
+            throw std::system_error(pa_context_errno(context), errorCategory, "Failed to create stream");
+
+        pa_stream_set_state_callback(stream, streamStateCallback, this);
+        pa_stream_set_write_callback(stream, pcmplayer::pulseaudio::writeCallback, this);
+        pa_stream_set_underflow_callback(stream, underflowCallback, this);
+
+        // tlength is the whole latency including the device buffer, the
+        // server asks for more data as soon as minreq bytes are free
+        const auto bufferAttributes = getBufferAttributes(bufferSize);
+        const auto flags = static_cast<pa_stream_flags_t>(PA_STREAM_START_CORKED |
+                                                          PA_STREAM_ADJUST_LATENCY |
+                                                          PA_STREAM_INTERPOLATE_TIMING |
+                                                          PA_STREAM_AUTO_TIMING_UPDATE);
+
+        if (pa_stream_connect_playback(stream, sinkName.empty() ? nullptr : sinkName.c_str(),
+                                       &bufferAttributes, flags, nullptr, nullptr) < 0)
+            throw std::system_error(pa_context_errno(context), errorCategory, "Failed to connect stream");
+
+        for (;;)
+        {
+            const auto state = pa_stream_get_state(stream);
+            if (state == PA_STREAM_READY) break;
+            if (!PA_STREAM_IS_GOOD(state))
+                throw std::system_error(pa_context_errno(context), errorCategory, "Failed to connect stream");
+
+            pa_threaded_mainloop_wait(mainloop);
+        }
+
+        if (const auto attributes = pa_stream_get_buffer_attr(stream))
+            bufferSize = attributes->tlength / frameSize;
+    }
+
+    AudioPlayer::~AudioPlayer()
+    {
+        close();
+    }
+
+    void AudioPlayer::close() noexcept
+    {
+        // nothing runs on the mainloop thread after it has been stopped
+        if (mainloop) pa_threaded_mainloop_stop(mainloop);
+
+        if (stream)
+        {
+            pa_stream_disconnect(stream);
+            pa_stream_unref(stream);
+            stream = nullptr;
+        }
+
+        if (context)
+        {
+            pa_context_disconnect(context);
+            pa_context_unref(context);
+            context = nullptr;
+        }
+
+        if (mainloop)
+        {
+            pa_threaded_mainloop_free(mainloop);
+            mainloop = nullptr;
+        }
+    }
+
+    void AudioPlayer::start()
+    {
+        std::unique_lock<std::mutex> runningLock(runningMutex);
+        running = true;
+        streamError = nullptr;
+        runningLock.unlock();
+
+        {
+            MainloopLock lock(mainloop);
+            started = true;
+            finished = false;
+
+            // the requests of the corked stream were ignored, so prefill it now
+            writeCallback(pa_stream_writable_size(stream));
+
+            pa_operation* operation = pa_stream_cork(stream, 0, nullptr, nullptr);
+            if (!operation)
+                throw std::system_error(pa_context_errno(context), errorCategory, "Failed to start stream");
+            pa_operation_unref(operation);
+        }
+
+        run();
+
+        // a write or the stream failed on the mainloop thread
+        runningLock.lock();
+        if (streamError) std::rethrow_exception(streamError);
+    }
+
+    void AudioPlayer::stop()
+    {
+        {
+            MainloopLock lock(mainloop);
+            started = false;
+
+            pa_operation* operation = pa_stream_cork(stream, 1, nullptr, nullptr);
+            if (!operation)
+                throw std::system_error(pa_context_errno(context), errorCategory, "Failed to stop stream");
+            pa_operation_unref(operation);
+        }
+
+        std::unique_lock<std::mutex> lock(runningMutex);
+        running = false;
+        lock.unlock();
+        runningCondition.notify_all();
+    }
+
+    void AudioPlayer::writeCallback(std::size_t size)
+    {
+        if (!started || finished) return;
+
+        // the prefill in start runs on the calling thread
+        if (pa_threaded_mainloop_in_thread(mainloop))
+            prepareRenderThread();
+
+        const auto callbackStart = metrics.beginCallback();
+        trace::Scope scope("PulseAudio::write");
+        RenderScope renderScope;
+
+        std::uint32_t frames = 0;
+
+        while (size >= frameSize)
+        {
+            // render straight into the memory block of the server
+            void* data;
+            std::size_t dataSize = size;
+            if (pa_stream_begin_write(stream, &data, &dataSize) < 0 || !data)
+                throw std::system_error(pa_context_errno(context), errorCategory, "Failed to begin write");
+
+            if (dataSize > size) dataSize = size;
+            const auto count = static_cast<std::uint32_t>(dataSize / frameSize);
+            if (count == 0)
+            {
+                pa_stream_cancel_write(stream);
+                break;
+            }
+
+            const bool hasMoreData = render(count, data);
+
+            if (pa_stream_write(stream, data, count * frameSize, nullptr, 0, PA_SEEK_RELATIVE) < 0)
+                throw std::system_error(pa_context_errno(context), errorCategory, "Failed to write");
+
+            size -= count * frameSize;
+            frames += count;
+
+            if (!hasMoreData)
+            {
+                finished = true;
+
+                if (pa_operation* operation = pa_stream_drain(stream, drainCallback, this))
+                    pa_operation_unref(operation);
+                else
+                    drained();
+                break;
+            }
+        }
+
+        // interpolated by the library from the last timing update of the server
+        pa_usec_t latency;
+        int negative;
+        if (frames && pa_stream_get_latency(stream, &latency, &negative) == 0)
+            publishPlaybackPosition(negative ? 0 : latency * sampleRate / 1'000'000);
+
+        metrics.endCallback(callbackStart, frames);
+    }
+
+    void AudioPlayer::streamStateChanged() noexcept
+    {
+        pa_threaded_mainloop_signal(mainloop, 0);
+
+        // the stream can not recover from these, so end the playback
+        const auto state = pa_stream_get_state(stream);
+        if (started && !PA_STREAM_IS_GOOD(state))
+            error(std::make_exception_ptr(std::system_error(pa_context_errno(context), errorCategory, "Stream failed")));
+    }
+
+    void AudioPlayer::underflow() noexcept
+    {
+        metrics.underrun();
+    }
+
+    // called on the mainloop thread or with the mainloop locked
+    void AudioPlayer::drained() noexcept
+    {
+        // corked again, so the stream does not underflow until the next start
+        started = false;
+        if (pa_operation* operation = pa_stream_cork(stream, 1, nullptr, nullptr))
+            pa_operation_unref(operation);
+
+        std::unique_lock<std::mutex> lock(runningMutex);
+        running = false;
+        lock.unlock();
+        runningCondition.notify_all();
+    }
+
+    // called on the mainloop thread
+    void AudioPlayer::error(std::exception_ptr exception) noexcept
+    {
+        metrics.error();
+
+        started = false;
+        if (PA_STREAM_IS_GOOD(pa_stream_get_state(stream)))
+            if (pa_operation* operation = pa_stream_cork(stream, 1, nullptr, nullptr))
+                pa_operation_unref(operation);
+
+        std::unique_lock<std::mutex> lock(runningMutex);
+        streamError = exception;
+        running = false;
+        lock.unlock();
+        runningCondition.notify_all();
+    }
+
+    pa_buffer_attr AudioPlayer::getBufferAttributes(std::uint32_t frames) const noexcept
+    {
+        pa_buffer_attr bufferAttributes;
+        bufferAttributes.maxlength = static_cast<std::uint32_t>(-1);
+        bufferAttributes.tlength = frames * frameSize;
+        bufferAttributes.prebuf = static_cast<std::uint32_t>(-1);
+        bufferAttributes.minreq = (frames > 1 ? frames / 2 : 1) * frameSize;
+        bufferAttributes.fragsize = static_cast<std::uint32_t>(-1);
+        return bufferAttributes;
+    }
+
+    void AudioPlayer::setBufferSize(std::uint32_t newBufferSize)
+    {
+        if (newBufferSize == 0)
+            throw std::runtime_error("Invalid buffer size");
+
+        MainloopLock lock(mainloop);
+
+        const auto bufferAttributes = getBufferAttributes(newBufferSize);
+        pa_operation* operation = pa_stream_set_buffer_attr(stream, &bufferAttributes, nullptr, nullptr);
+        if (!operation)
+            throw std::system_error(pa_context_errno(context), errorCategory, "Failed to set buffer attributes");
+        pa_operation_unref(operation);
+
+        bufferSize = newBufferSize;
+    }
+
+    void AudioPlayer::run()
+    {
+        std::unique_lock<std::mutex> lock(runningMutex);
+        while (running)
+        {
+            runningCondition.wait_for(lock, adaptationInterval);
+
+            lock.unlock();
+            adaptBufferSize();
+            lock.lock();
+        }
+    }
+
+    std::vector<AudioDevice> AudioPlayer::getAudioDevices()
+    {
+        std::vector<AudioDevice> result;
+
+        pa_threaded_mainloop* mainloop = pa_threaded_mainloop_new();
+        if (!mainloop)
+            throw std::runtime_error("Failed to create mainloop");
+
+        pa_context* context = pa_context_new(pa_threaded_mainloop_get_api(mainloop), "pcmplayer");
+        if (!context)
+        {
+            pa_threaded_mainloop_free(mainloop);
+            throw std::runtime_error("Failed to create context");
+        }
+
+        try
+        {
+            if (pa_threaded_mainloop_start(mainloop) < 0)
+                throw std::runtime_error("Failed to start mainloop");
+
+            MainloopLock lock(mainloop);
+            connect(mainloop, context);
+
+            std::uint32_t audioDeviceId = 0;
+            result.push_back(AudioDevice{audioDeviceId++, "Default device"});
+
+            for (const auto& sink : getSinks(mainloop, context))
+                result.push_back(AudioDevice{audioDeviceId++, sink.name + " (" + sink.description + ")"});
+        }
+        catch (...)
+        {
+            pa_threaded_mainloop_stop(mainloop);
+            pa_context_disconnect(context);
+            pa_context_unref(context);
+            pa_threaded_mainloop_free(mainloop);
+            throw;
+        }
+
+        pa_threaded_mainloop_stop(mainloop);
+        pa_context_disconnect(context);
+        pa_context_unref(context);
+        pa_threaded_mainloop_free(mainloop);
+
+        return result;
+    }
+}
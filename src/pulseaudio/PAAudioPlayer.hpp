@@ -0,0 +1,71 @@
+#ifndef PAAUDIOPLAYER_HPP
+#define PAAUDIOPLAYER_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pulse/pulseaudio.h>
+#include "../AudioPlayer.hpp"
+#include "../AudioDevice.hpp"
+#include "PAErrorCategory.hpp"
+
+namespace pcmplayer::pulseaudio
+{
+    // Talks to PulseAudio or to PipeWire through its pulse protocol server
+    class AudioPlayer final: public pcmplayer::AudioPlayer
+    {
+    public:
+        AudioPlayer(std::uint32_t audioDeviceId,
+                    std::uint32_t initBufferSize,
+                    std::uint32_t initSampleRate,
+                    SampleFormat initSampleFormat,
+                    std::uint16_t initChannels);
+
+        // Connects to a sink by its name, e.g. a module-null-sink, the default sink if the name is empty
+        AudioPlayer(const std::string& sinkName,
+                    std::uint32_t initBufferSize,
+                    std::uint32_t initSampleRate,
+                    SampleFormat initSampleFormat,
+                    std::uint16_t initChannels);
+        ~AudioPlayer() override;
+
+        AudioPlayer(const AudioPlayer&) = delete;
+        AudioPlayer& operator=(const AudioPlayer&) = delete;
+
+        void start() final;
+        void stop() final;
+
+        void writeCallback(std::size_t size);
+        void streamStateChanged() noexcept;
+        void underflow() noexcept;
+        void drained() noexcept;
+        void error(std::exception_ptr exception) noexcept;
+
+        static std::vector<AudioDevice> getAudioDevices();
+
+    private:
+        void setBufferSize(std::uint32_t newBufferSize) final;
+        void run();
+        void open();
+        void connectStream(const std::string& sinkName); // must be called with the mainloop locked
+        void close() noexcept;
+        pa_buffer_attr getBufferAttributes(std::uint32_t frames) const noexcept;
+
+        pa_threaded_mainloop* mainloop = nullptr;
+        pa_context* context = nullptr;
+        pa_stream* stream = nullptr;
+
+        std::uint32_t frameSize = 0;
+        bool started = false; // guarded by the mainloop lock
+        bool finished = false; // guarded by the mainloop lock
+
+        std::mutex runningMutex;
+        std::condition_variable runningCondition;
+        bool running = false;
+        std::exception_ptr streamError; // guarded by runningMutex, rethrown by start
+    };
+}
+
+#endif // PAAUDIOPLAYER_HPP
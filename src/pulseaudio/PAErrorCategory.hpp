@@ -0,0 +1,25 @@
+#ifndef PAERRORCATEGORY_HPP
+#define PAERRORCATEGORY_HPP
+
+#include <string>
+#include <system_error>
+#include <pulse/pulseaudio.h>
+
+namespace pcmplayer::pulseaudio
+{
+    class ErrorCategory final: public std::error_category
+    {
+    public:
+        const char* name() const noexcept final
+        {
+            return "PulseAudio";
+        }
+
+        std::string message(int condition) const final
+        {
+            return pa_strerror(condition);
+        }
+    };
+}
+
+#endif // PAERRORCATEGORY_HPP
@@ -1,4 +1,6 @@
 #include <mmdeviceapi.h>
+#include <mmreg.h>
+#include <ksmedia.h>
 #include <Functiondiscoverykeys_devpkey.h>
 #include "WASAPIAudioPlayer.hpp"
 
@@ -110,6 +112,25 @@ namespace pcmplayer::wasapi
 
     const ErrorCategory errorCategory{};
 
+    namespace
+    {
+        WAVEFORMATEXTENSIBLE getWaveFormat(SampleFormat sampleFormat, std::uint16_t channels, std::uint32_t sampleRate)
+        {
+            WAVEFORMATEXTENSIBLE waveFormat;
+            waveFormat.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+            waveFormat.Format.nChannels = static_cast<WORD>(channels);
+            waveFormat.Format.nSamplesPerSec = sampleRate;
+            waveFormat.Format.wBitsPerSample = static_cast<WORD>(getSampleSize(sampleFormat) * 8);
+            waveFormat.Format.nBlockAlign = waveFormat.Format.nChannels * (waveFormat.Format.wBitsPerSample / 8);
+            waveFormat.Format.nAvgBytesPerSec = waveFormat.Format.nSamplesPerSec * waveFormat.Format.nBlockAlign;
+            waveFormat.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+            waveFormat.Samples.wValidBitsPerSample = waveFormat.Format.wBitsPerSample;
+            waveFormat.dwChannelMask = 0;
+            waveFormat.SubFormat = isFloatingPoint(sampleFormat) ? KSDATAFORMAT_SUBTYPE_IEEE_FLOAT : KSDATAFORMAT_SUBTYPE_PCM;
+            return waveFormat;
+        }
+    }
+
     AudioPlayer::AudioPlayer(std::uint32_t audioDeviceId,
                              std::uint32_t initBufferSize,
                              std::uint32_t initSampleRate,
@@ -169,64 +190,51 @@ namespace pcmplayer::wasapi
         if (const auto hr = audioClient->GetMixFormat(&audioClientWaveFormat); FAILED(hr))
             throw std::system_error(hr, errorCategory, "Failed to get audio mix format");
 
-        WAVEFORMATEX waveFormat;
-        waveFormat.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
-        waveFormat.nChannels = static_cast<WORD>(channels);
-        waveFormat.nSamplesPerSec = sampleRate;
-        waveFormat.wBitsPerSample = sizeof(float) * 8;
-        waveFormat.nBlockAlign = waveFormat.nChannels * (waveFormat.wBitsPerSample / 8);
-        waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
-        waveFormat.cbSize = 0;
-
-        sampleFormat = SampleFormat::float32;
-        sampleSize = sizeof(float);
-
         const DWORD streamFlags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK |
-            (waveFormat.nSamplesPerSec != audioClientWaveFormat->nSamplesPerSec ? AUDCLNT_STREAMFLAGS_RATEADJUST : 0);
+            (sampleRate != audioClientWaveFormat->nSamplesPerSec ? AUDCLNT_STREAMFLAGS_RATEADJUST : 0);
 
         CoTaskMemFree(audioClientWaveFormat);
 
         constexpr std::uint64_t timesPerSecond = 10'000'000U;
-        auto bufferPeriod = static_cast<REFERENCE_TIME>(512U * timesPerSecond / waveFormat.nSamplesPerSec);
+        auto bufferPeriod = static_cast<REFERENCE_TIME>(bufferSize * timesPerSecond / sampleRate);
 
-        WAVEFORMATEX* closesMatch;
-        if (!FAILED(audioClient->IsFormatSupported(AUDCLNT_SHAREMODE_SHARED,
-                                                   &waveFormat,
-                                                   &closesMatch)))
+        // try the formats closest to the requested one first
+        HRESULT initializeResult = AUDCLNT_E_UNSUPPORTED_FORMAT;
+        for (const auto candidate : getPreferredSampleFormats(sampleFormat))
         {
-            // TODO: implement
+            // WASAPI aligns 24-bit samples in 32-bit containers to the most significant bits
+            if (candidate == SampleFormat::signedInt24In32)
+                continue;
+
+            WAVEFORMATEXTENSIBLE waveFormat = getWaveFormat(candidate, channels, sampleRate);
+
+            initializeResult = audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED,
+                                                       streamFlags,
+                                                       bufferPeriod,
+                                                       0,
+                                                       &waveFormat.Format,
+                                                       nullptr);
+            if (SUCCEEDED(initializeResult))
+            {
+                sampleFormat = candidate;
+                sampleSize = getSampleSize(candidate);
+                break;
+            }
         }
 
-        CoTaskMemFree(closesMatch);
-
-        if (const auto floatResult = audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED,
-                                                             streamFlags,
-                                                             bufferPeriod,
-                                                             0,
-                                                             &waveFormat,
-                                                             nullptr); FAILED(floatResult))
-        {
-            waveFormat.wFormatTag = WAVE_FORMAT_PCM;
-            waveFormat.wBitsPerSample = sizeof(std::int16_t) * 8;
-            waveFormat.nBlockAlign = waveFormat.nChannels * (waveFormat.wBitsPerSample / 8);
-            waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
-
-            if (const auto pcmResult = audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED,
-                                                               streamFlags,
-                                                               bufferPeriod,
-                                                               0,
-                                                               &waveFormat,
-                                                               nullptr); FAILED(pcmResult))
-                throw std::system_error(pcmResult, errorCategory, "Failed to initialize audio client");
-
-            sampleFormat = SampleFormat::signedInt16;
-            sampleSize = sizeof(std::int16_t);
-        }
+        if (FAILED(initializeResult))
+            throw std::system_error(initializeResult, errorCategory, "Failed to initialize audio client");
 
         // init output device
         if (const auto hr = audioClient->GetBufferSize(&bufferFrameCount); FAILED(hr))
             throw std::system_error(hr, errorCategory, "Failed to get audio buffer size");
-        bufferSize = bufferFrameCount * channels;
+        bufferSize = bufferFrameCount;
+        targetFrameCount = bufferFrameCount;
+
+        // in 100-nanosecond units, only used for the playback position
+        REFERENCE_TIME streamLatency;
+        if (SUCCEEDED(audioClient->GetStreamLatency(&streamLatency)))
+            streamLatencyFrames = static_cast<UINT32>(streamLatency * sampleRate / 10'000'000);
 
         void* renderClientPointer;
         if (const auto hr = audioClient->GetService(IID_IAudioRenderClient, &renderClientPointer); FAILED(hr))
@@ -250,15 +258,26 @@ namespace pcmplayer::wasapi
     }
 
     void AudioPlayer::start()
+    {
+        startStream();
+        run();
+    }
+
+    void AudioPlayer::stop()
+    {
+        stopStream();
+    }
+
+    void AudioPlayer::startStream()
     {
         if (const auto hr = audioClient->Start(); FAILED(hr))
             throw std::system_error(hr, errorCategory, "Failed to start audio");
 
+        streamError = nullptr;
         started = true;
-        run();
     }
 
-    void AudioPlayer::stop()
+    void AudioPlayer::stopStream()
     {
         if (started)
         {
@@ -269,44 +288,83 @@ namespace pcmplayer::wasapi
         }
     }
 
-    void AudioPlayer::run()
+    void AudioPlayer::setBufferSize(std::uint32_t newBufferSize)
     {
-        for (;;)
+        // the device buffer is allocated once, only the fill level is limited
+        targetFrameCount = newBufferSize < bufferFrameCount ? static_cast<UINT32>(newBufferSize) : bufferFrameCount;
+        bufferSize = targetFrameCount;
+    }
+
+    std::size_t AudioPlayer::getWakeupHandles(WakeupHandle* handles, std::size_t count)
+    {
+        if (count >= 1) handles[0] = notifyEvent;
+        return 1;
+    }
+
+    bool AudioPlayer::process(WakeupHandle*, std::size_t)
+    {
+        try
         {
-            try
-            {
-                DWORD result;
-                if ((result = WaitForSingleObject(notifyEvent, INFINITE)) == WAIT_FAILED)
-                    throw std::system_error(GetLastError(), std::system_category(), "Failed to wait for event");
+            const auto callbackStart = metrics.beginCallback();
+            trace::Scope scope("WASAPI::render");
+            RenderScope renderScope;
 
-                if (result == WAIT_OBJECT_0)
-                {
-                    UINT32 bufferPadding;
-                    if (const auto hr = audioClient->GetCurrentPadding(&bufferPadding); FAILED(hr))
-                        throw std::system_error(hr, errorCategory, "Failed to get buffer padding");
+            UINT32 bufferPadding;
+            if (const auto hr = audioClient->GetCurrentPadding(&bufferPadding); FAILED(hr))
+                throw std::system_error(hr, errorCategory, "Failed to get buffer padding");
 
-                    const UINT32 frameCount = bufferFrameCount - bufferPadding;
-                    if (frameCount != 0)
-                    {
-                        BYTE* renderBuffer;
-                        if (const auto hr = renderClient->GetBuffer(frameCount, &renderBuffer); FAILED(hr))
-                            throw std::system_error(hr, errorCategory, "Failed to get buffer");
+            // the whole buffer was played out before we refilled it
+            if (bufferPadding == 0 && metrics.getCallbacks() != 0)
+                metrics.underrun();
 
-                        bool hasMoreData = getData(frameCount, data);
+            const UINT32 frameCount = targetFrameCount > bufferPadding ? targetFrameCount - bufferPadding : 0;
+            if (frameCount != 0)
+            {
+                BYTE* renderBuffer;
+                if (const auto hr = renderClient->GetBuffer(frameCount, &renderBuffer); FAILED(hr))
+                    throw std::system_error(hr, errorCategory, "Failed to get buffer");
 
-                        std::copy(data.begin(), data.end(), reinterpret_cast<float*>(renderBuffer));
+                const bool hasMoreData = render(frameCount, renderBuffer);
 
-                        if (const auto hr = renderClient->ReleaseBuffer(frameCount, 0); FAILED(hr))
-                            throw std::system_error(hr, errorCategory, "Failed to release buffer");
+                if (const auto hr = renderClient->ReleaseBuffer(frameCount, 0); FAILED(hr))
+                    throw std::system_error(hr, errorCategory, "Failed to release buffer");
 
-                        if (!hasMoreData)
-                            return;
-                    }
-                }
+                // the padding is what is left of the buffer, the stream latency comes on top of it
+                publishPlaybackPosition(bufferPadding + frameCount + streamLatencyFrames);
+
+                metrics.endCallback(callbackStart, frameCount);
+
+                if (!hasMoreData)
+                    return false;
             }
-            catch (const std::exception& e)
+
+            adaptBufferSize();
+        }
+        catch (const std::exception&)
+        {
+            // ends the stream, the Scheduler keeps servicing the others
+            metrics.error();
+            streamError = std::current_exception();
+            return false;
+        }
+
+        return true;
+    }
+
+    void AudioPlayer::run()
+    {
+        prepareRenderThread();
+
+        for (;;)
+        {
+            DWORD result;
+            if ((result = WaitForSingleObject(notifyEvent, INFINITE)) == WAIT_FAILED)
+                throw std::system_error(GetLastError(), std::system_category(), "Failed to wait for event");
+
+            if (result == WAIT_OBJECT_0 && !process(nullptr, 0))
             {
-                // e.what();
+                if (streamError) std::rethrow_exception(streamError);
+                return;
             }
         }
     }
@@ -1,17 +1,22 @@
 #ifndef WASAPIAUDIOPLAYER_HPP
 #define WASAPIAUDIOPLAYER_HPP
 
+#include <exception>
 #include <vector>
+#ifndef NOMINMAX
+#  define NOMINMAX
+#endif
 #include <Audioclient.h>
 #include <mmdeviceapi.h>
 #include "../AudioPlayer.hpp"
 #include "../AudioDevice.hpp"
+#include "../Scheduler.hpp"
 #include "WASAPIPointer.hpp"
 #include "WASAPIErrorCategory.hpp"
 
 namespace pcmplayer::wasapi
 {
-    class AudioPlayer final: public pcmplayer::AudioPlayer
+    class AudioPlayer final: public pcmplayer::AudioPlayer, public ScheduledStream
     {
     public:
         AudioPlayer(std::uint32_t audioDeviceId,
@@ -24,9 +29,18 @@ namespace pcmplayer::wasapi
         void start() final;
         void stop() final;
 
+        void startStream() final;
+        void stopStream() final;
+        std::size_t getWakeupHandles(WakeupHandle* handles, std::size_t count) final;
+        bool process(WakeupHandle* handles, std::size_t count) final;
+
+        // the error that ended the stream, null if it ended with the data
+        std::exception_ptr getStreamError() const noexcept { return streamError; }
+
         static std::vector<AudioDevice> getAudioDevices();
 
     private:
+        void setBufferSize(std::uint32_t newBufferSize) final;
         void run();
 
         Pointer<IMMDeviceEnumerator> enumerator;
@@ -37,9 +51,11 @@ namespace pcmplayer::wasapi
         HANDLE notifyEvent = nullptr;
 
         UINT32 bufferFrameCount;
+        UINT32 targetFrameCount;
+        UINT32 streamLatencyFrames = 0;
         std::uint32_t sampleSize = 0;
         bool started = false;
-        std::vector<float> data;
+        std::exception_ptr streamError;
     };
 }
 
@@ -2,6 +2,9 @@
 #define COM_HPP
 
 #include <system_error>
+#ifndef NOMINMAX
+#  define NOMINMAX
+#endif
 #include <Combaseapi.h>
 
 namespace pcmplayer
@@ -0,0 +1,33 @@
+#include "catch2/catch.hpp"
+#include "Scheduler.hpp"
+#include "alsa/ALSAAudioPlayer.hpp"
+
+// the null PCM discards everything written to it, so no sound card is needed
+TEST_CASE("ALSAAudioPlayer", "[alsa_audio_player]")
+{
+    SECTION("Play")
+    {
+        pcmplayer::alsa::AudioPlayer audioPlayer("null", 256, 48000, pcmplayer::SampleFormat::signedInt16, 2);
+        REQUIRE(audioPlayer.getSampleFormat() == pcmplayer::SampleFormat::signedInt16);
+
+        audioPlayer.play(pcmplayer::SampleBuffer(4800 * 2, 0.5F));
+
+        const auto& metrics = audioPlayer.getMetrics();
+        REQUIRE(metrics.getFramesRendered() >= 4800);
+        REQUIRE(metrics.getErrors() == 0);
+    }
+
+    SECTION("Scheduler")
+    {
+        pcmplayer::alsa::AudioPlayer audioPlayer("null", 480, 48000, pcmplayer::SampleFormat::float32, 1);
+        audioPlayer.setSamples(pcmplayer::SampleBuffer(4800, 0.25F));
+
+        pcmplayer::Scheduler scheduler;
+        scheduler.add(audioPlayer);
+        scheduler.run();
+
+        const auto& metrics = audioPlayer.getMetrics();
+        REQUIRE(metrics.getFramesRendered() >= 4800);
+        REQUIRE(metrics.getErrors() == 0);
+    }
+}
@@ -0,0 +1,55 @@
+#include "catch2/catch.hpp"
+#include "AdaptiveBufferSize.hpp"
+
+TEST_CASE("AdaptiveBufferSize", "[adaptive_buffer_size]")
+{
+    SECTION("Bounds")
+    {
+        REQUIRE_THROWS(pcmplayer::AdaptiveBufferSize(0, 512));
+        REQUIRE_THROWS(pcmplayer::AdaptiveBufferSize(1024, 512));
+    }
+
+    SECTION("Grow")
+    {
+        pcmplayer::Metrics metrics(48000);
+        pcmplayer::AdaptiveBufferSize adaptiveBufferSize(64, 256);
+        REQUIRE(adaptiveBufferSize.getSize() == 64);
+
+        metrics.underrun();
+        REQUIRE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.getSize() == 128);
+
+        REQUIRE_FALSE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.getSize() == 128);
+
+        metrics.underrun();
+        REQUIRE(adaptiveBufferSize.update(metrics));
+        metrics.underrun();
+        REQUIRE_FALSE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.getSize() == 256);
+    }
+
+    SECTION("Shrink")
+    {
+        pcmplayer::Metrics metrics(48000);
+        pcmplayer::AdaptiveBufferSize adaptiveBufferSize(64, 256, 2);
+
+        metrics.underrun();
+        REQUIRE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.getSize() == 128);
+
+        REQUIRE_FALSE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.getSize() == 64);
+
+        // the shrink caused a dropout, so the next one needs twice as long
+        metrics.underrun();
+        REQUIRE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.getSize() == 128);
+
+        for (int i = 0; i < 3; ++i)
+            REQUIRE_FALSE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.update(metrics));
+        REQUIRE(adaptiveBufferSize.getSize() == 64);
+    }
+}
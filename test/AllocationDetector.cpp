@@ -0,0 +1,169 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#if defined(__GLIBC__)
+#  include <dlfcn.h>
+#  include <pthread.h>
+#endif
+#include "AllocationDetector.hpp"
+#include "RenderThread.hpp"
+
+namespace
+{
+    std::atomic<std::size_t> allocations{0};
+    std::atomic<std::size_t> locks{0};
+
+    void checkAllocation() noexcept
+    {
+        if (pcmplayer::RenderScope::isActive())
+            allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* allocate(std::size_t size)
+    {
+        checkAllocation();
+        if (void* result = std::malloc(size ? size : 1))
+            return result;
+        throw std::bad_alloc();
+    }
+
+    void* allocate(std::size_t size, std::align_val_t alignment)
+    {
+        checkAllocation();
+        const auto alignmentValue = static_cast<std::size_t>(alignment);
+#if defined(_MSC_VER)
+        if (void* result = _aligned_malloc(size ? size : 1, alignmentValue))
+#else
+        // aligned_alloc requires the size to be a multiple of the alignment
+        if (void* result = std::aligned_alloc(alignmentValue, (size + alignmentValue - 1) / alignmentValue * alignmentValue))
+#endif
+            return result;
+        throw std::bad_alloc();
+    }
+
+    void deallocate(void* pointer) noexcept
+    {
+        if (pointer) checkAllocation();
+        std::free(pointer);
+    }
+
+    void deallocate(void* pointer, std::align_val_t) noexcept
+    {
+        if (pointer) checkAllocation();
+#if defined(_MSC_VER)
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+}
+
+namespace allocationdetector
+{
+    std::size_t getAllocations() noexcept
+    {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    std::size_t getLocks() noexcept
+    {
+        return locks.load(std::memory_order_relaxed);
+    }
+
+    void reset() noexcept
+    {
+        allocations.store(0, std::memory_order_relaxed);
+        locks.store(0, std::memory_order_relaxed);
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment) noexcept { deallocate(pointer, alignment); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { deallocate(pointer, alignment); }
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept { deallocate(pointer, alignment); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept { deallocate(pointer, alignment); }
+
+#if defined(__GLIBC__)
+extern "C"
+{
+    void* __libc_malloc(std::size_t);
+    void* __libc_calloc(std::size_t, std::size_t);
+    void* __libc_realloc(void*, std::size_t);
+    void* __libc_memalign(std::size_t, std::size_t);
+    void __libc_free(void*);
+
+    void* malloc(std::size_t size)
+    {
+        checkAllocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size)
+    {
+        checkAllocation();
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, std::size_t size)
+    {
+        checkAllocation();
+        return __libc_realloc(pointer, size);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size)
+    {
+        checkAllocation();
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** pointer, std::size_t alignment, std::size_t size)
+    {
+        checkAllocation();
+        *pointer = __libc_memalign(alignment, size);
+        return *pointer ? 0 : ENOMEM;
+    }
+
+    void free(void* pointer)
+    {
+        if (pointer) checkAllocation();
+        __libc_free(pointer);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        using Lock = int (*)(pthread_mutex_t*);
+
+        // no function-local static, its guard could lock a mutex
+        static std::atomic<Lock> realLock{nullptr};
+        auto lock = realLock.load(std::memory_order_acquire);
+        if (!lock)
+        {
+            lock = reinterpret_cast<Lock>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+            realLock.store(lock, std::memory_order_release);
+        }
+
+        if (pcmplayer::RenderScope::isActive())
+            locks.fetch_add(1, std::memory_order_relaxed);
+
+        return lock(mutex);
+    }
+}
+#endif
@@ -0,0 +1,16 @@
+#ifndef ALLOCATIONDETECTOR_HPP
+#define ALLOCATIONDETECTOR_HPP
+
+#include <cstddef>
+
+// Counts the allocations, deallocations and mutex locks inside a
+// pcmplayer::RenderScope. operator new and delete are replaced on every
+// platform, malloc and pthread_mutex_lock only with glibc.
+namespace allocationdetector
+{
+    std::size_t getAllocations() noexcept;
+    std::size_t getLocks() noexcept;
+    void reset() noexcept;
+}
+
+#endif // ALLOCATIONDETECTOR_HPP
@@ -0,0 +1,135 @@
+#include <mutex>
+#include "catch2/catch.hpp"
+#include "AllocationDetector.hpp"
+#include "Playlist.hpp"
+#include "Scheduler.hpp"
+#include "dsp/AnalysisTap.hpp"
+#include "dsp/Convolution.hpp"
+#include "dsp/Equalizer.hpp"
+#include "dsp/Gain.hpp"
+#include "dsp/Graph.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+namespace
+{
+    // keeps the compiler from eliding the allocation
+    int* volatile pointer = nullptr;
+}
+
+TEST_CASE("AllocationDetector", "[allocation]")
+{
+    SECTION("Detect")
+    {
+        allocationdetector::reset();
+        {
+            pcmplayer::RenderScope renderScope;
+            pointer = new int(1);
+            delete pointer;
+        }
+        REQUIRE(allocationdetector::getAllocations() != 0);
+
+#if defined(__GLIBC__)
+        allocationdetector::reset();
+        {
+            std::mutex mutex;
+            pcmplayer::RenderScope renderScope;
+            std::lock_guard lock(mutex);
+        }
+        REQUIRE(allocationdetector::getLocks() == 1);
+#endif
+    }
+
+    SECTION("Render")
+    {
+        const pcmplayer::SampleBuffer samples(48000 * 2, 0.25F);
+        pcmplayer::dsp::Gain gain(2.0F);
+        pcmplayer::dsp::Equalizer equalizer(10);
+        pcmplayer::dsp::Convolution convolution(pcmplayer::SampleBuffer(10000, 0.0001F), 1, 48000);
+        pcmplayer::dsp::AnalysisTap tap;
+
+        for (const auto sampleFormat : pcmplayer::sampleFormats)
+        {
+            pcmplayer::null::DiscardSink sink;
+            pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                     1024, 48000, sampleFormat, 2);
+            audioPlayer.setDither(true);
+            audioPlayer.setAdaptiveBufferSize(64, 1024);
+            audioPlayer.addProcessor(gain);
+            audioPlayer.addProcessor(equalizer);
+            audioPlayer.addProcessor(convolution);
+            audioPlayer.setLimiter(pcmplayer::dsp::LimiterSettings{});
+            audioPlayer.setTap(tap);
+
+            allocationdetector::reset();
+            audioPlayer.play(samples);
+
+            INFO("Sample format " << static_cast<int>(sampleFormat));
+            REQUIRE(allocationdetector::getAllocations() == 0);
+            REQUIRE(allocationdetector::getLocks() == 0);
+        }
+    }
+
+    SECTION("Graph")
+    {
+        pcmplayer::BufferSource first(pcmplayer::SampleBuffer(48000 * 2, 0.25F), 2);
+        pcmplayer::BufferSource second(pcmplayer::SampleBuffer(48000 * 2, 0.25F), 2);
+        pcmplayer::dsp::Gain gain(0.5F);
+
+        pcmplayer::dsp::Graph graph(2);
+        const auto output = graph.addProcessor(gain);
+        graph.connect(graph.addSource(first), output);
+        graph.connect(graph.addSource(second), output);
+        graph.prepare(48000, output, 2);
+
+        pcmplayer::null::DiscardSink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 256, 48000, pcmplayer::SampleFormat::float32, 2);
+
+        allocationdetector::reset();
+        audioPlayer.play(graph);
+
+        REQUIRE(allocationdetector::getAllocations() == 0);
+        REQUIRE(allocationdetector::getLocks() == 0);
+    }
+
+    SECTION("Playlist")
+    {
+        pcmplayer::Playlist playlist(2);
+        playlist.setWaitForDecoder(true);
+        playlist.setCrossfadeFrames(1000);
+        for (int i = 0; i < 4; ++i)
+            playlist.add([]() { return pcmplayer::SampleBuffer(48000 * 2, 0.25F); });
+
+        pcmplayer::null::DiscardSink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 256, 48000, pcmplayer::SampleFormat::signedInt16, 2);
+
+        allocationdetector::reset();
+        audioPlayer.play(playlist);
+
+        REQUIRE(allocationdetector::getAllocations() == 0);
+        REQUIRE(allocationdetector::getLocks() == 0);
+        REQUIRE(sink.getBytesWritten() == (48000 * 4 - 3000) * 2 * sizeof(std::int16_t));
+    }
+
+    SECTION("Trace")
+    {
+        pcmplayer::trace::Tracer::getInstance().setEnabled(true);
+
+        pcmplayer::null::MemorySink sink(48000 * sizeof(float));
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 256, 48000, pcmplayer::SampleFormat::float32, 1);
+        audioPlayer.setSamples(pcmplayer::SampleBuffer(48000, 0.25F));
+
+        pcmplayer::Scheduler scheduler;
+        scheduler.add(audioPlayer);
+
+        allocationdetector::reset();
+        scheduler.run();
+
+        pcmplayer::trace::Tracer::getInstance().setEnabled(false);
+
+        REQUIRE(allocationdetector::getAllocations() == 0);
+        REQUIRE(allocationdetector::getLocks() == 0);
+    }
+}
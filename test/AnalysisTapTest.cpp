@@ -0,0 +1,132 @@
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include "catch2/catch.hpp"
+#include "dsp/AnalysisTap.hpp"
+#include "dsp/Spectrum.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+TEST_CASE("AnalysisTap", "[analysis_tap]")
+{
+    SECTION("Copy")
+    {
+        pcmplayer::dsp::AnalysisTap tap(1000);
+        tap.prepare(48000, 256, 2);
+        REQUIRE(tap.getCapacity() == 1024);
+
+        std::vector<float> block(256 * 2);
+        for (std::uint64_t frame = 0; frame < 1024 + 512; frame += 256)
+        {
+            for (std::size_t i = 0; i < block.size(); ++i)
+                block[i] = static_cast<float>(frame + i / 2) + (i % 2 ? 0.5F : 0.0F);
+
+            const auto copy = block;
+            tap.process(block.data(), 256);
+            REQUIRE(block == copy);
+        }
+
+        REQUIRE(tap.getFramesWritten() == 1024 + 512);
+
+        std::vector<float> output(100 * 2);
+        REQUIRE(tap.copy(1000, output.data(), 100));
+        REQUIRE(output[0] == 1000.0F);
+        REQUIRE(output[199] == 1099.5F);
+
+        REQUIRE(tap.copyLatest(output.data(), 100));
+        REQUIRE(output[0] == 1436.0F);
+
+        // overwritten and not written yet
+        REQUIRE_FALSE(tap.copy(500, output.data(), 100));
+        REQUIRE_FALSE(tap.copy(1500, output.data(), 100));
+    }
+
+    SECTION("Readers")
+    {
+        pcmplayer::dsp::AnalysisTap tap(4096);
+        tap.prepare(48000, 256, 1);
+
+        std::atomic<bool> running{true};
+        std::atomic<bool> consistent{true};
+        std::atomic<std::uint32_t> copies{0};
+
+        const auto read = [&]() {
+            std::vector<float> output(512);
+            while (running)
+            {
+                const auto end = tap.getFramesWritten();
+                if (end < 512 || !tap.copy(end - 512, output.data(), 512)) continue;
+
+                ++copies;
+                for (std::size_t i = 0; i < output.size(); ++i)
+                    if (output[i] != static_cast<float>((end - 512 + i) % 65536))
+                        consistent = false;
+            }
+        };
+
+        std::thread first(read);
+        std::thread second(read);
+
+        std::vector<float> block(256);
+        for (std::uint64_t frame = 0; frame < 256 * 20000; frame += 256)
+        {
+            for (std::size_t i = 0; i < block.size(); ++i)
+                block[i] = static_cast<float>((frame + i) % 65536);
+            tap.process(block.data(), 256);
+        }
+
+        running = false;
+        first.join();
+        second.join();
+
+        REQUIRE(consistent);
+        REQUIRE(copies > 0);
+    }
+
+    SECTION("Spectrum")
+    {
+        pcmplayer::dsp::AnalysisTap tap;
+        tap.prepare(48000, 256, 2);
+
+        pcmplayer::dsp::Spectrum spectrum(1024);
+        REQUIRE_FALSE(spectrum.update(tap));
+
+        // in the center of a bin
+        const auto bin = 64;
+        const auto frequency = spectrum.getFrequency(bin, 48000);
+        REQUIRE(frequency == Approx(3000.0));
+
+        constexpr double pi = 3.14159265358979323846;
+        std::vector<float> block(256 * 2);
+        for (std::uint32_t frame = 0; frame < 2048; frame += 256)
+        {
+            for (std::uint32_t i = 0; i < 256; ++i)
+                block[i * 2] = block[i * 2 + 1] = static_cast<float>(0.5 * std::sin(2.0 * pi * frequency * (frame + i) / 48000.0));
+            tap.process(block.data(), 256);
+        }
+
+        REQUIRE(spectrum.update(tap));
+        const auto& magnitudes = spectrum.getMagnitudes();
+        REQUIRE(magnitudes.size() == 513);
+        REQUIRE(magnitudes[bin] == Approx(20.0 * std::log10(0.5)).margin(0.01));
+        REQUIRE(magnitudes[bin + 10] < -100.0F);
+        REQUIRE(magnitudes[0] < -100.0F);
+    }
+
+    SECTION("Player")
+    {
+        pcmplayer::dsp::AnalysisTap tap;
+
+        pcmplayer::null::DiscardSink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 256, 48000, pcmplayer::SampleFormat::signedInt16, 2);
+        audioPlayer.setTap(tap);
+        audioPlayer.play(pcmplayer::SampleBuffer(1000 * 2, 0.25F));
+
+        REQUIRE(tap.getFramesWritten() == 1024);
+
+        std::vector<float> output(1000 * 2);
+        REQUIRE(tap.copy(0, output.data(), 1000));
+        REQUIRE(output.front() == 0.25F);
+        REQUIRE(output.back() == 0.25F);
+    }
+}
@@ -0,0 +1,91 @@
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "catch2/catch.hpp"
+#include "dsp/Convolution.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+TEST_CASE("Convolution", "[convolution]")
+{
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(-1.0F, 1.0F);
+
+    SECTION("FFT")
+    {
+        constexpr std::size_t size = 32;
+        std::vector<float> input(size);
+        for (auto& sample : input) sample = distribution(generator);
+
+        pcmplayer::dsp::Fft fft(size);
+        std::vector<float> real(fft.getBins());
+        std::vector<float> imag(fft.getBins());
+        fft.forward(input.data(), real.data(), imag.data());
+
+        for (std::size_t k = 0; k < fft.getBins(); ++k)
+        {
+            double expectedReal = 0.0;
+            double expectedImag = 0.0;
+            for (std::size_t n = 0; n < size; ++n)
+            {
+                expectedReal += input[n] * std::cos(2.0 * 3.14159265358979 * k * n / size);
+                expectedImag -= input[n] * std::sin(2.0 * 3.14159265358979 * k * n / size);
+            }
+            REQUIRE(real[k] == Approx(expectedReal).margin(0.0001));
+            REQUIRE(imag[k] == Approx(expectedImag).margin(0.0001));
+        }
+
+        std::vector<float> output(size);
+        fft.inverse(real.data(), imag.data(), output.data());
+        for (std::size_t n = 0; n < size; ++n)
+            REQUIRE(output[n] / size == Approx(input[n]).margin(0.0001));
+    }
+
+    SECTION("Direct")
+    {
+        // long enough for partitions of three sizes
+        pcmplayer::SampleBuffer impulseResponse(5000);
+        for (auto& sample : impulseResponse) sample = distribution(generator) * 0.01F;
+
+        std::vector<float> input(20000);
+        for (auto& sample : input) sample = distribution(generator);
+
+        pcmplayer::dsp::Convolution convolution(impulseResponse, 1, 48000);
+        convolution.prepare(48000, 64, 1);
+        REQUIRE(convolution.getLatency() == 64);
+
+        auto output = input;
+        for (std::size_t frame = 0; frame < output.size(); frame += 50)
+            convolution.process(output.data() + frame, 50);
+
+        for (std::size_t frame = 0; frame < output.size(); frame += 97)
+        {
+            double expected = 0.0;
+            for (std::size_t i = 0; i < impulseResponse.size() && i + 64 <= frame; ++i)
+                expected += impulseResponse[i] * input[frame - 64 - i];
+
+            REQUIRE(output[frame] == Approx(expected).margin(0.001));
+        }
+    }
+
+    SECTION("Player")
+    {
+        pcmplayer::dsp::Convolution convolution({0.5F}, 1, 44100);
+
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 256, 44100, pcmplayer::SampleFormat::float32, 2);
+        audioPlayer.addProcessor(convolution);
+        audioPlayer.play(pcmplayer::SampleBuffer{1.0F, -1.0F, 0.5F, 0.25F});
+
+        // the latency of one block of the player is flushed at the end
+        const auto latency = convolution.getLatency();
+        std::vector<float> result(sink.getData().size() / sizeof(float));
+        std::memcpy(result.data(), sink.getData().data(), sink.getData().size());
+        REQUIRE(result.size() == (2 + latency) * 2);
+        REQUIRE(result[0] == 0.0F);
+        REQUIRE(result[latency * 2] == Approx(0.5F));
+        REQUIRE(result[latency * 2 + 1] == Approx(-0.5F));
+        REQUIRE(result[latency * 2 + 2] == Approx(0.25F));
+        REQUIRE(result[latency * 2 + 3] == Approx(0.125F));
+    }
+}
@@ -0,0 +1,114 @@
+#include <cmath>
+#include <complex>
+#include <random>
+#include "catch2/catch.hpp"
+#include "dsp/Equalizer.hpp"
+
+namespace
+{
+    double getMagnitude(const pcmplayer::dsp::BiquadCoefficients& c, double frequency, double sampleRate)
+    {
+        const auto z = std::polar(1.0, -2.0 * 3.14159265358979 * frequency / sampleRate);
+        const double b0 = c.b0, b1 = c.b1, b2 = c.b2, a1 = c.a1, a2 = c.a2;
+        return std::abs((b0 + b1 * z + b2 * z * z) / (1.0 + a1 * z + a2 * z * z));
+    }
+
+    // a scalar reference in double precision
+    void filter(const pcmplayer::dsp::BiquadCoefficients& c, std::vector<double>& samples)
+    {
+        double z1 = 0.0, z2 = 0.0;
+        for (auto& sample : samples)
+        {
+            const auto output = c.b0 * sample + z1;
+            z1 = c.b1 * sample - c.a1 * output + z2;
+            z2 = c.b2 * sample - c.a2 * output;
+            sample = output;
+        }
+    }
+}
+
+TEST_CASE("Equalizer", "[equalizer]")
+{
+    using Type = pcmplayer::dsp::EqualizerBand::Type;
+
+    SECTION("Coefficients")
+    {
+        const auto peaking = pcmplayer::dsp::getCoefficients({Type::peaking, 1000.0F, 6.0F, 1.0F}, 48000);
+        REQUIRE(getMagnitude(peaking, 1000.0, 48000.0) == Approx(std::pow(10.0, 6.0 / 20.0)).epsilon(0.001));
+        REQUIRE(getMagnitude(peaking, 20.0, 48000.0) == Approx(1.0).epsilon(0.01));
+
+        const auto lowPass = pcmplayer::dsp::getCoefficients({Type::lowPass, 1000.0F, 0.0F, 0.7071F}, 48000);
+        REQUIRE(getMagnitude(lowPass, 0.0, 48000.0) == Approx(1.0).epsilon(0.001));
+        REQUIRE(getMagnitude(lowPass, 1000.0, 48000.0) == Approx(0.7071).epsilon(0.01));
+        REQUIRE(getMagnitude(lowPass, 20000.0, 48000.0) < 0.01);
+
+        const auto highPass = pcmplayer::dsp::getCoefficients({Type::highPass, 100.0F, 0.0F, 0.7071F}, 48000);
+        REQUIRE(getMagnitude(highPass, 0.0, 48000.0) == Approx(0.0).margin(0.0001));
+        REQUIRE(getMagnitude(highPass, 10000.0, 48000.0) == Approx(1.0).epsilon(0.001));
+
+        const auto lowShelf = pcmplayer::dsp::getCoefficients({Type::lowShelf, 200.0F, -6.0F, 0.7071F}, 48000);
+        REQUIRE(getMagnitude(lowShelf, 0.0, 48000.0) == Approx(std::pow(10.0, -6.0 / 20.0)).epsilon(0.001));
+
+        const auto highShelf = pcmplayer::dsp::getCoefficients({Type::highShelf, 5000.0F, 6.0F, 0.7071F}, 48000);
+        REQUIRE(getMagnitude(highShelf, 24000.0, 48000.0) == Approx(std::pow(10.0, 6.0 / 20.0)).epsilon(0.001));
+    }
+
+    SECTION("Channels")
+    {
+        // a full group of lanes and a partial one, with a band of one channel changed
+        constexpr std::uint16_t channels = 6;
+        constexpr std::size_t frames = 1000;
+        const pcmplayer::dsp::EqualizerBand first{Type::peaking, 1000.0F, 6.0F, 2.0F};
+        const pcmplayer::dsp::EqualizerBand second{Type::lowPass, 5000.0F, 0.0F, 0.7071F};
+        const pcmplayer::dsp::EqualizerBand changed{Type::highPass, 200.0F, 0.0F, 0.7071F};
+
+        pcmplayer::dsp::Equalizer equalizer(2);
+        equalizer.setBand(0, first);
+        equalizer.setBand(1, second);
+        REQUIRE_THROWS_AS(equalizer.setBand(0, 5, changed), std::out_of_range);
+        REQUIRE_THROWS_AS(pcmplayer::dsp::Equalizer(0), std::invalid_argument);
+        equalizer.prepare(48000, 512, channels);
+        equalizer.setBand(1, 5, changed);
+        equalizer.prepare(48000, 512, channels); // applies the change without smoothing
+
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> distribution(-1.0F, 1.0F);
+        std::vector<float> samples(frames * channels);
+        for (auto& sample : samples) sample = distribution(generator);
+
+        auto output = samples;
+        equalizer.process(output.data(), frames);
+
+        for (std::uint16_t channel = 0; channel < channels; ++channel)
+        {
+            std::vector<double> expected(frames);
+            for (std::size_t frame = 0; frame < frames; ++frame)
+                expected[frame] = samples[frame * channels + channel];
+
+            filter(pcmplayer::dsp::getCoefficients(first, 48000), expected);
+            filter(pcmplayer::dsp::getCoefficients(channel == 5 ? changed : second, 48000), expected);
+
+            for (std::size_t frame = 0; frame < frames; ++frame)
+                REQUIRE(output[frame * channels + channel] == Approx(expected[frame]).margin(0.0001));
+        }
+    }
+
+    SECTION("Smoothing")
+    {
+        pcmplayer::dsp::Equalizer equalizer(1, 0.01F);
+        equalizer.prepare(48000, 512, 1);
+
+        std::vector<float> samples(48000, 0.5F);
+        equalizer.process(samples.data(), 4800);
+        REQUIRE(samples[4799] == Approx(0.5F));
+
+        // a DC signal through a low shelf glides from unity to the new gain
+        equalizer.setBand(0, {Type::lowShelf, 1000.0F, -6.0F, 0.7071F});
+        equalizer.process(samples.data() + 4800, 48000 - 4800);
+
+        REQUIRE(samples[4800] > 0.49F);
+        for (std::size_t i = 4801; i < 48000; ++i)
+            REQUIRE(std::fabs(samples[i] - samples[i - 1]) < 0.01F);
+        REQUIRE(samples.back() == Approx(0.5F * std::pow(10.0F, -6.0F / 20.0F)).epsilon(0.001));
+    }
+}
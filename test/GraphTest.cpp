@@ -0,0 +1,194 @@
+#include <cstring>
+#include <deque>
+#include "catch2/catch.hpp"
+#include "dsp/Gain.hpp"
+#include "dsp/Graph.hpp"
+#include "dsp/Limiter.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+namespace
+{
+    pcmplayer::SampleBuffer makeRamp(std::size_t frames, float step)
+    {
+        pcmplayer::SampleBuffer samples(frames * 2);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+            samples[i] = static_cast<float>(i % 100) * step;
+        return samples;
+    }
+
+    // a source per track through a gain into two buses and a master gain
+    std::vector<float> render(std::size_t workerCount, std::size_t tracks, std::size_t frames)
+    {
+        // the nodes keep references to them
+        std::deque<pcmplayer::BufferSource> sources;
+        std::deque<pcmplayer::dsp::Gain> gains;
+
+        pcmplayer::dsp::Graph graph(2, 128);
+        const auto left = graph.addBus();
+        const auto right = graph.addBus();
+
+        for (std::size_t track = 0; track < tracks; ++track)
+        {
+            sources.emplace_back(makeRamp(frames + track * 10, 0.001F * static_cast<float>(track + 1)), 2);
+            gains.emplace_back(0.5F);
+            const auto source = graph.addSource(sources.back());
+            const auto gain = graph.addProcessor(gains.back());
+            graph.connect(source, gain);
+            graph.connect(gain, track % 2 ? right : left, 0.25F);
+        }
+
+        gains.emplace_back(2.0F);
+        const auto master = graph.addProcessor(gains.back());
+        graph.connect(left, master);
+        graph.connect(right, master, 0.5F);
+        graph.prepare(48000, master, workerCount);
+
+        std::vector<float> result;
+        std::vector<float> block(300 * 2);
+        while (!graph.isFinished())
+        {
+            const auto frameCount = graph.read(block.data(), 300);
+            result.insert(result.end(), block.begin(), block.begin() + frameCount * 2);
+        }
+
+        return result;
+    }
+}
+
+TEST_CASE("Graph", "[graph]")
+{
+    SECTION("Mix")
+    {
+        pcmplayer::BufferSource first(pcmplayer::SampleBuffer(1000 * 2, 0.5F), 2);
+        pcmplayer::BufferSource second(pcmplayer::SampleBuffer(600 * 2, 0.25F), 2);
+
+        pcmplayer::dsp::Graph graph(2, 256);
+        const auto bus = graph.addBus();
+        graph.connect(graph.addSource(first), bus);
+        graph.connect(graph.addSource(second), bus, 2.0F);
+        graph.prepare(48000, bus, 0);
+
+        std::vector<float> output(2000 * 2, -1.0F);
+        REQUIRE(graph.read(output.data(), 2000) == 1000);
+        REQUIRE(graph.isFinished());
+        REQUIRE(output[0] == 1.0F);
+        REQUIRE(output[599 * 2 + 1] == 1.0F);
+        REQUIRE(output[600 * 2] == 0.5F);
+        REQUIRE(output[999 * 2 + 1] == 0.5F);
+        REQUIRE(output[1000 * 2] == -1.0F);
+    }
+
+    SECTION("Parallel")
+    {
+        const auto serial = render(0, 16, 5000);
+        REQUIRE(serial.size() == (5000 + 150) * 2);
+
+        for (const std::size_t workerCount : {1, 3})
+        {
+            INFO("Workers " << workerCount);
+            REQUIRE(render(workerCount, 16, 5000) == serial);
+        }
+    }
+
+    SECTION("Cycle")
+    {
+        pcmplayer::dsp::Gain first(1.0F);
+        pcmplayer::dsp::Gain second(1.0F);
+
+        pcmplayer::dsp::Graph graph(1);
+        const auto a = graph.addProcessor(first);
+        const auto b = graph.addProcessor(second);
+        graph.connect(a, b);
+        graph.connect(b, a);
+        REQUIRE_THROWS_AS(graph.prepare(48000, b, 0), std::runtime_error);
+
+        pcmplayer::BufferSource source;
+        const auto input = graph.addSource(source);
+        REQUIRE_THROWS_AS(graph.connect(a, input), std::runtime_error);
+        REQUIRE_THROWS_AS(graph.connect(a, 10), std::out_of_range);
+    }
+
+    SECTION("Player")
+    {
+        pcmplayer::BufferSource source(pcmplayer::SampleBuffer(4800 * 2, 0.25F), 2);
+        pcmplayer::dsp::Gain gain(2.0F);
+
+        pcmplayer::dsp::Graph graph(2);
+        const auto output = graph.addProcessor(gain);
+        graph.connect(graph.addSource(source), output);
+        graph.prepare(48000, output, 2);
+
+        pcmplayer::null::MemorySink sink(4800 * 2 * sizeof(float));
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 256, 48000, pcmplayer::SampleFormat::float32, 2);
+        audioPlayer.play(graph);
+
+        const auto& data = sink.getData();
+        REQUIRE(data.size() == 4800 * 2 * sizeof(float));
+
+        float last;
+        std::memcpy(&last, data.data() + data.size() - sizeof(float), sizeof(float));
+        REQUIRE(last == 0.5F);
+    }
+
+    SECTION("Latency")
+    {
+        // played out after the end of the source
+        pcmplayer::BufferSource source(pcmplayer::SampleBuffer(1000 * 2, 0.25F), 2);
+        pcmplayer::dsp::LimiterSettings settings;
+        settings.lookahead = 0.001F;
+        pcmplayer::dsp::Limiter limiter(settings);
+
+        pcmplayer::dsp::Graph graph(2, 256);
+        const auto output = graph.addProcessor(limiter);
+        graph.connect(graph.addSource(source), output);
+        graph.prepare(48000, output, 0);
+        REQUIRE(graph.getLatency() == 48);
+
+        std::vector<float> result(2000 * 2, -1.0F);
+        REQUIRE(graph.read(result.data(), 2000) == 1048);
+        REQUIRE(graph.isFinished());
+        REQUIRE(result[47 * 2] == 0.0F);
+        REQUIRE(result[48 * 2] == 0.25F);
+        REQUIRE(result[1047 * 2 + 1] == 0.25F);
+        REQUIRE(result[1048 * 2] == -1.0F);
+    }
+
+#if !defined(_WIN32)
+    SECTION("Fallback")
+    {
+        // out of the range of every policy, so the workers can not be configured
+        pcmplayer::RenderThreadSettings settings;
+        settings.policy = pcmplayer::RenderThreadSettings::Policy::fifo;
+        settings.priority = 1000;
+
+        pcmplayer::BufferSource first(pcmplayer::SampleBuffer(1000 * 2, 0.5F), 2);
+        pcmplayer::dsp::Graph graph(2);
+        const auto bus = graph.addBus();
+        graph.connect(graph.addSource(first), bus);
+        graph.prepare(48000, bus, 2, settings);
+        REQUIRE_FALSE(graph.isParallel());
+
+        std::vector<float> result(1000 * 2);
+        REQUIRE(graph.read(result.data(), 1000) == 1000);
+        REQUIRE(result.back() == 0.5F);
+
+        // the settings of the player
+        pcmplayer::BufferSource second(pcmplayer::SampleBuffer(4800 * 2, 0.5F), 2);
+        pcmplayer::dsp::Graph playerGraph(2);
+        const auto playerBus = playerGraph.addBus();
+        playerGraph.connect(playerGraph.addSource(second), playerBus);
+        playerGraph.prepare(48000, playerBus, 2);
+        REQUIRE(playerGraph.isParallel());
+
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 256, 48000, pcmplayer::SampleFormat::float32, 2);
+        audioPlayer.setRenderThreadSettings(settings);
+        audioPlayer.play(playerGraph);
+
+        REQUIRE_FALSE(playerGraph.isParallel());
+        REQUIRE(sink.getData().size() == 4800 * 2 * sizeof(float));
+    }
+#endif
+}
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "catch2/catch.hpp"
+#include "dsp/Limiter.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+TEST_CASE("Limiter", "[limiter]")
+{
+    SECTION("Threshold")
+    {
+        pcmplayer::dsp::LimiterSettings settings;
+        settings.threshold = 0.5F;
+        pcmplayer::dsp::Limiter limiter(settings);
+        limiter.prepare(48000, 1000, 3);
+
+        // sudden peaks, a channel count that does not fill the lanes and odd block sizes
+        std::vector<float> samples(48000 * 3);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+            samples[i] = (i % 997 == 0 ? 4.0F : 0.9F) * std::sin(static_cast<float>(i) * 0.01F);
+
+        // a quarter of a second per block size, the last block of each is shorter
+        std::size_t frame = 0;
+        for (const std::uint32_t frames : {1U, 100U, 257U, 1000U})
+            for (const auto end = frame + 12000; frame < end;)
+            {
+                const auto count = static_cast<std::uint32_t>(std::min<std::size_t>(frames, end - frame));
+                limiter.process(samples.data() + frame * 3, count);
+                frame += count;
+            }
+
+        REQUIRE(frame == 48000);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+            REQUIRE(std::fabs(samples[i]) <= 0.5F * 1.0001F);
+    }
+
+    SECTION("Latency")
+    {
+        pcmplayer::dsp::LimiterSettings settings;
+        settings.lookahead = 0.001F;
+        pcmplayer::dsp::Limiter limiter(settings);
+        limiter.prepare(48000, 200, 2);
+        REQUIRE(limiter.getLatency() == 48);
+
+        // below the threshold the samples pass untouched
+        std::vector<float> samples(200 * 2, 0.0F);
+        samples[0] = 0.75F;
+        samples[1] = -0.25F;
+        limiter.process(samples.data(), 200);
+
+        REQUIRE(samples[0] == 0.0F);
+        REQUIRE(samples[48 * 2] == 0.75F);
+        REQUIRE(samples[48 * 2 + 1] == -0.25F);
+    }
+
+    SECTION("Player")
+    {
+        pcmplayer::dsp::LimiterSettings settings;
+        settings.threshold = 0.5F;
+        settings.lookahead = 0.001F;
+        settings.attack = 0.001F;
+
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 64, 48000, pcmplayer::SampleFormat::float32, 1);
+        audioPlayer.setLimiter(settings);
+        audioPlayer.play(pcmplayer::SampleBuffer(1000, 1.0F));
+
+        // the end of the data is not cut off by the lookahead
+        REQUIRE(sink.getData().size() == (1000 + 48) * sizeof(float));
+
+        std::vector<float> result(1000 + 48);
+        std::memcpy(result.data(), sink.getData().data(), sink.getData().size());
+        REQUIRE(result[0] == 0.0F);
+        REQUIRE(result[500] == Approx(0.5F));
+        for (const auto sample : result)
+            REQUIRE(sample <= 0.5F * 1.0001F);
+    }
+}
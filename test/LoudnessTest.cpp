@@ -0,0 +1,88 @@
+#include <cmath>
+#include "catch2/catch.hpp"
+#include "dsp/Loudness.hpp"
+
+namespace
+{
+    std::vector<float> getSine(float frequency, float amplitude, float phase,
+                               std::uint32_t sampleRate, std::uint16_t channels, std::size_t frames)
+    {
+        std::vector<float> result(frames * channels);
+        for (std::size_t frame = 0; frame < frames; ++frame)
+            for (std::uint16_t channel = 0; channel < channels; ++channel)
+                result[frame * channels + channel] = amplitude *
+                    std::sin(2.0F * 3.14159265F * frequency * static_cast<float>(frame) / static_cast<float>(sampleRate) + phase);
+        return result;
+    }
+}
+
+TEST_CASE("Loudness", "[loudness]")
+{
+    SECTION("Sine")
+    {
+        // EBU Tech 3341 test 1: a 1 kHz sine at -23 dBFS in both channels is -23 LUFS
+        const auto samples = getSine(1000.0F, std::pow(10.0F, -23.0F / 20.0F), 0.0F, 48000, 2, 48000 * 20);
+        const auto meter = pcmplayer::dsp::LoudnessMeter::analyze(samples.data(), samples.size() / 2, 48000, 2, 1);
+
+        REQUIRE(meter.getIntegratedLoudness() == Approx(-23.0).margin(0.1));
+        REQUIRE(meter.getMomentaryLoudness() == Approx(-23.0).margin(0.1));
+        REQUIRE(meter.getShortTermLoudness() == Approx(-23.0).margin(0.1));
+        REQUIRE(meter.getMaxShortTermLoudness() == Approx(-23.0).margin(0.1));
+        REQUIRE(meter.getSamplePeak() == Approx(std::pow(10.0F, -23.0F / 20.0F)).epsilon(0.001));
+        REQUIRE(meter.getRms() == Approx(std::pow(10.0F, -23.0F / 20.0F) / std::sqrt(2.0F)).epsilon(0.001));
+    }
+
+    SECTION("Gating")
+    {
+        // EBU Tech 3341 test 3: 10 s at -36 dBFS, 60 s at -23 dBFS and 10 s at -36 dBFS
+        std::vector<float> samples;
+        for (const auto level : {-36.0F, -23.0F, -36.0F})
+        {
+            const auto part = getSine(1000.0F, std::pow(10.0F, level / 20.0F), 0.0F, 48000, 2,
+                                      48000 * (level == -23.0F ? 60 : 10));
+            samples.insert(samples.end(), part.begin(), part.end());
+        }
+
+        const auto meter = pcmplayer::dsp::LoudnessMeter::analyze(samples.data(), samples.size() / 2, 48000, 2, 1);
+        REQUIRE(meter.getIntegratedLoudness() == Approx(-23.0).margin(0.1));
+    }
+
+    SECTION("True peak")
+    {
+        // sampled between its peaks, so the sample peak is only 1/sqrt(2)
+        const auto samples = getSine(12000.0F, 1.0F, 3.14159265F / 4.0F, 48000, 1, 4800);
+        const auto meter = pcmplayer::dsp::LoudnessMeter::analyze(samples.data(), samples.size(), 48000, 1, 1);
+
+        REQUIRE(meter.getSamplePeak() == Approx(0.7071F).epsilon(0.001));
+        REQUIRE(meter.getTruePeak() == Approx(1.0F).margin(0.05));
+    }
+
+    SECTION("Parallel")
+    {
+        // six channels use two groups of lanes and the surround weights
+        auto samples = getSine(440.0F, 0.25F, 0.0F, 44100, 6, 44100 * 7 + 123);
+        for (std::size_t i = 0; i < samples.size(); i += 13)
+            samples[i] *= -1.5F;
+
+        auto serial = pcmplayer::dsp::LoudnessMeter(44100, 6);
+        serial.process(samples.data(), samples.size() / 6);
+        serial.finish();
+
+        const auto parallel = pcmplayer::dsp::LoudnessMeter::analyze(samples.data(), samples.size() / 6, 44100, 6, 8);
+
+        REQUIRE(parallel.getIntegratedLoudness() == Approx(serial.getIntegratedLoudness()).margin(0.001));
+        REQUIRE(parallel.getMaxMomentaryLoudness() == Approx(serial.getMaxMomentaryLoudness()).margin(0.001));
+        REQUIRE(parallel.getSamplePeak() == serial.getSamplePeak());
+        REQUIRE(parallel.getTruePeak() == Approx(serial.getTruePeak()).epsilon(0.0001));
+        REQUIRE(parallel.getRms() == Approx(serial.getRms()).epsilon(0.0001));
+    }
+
+    SECTION("Silence")
+    {
+        const std::vector<float> samples(48000, 0.0F);
+        const auto meter = pcmplayer::dsp::LoudnessMeter::analyze(samples.data(), samples.size(), 48000, 1);
+
+        REQUIRE(std::isinf(meter.getIntegratedLoudness()));
+        REQUIRE(meter.getSamplePeak() == 0.0F);
+    }
+}
@@ -0,0 +1,128 @@
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include "catch2/catch.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+TEST_CASE("NullAudioPlayer", "[null_audio_player]")
+{
+    const pcmplayer::SampleBuffer samples = {0.0F, 0.5F, -0.5F, 1.0F, -1.0F, 0.25F, -0.25F};
+
+    SECTION("Memory")
+    {
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 2, 44100, pcmplayer::SampleFormat::signedInt16, 1);
+        audioPlayer.play(samples);
+
+        REQUIRE(audioPlayer.getClock() == 8);
+        REQUIRE(audioPlayer.getMetrics().getCallbacks() == 4);
+        REQUIRE(sink.getData().size() == samples.size() * sizeof(std::int16_t));
+
+        std::int16_t result[7];
+        std::memcpy(result, sink.getData().data(), sizeof(result));
+        REQUIRE(result[0] == 0);
+        REQUIRE(result[1] == 16384);
+        REQUIRE(result[3] == 32767);
+        REQUIRE(result[4] == -32767);
+    }
+
+    SECTION("Start frame")
+    {
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 4, 44100, pcmplayer::SampleFormat::unsignedInt8, 1);
+        audioPlayer.setStartFrame(5);
+        audioPlayer.play(samples);
+
+        REQUIRE(sink.getData().size() == 5 + samples.size());
+        for (std::size_t i = 0; i < 5; ++i)
+            REQUIRE(sink.getData()[i] == 0x80);
+        REQUIRE(sink.getData()[5] == 0x80);
+        REQUIRE(sink.getData()[8] == 0xFF);
+
+    }
+
+    SECTION("Start frame bit-exact")
+    {
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 2, 44100, pcmplayer::SampleFormat::signedInt16, 1);
+        audioPlayer.setStartFrame(3);
+        audioPlayer.playBitExact({1, 2, 3, 4}, pcmplayer::SampleFormat::signedInt16);
+
+        REQUIRE(sink.getData() == std::vector<std::uint8_t>{0, 0, 0, 0, 0, 0, 1, 2, 3, 4});
+    }
+
+    SECTION("Loop")
+    {
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 3, 44100, pcmplayer::SampleFormat::unsignedInt8, 1);
+        audioPlayer.setLoop(pcmplayer::Loop{1, 3, 3});
+        audioPlayer.playBitExact({1, 2, 3, 4}, pcmplayer::SampleFormat::unsignedInt8);
+
+        REQUIRE(sink.getData() == std::vector<std::uint8_t>{1, 2, 3, 2, 3, 2, 3, 4});
+
+        pcmplayer::null::MemorySink floatSink;
+        pcmplayer::null::AudioPlayer floatPlayer(floatSink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 3, 44100, pcmplayer::SampleFormat::float32, 1);
+        floatPlayer.setLoop(pcmplayer::Loop{2, 4, 2});
+        floatPlayer.play({0.1F, 0.2F, 0.3F, 0.4F});
+
+        std::vector<float> result(floatSink.getData().size() / sizeof(float));
+        std::memcpy(result.data(), floatSink.getData().data(), floatSink.getData().size());
+        REQUIRE(result == std::vector<float>{0.1F, 0.2F, 0.3F, 0.4F, 0.3F, 0.4F});
+    }
+
+    SECTION("Discard")
+    {
+        pcmplayer::null::DiscardSink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::realTime,
+                                                 4, 44100, pcmplayer::SampleFormat::float32, 1);
+        audioPlayer.play(samples);
+
+        REQUIRE(sink.getBytesWritten() == samples.size() * sizeof(float));
+    }
+
+    SECTION("File")
+    {
+        std::stringstream stream;
+        {
+            pcmplayer::null::FileSink sink(stream, pcmplayer::SampleFormat::signedInt16, 1, 44100);
+            pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                     4, 44100, pcmplayer::SampleFormat::signedInt16, 1);
+            audioPlayer.play(samples);
+        }
+
+        stream.seekg(0);
+        Wav wav(stream);
+        REQUIRE(wav.getChannels() == 1);
+        REQUIRE(wav.getSampleRate() == 44100);
+        REQUIRE(wav.getFrames() == samples.size());
+        REQUIRE(wav.getSampleFormat() == pcmplayer::SampleFormat::signedInt16);
+        REQUIRE(wav.getSamples()[1] == Approx(0.5F).margin(0.0001F));
+    }
+
+    SECTION("FilePadding")
+    {
+        std::stringstream stream;
+        {
+            pcmplayer::null::FileSink sink(stream, pcmplayer::SampleFormat::unsignedInt8, 1, 44100);
+            const std::uint8_t data[] = {1, 2, 3};
+            sink.write(data, sizeof(data));
+
+            // rejected before anything is written
+            REQUIRE_THROWS_AS(sink.write(data, std::numeric_limits<std::size_t>::max()), std::runtime_error);
+        }
+
+        const auto file = stream.str();
+        REQUIRE(file.size() == 44 + 4);
+        REQUIRE(file[4] == 40); // the RIFF size includes the pad byte
+        REQUIRE(file[40] == 3); // the data chunk size does not
+        REQUIRE(file.back() == 0);
+
+        Wav wav(stream);
+        REQUIRE(wav.getFrames() == 3);
+    }
+}
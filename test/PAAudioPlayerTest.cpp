@@ -0,0 +1,107 @@
+#include <pulse/pulseaudio.h>
+#include "catch2/catch.hpp"
+#include "pulseaudio/PAAudioPlayer.hpp"
+
+namespace
+{
+    // loads a module-null-sink for the duration of the test, needs a running server but no sound card
+    class NullSink final
+    {
+    public:
+        explicit NullSink(const std::string& name)
+        {
+            mainloop = pa_mainloop_new();
+            context = pa_context_new(pa_mainloop_get_api(mainloop), "pcmplayer-test");
+
+            if (pa_context_connect(context, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0)
+                throw std::runtime_error("Failed to connect to the server");
+
+            for (;;)
+            {
+                const auto state = pa_context_get_state(context);
+                if (state == PA_CONTEXT_READY) break;
+                if (!PA_CONTEXT_IS_GOOD(state))
+                    throw std::runtime_error("Failed to connect to the server");
+
+                pa_mainloop_iterate(mainloop, 1, nullptr);
+            }
+
+            const auto moduleCallback = [](pa_context*, std::uint32_t index, void* userdata) {
+                *static_cast<std::uint32_t*>(userdata) = index;
+            };
+
+            const auto arguments = "sink_name=" + name;
+            wait(pa_context_load_module(context, "module-null-sink", arguments.c_str(), moduleCallback, &module));
+            if (module == PA_INVALID_INDEX)
+                throw std::runtime_error("Failed to load module-null-sink");
+        }
+
+        ~NullSink()
+        {
+            if (module != PA_INVALID_INDEX)
+                wait(pa_context_unload_module(context, module, nullptr, nullptr));
+
+            pa_context_disconnect(context);
+            pa_context_unref(context);
+            pa_mainloop_free(mainloop);
+        }
+
+        NullSink(const NullSink&) = delete;
+        NullSink& operator=(const NullSink&) = delete;
+
+    private:
+        void wait(pa_operation* operation)
+        {
+            if (!operation) return;
+
+            while (pa_operation_get_state(operation) == PA_OPERATION_RUNNING)
+                pa_mainloop_iterate(mainloop, 1, nullptr);
+
+            pa_operation_unref(operation);
+        }
+
+        pa_mainloop* mainloop = nullptr;
+        pa_context* context = nullptr;
+        std::uint32_t module = PA_INVALID_INDEX;
+    };
+}
+
+TEST_CASE("PAAudioPlayer", "[pa_audio_player]")
+{
+    NullSink nullSink("pcmplayer_test");
+
+    SECTION("Play")
+    {
+        pcmplayer::pulseaudio::AudioPlayer audioPlayer("pcmplayer_test", 1024, 48000, pcmplayer::SampleFormat::signedInt16, 2);
+        REQUIRE(audioPlayer.getSampleFormat() == pcmplayer::SampleFormat::signedInt16);
+
+        audioPlayer.play(pcmplayer::SampleBuffer(4800 * 2, 0.5F));
+
+        const auto& metrics = audioPlayer.getMetrics();
+        REQUIRE(metrics.getFramesRendered() >= 4800);
+        REQUIRE(metrics.getErrors() == 0);
+    }
+
+    SECTION("Twice")
+    {
+        // the second playback starts over after the first one has drained
+        pcmplayer::pulseaudio::AudioPlayer audioPlayer("pcmplayer_test", 1024, 48000, pcmplayer::SampleFormat::float32, 2);
+
+        audioPlayer.play(pcmplayer::SampleBuffer(4800 * 2, 0.5F));
+        const auto frames = audioPlayer.getMetrics().getFramesRendered();
+        REQUIRE(frames >= 4800);
+
+        audioPlayer.play(pcmplayer::SampleBuffer(4800 * 2, 0.25F));
+        REQUIRE(audioPlayer.getMetrics().getFramesRendered() >= frames + 4800);
+        REQUIRE(audioPlayer.getMetrics().getErrors() == 0);
+    }
+
+    SECTION("Packed24")
+    {
+        pcmplayer::pulseaudio::AudioPlayer audioPlayer("pcmplayer_test", 1024, 48000, pcmplayer::SampleFormat::signedInt24, 1);
+        REQUIRE(audioPlayer.getSampleFormat() == pcmplayer::SampleFormat::signedInt24);
+
+        audioPlayer.play(pcmplayer::SampleBuffer(4800, 0.25F));
+        REQUIRE(audioPlayer.getMetrics().getErrors() == 0);
+    }
+}
@@ -0,0 +1,64 @@
+#include <thread>
+#include "catch2/catch.hpp"
+#include "PlaybackClock.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+TEST_CASE("PlaybackClock", "[playback_clock]")
+{
+    const std::chrono::steady_clock::time_point start{std::chrono::seconds(10)};
+
+    SECTION("Extrapolate")
+    {
+        pcmplayer::PlaybackClock clock(1000);
+        clock.publish(pcmplayer::PlaybackPosition{100, start, 200});
+
+        REQUIRE(clock.read().frame == 100);
+        REQUIRE(clock.read().time == start);
+        REQUIRE(clock.getFrame(start) == 100);
+        REQUIRE(clock.getFrame(start + std::chrono::milliseconds(50)) == 150);
+        REQUIRE(clock.getFrame(start - std::chrono::milliseconds(50)) == 50);
+
+        // limited to the frames that have been rendered
+        REQUIRE(clock.getFrame(start + std::chrono::seconds(1)) == 200);
+        REQUIRE(clock.getFrame(start - std::chrono::seconds(1)) == 0);
+    }
+
+    SECTION("Concurrent")
+    {
+        pcmplayer::PlaybackClock clock(1000);
+        std::atomic<bool> done{false};
+
+        std::thread writer([&clock, &done, start]() {
+            for (std::uint64_t i = 1; i <= 100000; ++i)
+                clock.publish(pcmplayer::PlaybackPosition{i, start + std::chrono::milliseconds(i), i * 2});
+            done = true;
+        });
+
+        bool consistent = true;
+        while (!done)
+        {
+            const auto position = clock.read();
+            if (position.renderedFrames != position.frame * 2 ||
+                (position.frame && position.time != start + std::chrono::milliseconds(position.frame)))
+                consistent = false;
+        }
+
+        writer.join();
+        REQUIRE(consistent);
+        REQUIRE(clock.read().frame == 100000);
+    }
+
+    SECTION("Player")
+    {
+        pcmplayer::null::DiscardSink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 4, 44100, pcmplayer::SampleFormat::float32, 1);
+        audioPlayer.setStartFrame(3);
+        audioPlayer.play(pcmplayer::SampleBuffer(10, 0.5F));
+
+        const auto position = audioPlayer.getPlaybackPosition();
+        REQUIRE(position.frame == 16);
+        REQUIRE(position.renderedFrames == 16);
+        REQUIRE(audioPlayer.getPresentedFrame() == 16);
+    }
+}
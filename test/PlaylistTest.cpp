@@ -0,0 +1,69 @@
+#include <cmath>
+#include <cstring>
+#include "catch2/catch.hpp"
+#include "Playlist.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+namespace
+{
+    std::vector<float> getSinkSamples(const pcmplayer::null::MemorySink& sink)
+    {
+        std::vector<float> result(sink.getData().size() / sizeof(float));
+        std::memcpy(result.data(), sink.getData().data(), sink.getData().size());
+        return result;
+    }
+}
+
+TEST_CASE("Playlist", "[playlist]")
+{
+    pcmplayer::null::MemorySink sink;
+    pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                             4, 44100, pcmplayer::SampleFormat::float32, 1);
+
+    SECTION("Gapless")
+    {
+        pcmplayer::Playlist playlist(1);
+        playlist.setWaitForDecoder(true);
+        playlist.add([]() { return pcmplayer::SampleBuffer{0.1F, 0.1F, 0.1F}; });
+        playlist.add([]() { return pcmplayer::SampleBuffer{0.2F, 0.2F}; });
+        playlist.add([]() { return pcmplayer::SampleBuffer{0.3F, 0.3F, 0.3F, 0.3F}; });
+        audioPlayer.play(playlist);
+
+        REQUIRE(getSinkSamples(sink) == std::vector<float>{0.1F, 0.1F, 0.1F, 0.2F, 0.2F, 0.3F, 0.3F, 0.3F, 0.3F});
+        REQUIRE(playlist.getLateFrames() == 0);
+        REQUIRE(playlist.isFinished());
+    }
+
+    SECTION("Crossfade")
+    {
+        pcmplayer::Playlist playlist(1);
+        playlist.setWaitForDecoder(true);
+        playlist.setCrossfadeFrames(4);
+        playlist.add([]() { return pcmplayer::SampleBuffer(6, 1.0F); });
+        playlist.add([]() { return pcmplayer::SampleBuffer(6, 0.0F); });
+        audioPlayer.play(playlist);
+
+        const auto samples = getSinkSamples(sink);
+        REQUIRE(samples.size() == 8);
+        REQUIRE(samples[1] == 1.0F);
+        for (std::size_t i = 0; i < 4; ++i)
+            REQUIRE(samples[2 + i] == Approx(std::cos((static_cast<float>(i) + 0.5F) / 4.0F * 1.5707963F)));
+        REQUIRE(samples[7] == 0.0F);
+    }
+
+    SECTION("Failed item")
+    {
+        pcmplayer::Playlist playlist(2);
+        playlist.setWaitForDecoder(true);
+        playlist.add([]() -> pcmplayer::SampleBuffer { throw std::runtime_error("Failed"); });
+        playlist.add([]() { return pcmplayer::SampleBuffer{0.5F}; });
+        playlist.add([]() { return pcmplayer::SampleBuffer{0.5F, 0.5F}; });
+
+        pcmplayer::null::AudioPlayer stereoPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                  4, 44100, pcmplayer::SampleFormat::float32, 2);
+        stereoPlayer.play(playlist);
+
+        REQUIRE(playlist.getFailedItems() == 2);
+        REQUIRE(getSinkSamples(sink) == std::vector<float>{0.5F, 0.5F});
+    }
+}
@@ -0,0 +1,122 @@
+#include <cstring>
+#include "catch2/catch.hpp"
+#include "dsp/Gain.hpp"
+#include "dsp/ProcessorChain.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+namespace
+{
+    // delays the samples by a fixed number of frames and records the blocks
+    class Delay final: public pcmplayer::dsp::Processor
+    {
+    public:
+        explicit Delay(std::uint32_t initLatency): latency{initLatency} {}
+
+        void prepare(std::uint32_t newSampleRate, std::uint32_t newMaxBlockSize, std::uint16_t newChannels) final
+        {
+            sampleRate = newSampleRate;
+            maxBlockSize = newMaxBlockSize;
+            channels = newChannels;
+            line.assign(latency * channels, 0.0F);
+            blocks.reserve(64);
+        }
+
+        void process(float* samples, std::uint32_t frames) noexcept final
+        {
+            if (blocks.size() < blocks.capacity()) blocks.push_back(frames);
+
+            for (std::uint32_t i = 0; i < frames * channels && !line.empty(); ++i)
+            {
+                std::swap(samples[i], line[position]);
+                if (++position == line.size()) position = 0;
+            }
+        }
+
+        void reset() noexcept final
+        {
+            std::fill(line.begin(), line.end(), 0.0F);
+            position = 0;
+        }
+
+        std::uint32_t getLatency() const noexcept final { return latency; }
+
+        std::uint32_t latency;
+        std::uint32_t sampleRate = 0;
+        std::uint32_t maxBlockSize = 0;
+        std::uint16_t channels = 0;
+        std::vector<float> line;
+        std::size_t position = 0;
+        std::vector<std::uint32_t> blocks;
+    };
+}
+
+TEST_CASE("ProcessorChain", "[processor_chain]")
+{
+    SECTION("Blocks")
+    {
+        Delay delay(0);
+        pcmplayer::dsp::ProcessorChain chain;
+        chain.add(delay);
+        chain.prepare(44100, 512, 2);
+
+        REQUIRE(delay.sampleRate == 44100);
+        REQUIRE(delay.maxBlockSize == 512);
+        REQUIRE(delay.channels == 2);
+
+        std::vector<float> samples(1300 * 2, 0.5F);
+        chain.process(samples.data(), 1300);
+        REQUIRE(delay.blocks == std::vector<std::uint32_t>{512, 512, 276});
+    }
+
+    SECTION("Offline")
+    {
+        pcmplayer::dsp::Gain gain(0.5F);
+        Delay delay(2);
+        pcmplayer::dsp::ProcessorChain chain;
+        chain.prepare(48000, 4, 1);
+        chain.add(gain);
+        chain.add(delay);
+        REQUIRE(chain.getLatency() == 2);
+
+        std::vector<float> samples = {1.0F, 2.0F, 3.0F, 4.0F, 5.0F, 6.0F, 0.0F, 0.0F};
+        chain.process(samples.data(), samples.size());
+        REQUIRE(samples == std::vector<float>{0.0F, 0.0F, 0.5F, 1.0F, 1.5F, 2.0F, 2.5F, 3.0F});
+    }
+
+    SECTION("Parameter")
+    {
+        pcmplayer::dsp::Gain gain;
+        gain.prepare(48000, 4, 1);
+
+        std::vector<float> samples(4, 1.0F);
+        gain.setGain(0.0F);
+        gain.process(samples.data(), 4);
+
+        // ramps to the new gain over the block
+        REQUIRE(samples == std::vector<float>{0.75F, 0.5F, 0.25F, 0.0F});
+
+        gain.process(samples.data(), 4);
+        REQUIRE(samples == std::vector<float>(4, 0.0F));
+    }
+
+    SECTION("Player")
+    {
+        pcmplayer::dsp::Gain gain(0.5F);
+        Delay delay(3);
+
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 4, 44100, pcmplayer::SampleFormat::float32, 1);
+        audioPlayer.addProcessor(gain);
+        audioPlayer.addProcessor(delay);
+        audioPlayer.play(pcmplayer::SampleBuffer{1.0F, -1.0F, 0.5F, -0.5F, 0.25F});
+
+        REQUIRE(delay.sampleRate == 44100);
+        REQUIRE(delay.channels == 1);
+
+        // the delayed end of the data is rendered as well
+        std::vector<float> result(sink.getData().size() / sizeof(float));
+        std::memcpy(result.data(), sink.getData().data(), sink.getData().size());
+        REQUIRE(result == std::vector<float>{0.0F, 0.0F, 0.0F, 0.5F, -0.5F, 0.25F, -0.25F, 0.125F});
+    }
+}
@@ -0,0 +1,28 @@
+#include <vector>
+#include "catch2/catch.hpp"
+#include "RenderThread.hpp"
+
+TEST_CASE("RenderThread", "[render_thread]")
+{
+    SECTION("Run")
+    {
+        bool called = false;
+        pcmplayer::RenderThreadSettings settings;
+        settings.stackPrefaultSize = 64 * 1024;
+
+        pcmplayer::RenderThread renderThread(settings, [&called]() { called = true; });
+        renderThread.join();
+
+        REQUIRE(called);
+        REQUIRE_FALSE(renderThread.getError());
+    }
+
+    SECTION("Prefault")
+    {
+        std::vector<std::uint8_t> buffer(pcmplayer::RenderThread::getPageSize() * 3 + 1, 0x5A);
+        pcmplayer::RenderThread::prefault(buffer.data(), buffer.size());
+
+        for (const auto value : buffer)
+            REQUIRE(value == 0x5A);
+    }
+}
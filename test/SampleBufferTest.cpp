@@ -0,0 +1,102 @@
+#include <cstdint>
+#include <cstdlib>
+#include "catch2/catch.hpp"
+#include "SampleBuffer.hpp"
+
+namespace
+{
+    std::size_t customAllocations = 0;
+    std::size_t customDeallocations = 0;
+
+    void* allocate(std::size_t size, std::size_t alignment)
+    {
+        ++customAllocations;
+        return ::operator new(size, std::align_val_t{alignment});
+    }
+
+    void deallocate(void* pointer, std::size_t, std::size_t alignment)
+    {
+        ++customDeallocations;
+        ::operator delete(pointer, std::align_val_t{alignment});
+    }
+
+    bool isAligned(const void* pointer, std::size_t alignment)
+    {
+        return reinterpret_cast<std::uintptr_t>(pointer) % alignment == 0;
+    }
+}
+
+TEST_CASE("SampleBuffer", "[sample_buffer]")
+{
+    SECTION("Alignment")
+    {
+        for (const std::size_t size : {1, 3, 16, 1000, 65537})
+        {
+            INFO("Size " << size);
+            pcmplayer::SampleBuffer samples(size, 0.5F);
+            REQUIRE(isAligned(samples.data(), pcmplayer::sampleAlignment));
+            REQUIRE(samples.back() == 0.5F);
+
+            pcmplayer::ByteBuffer bytes(size);
+            REQUIRE(isAligned(bytes.data(), pcmplayer::sampleAlignment));
+        }
+    }
+
+    SECTION("HugePages")
+    {
+        for (const auto hugePages : {pcmplayer::HugePages::none,
+                                     pcmplayer::HugePages::transparent,
+                                     pcmplayer::HugePages::explicitPages})
+        {
+            pcmplayer::SampleAllocatorSettings settings;
+            settings.hugePages = hugePages;
+            pcmplayer::setSampleAllocatorSettings(settings);
+
+            pcmplayer::SampleBuffer samples(1024 * 1024 + 1, 0.25F);
+            REQUIRE(isAligned(samples.data(), pcmplayer::sampleAlignment));
+            REQUIRE(samples.front() == 0.25F);
+            REQUIRE(samples.back() == 0.25F);
+
+#if defined(__linux__)
+            // the samples start at a huge page and a buffer of the threshold is not
+            // pushed over it by the header
+            if (hugePages == pcmplayer::HugePages::transparent)
+            {
+                REQUIRE(isAligned(samples.data(), 2 * 1024 * 1024));
+
+                pcmplayer::SampleBuffer threshold(settings.hugePageThreshold / sizeof(float), 0.5F);
+                REQUIRE(isAligned(threshold.data(), 2 * 1024 * 1024));
+                REQUIRE(threshold.back() == 0.5F);
+
+                // on the heap below the threshold
+                const auto& mapped = pcmplayer::detail::getMappedAllocations().allocations;
+                REQUIRE(mapped.size() == 2);
+                pcmplayer::SampleBuffer small(settings.hugePageThreshold / sizeof(float) - 1);
+                REQUIRE(mapped.size() == 2);
+            }
+#endif
+
+            // freed the way it was allocated after the settings change
+            pcmplayer::setSampleAllocatorSettings(pcmplayer::SampleAllocatorSettings{});
+        }
+    }
+
+    SECTION("Hook")
+    {
+        pcmplayer::SampleAllocatorSettings settings;
+        settings.allocate = allocate;
+        settings.deallocate = deallocate;
+        pcmplayer::setSampleAllocatorSettings(settings);
+
+        customAllocations = 0;
+        customDeallocations = 0;
+        {
+            pcmplayer::SampleBuffer samples(100, 1.0F);
+            REQUIRE(customAllocations == 1);
+            REQUIRE(isAligned(samples.data(), pcmplayer::sampleAlignment));
+
+            pcmplayer::setSampleAllocatorSettings(pcmplayer::SampleAllocatorSettings{});
+        }
+        REQUIRE(customDeallocations == 1);
+    }
+}
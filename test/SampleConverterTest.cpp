@@ -0,0 +1,113 @@
+#include <cstdint>
+#include <vector>
+#include "catch2/catch.hpp"
+#include "SampleConverter.hpp"
+
+TEST_CASE("SampleConverter", "[sample_converter]")
+{
+    const std::vector<float> source = {0.0F, 1.0F, -1.0F, 0.5F, -0.5F, 2.0F, -2.0F};
+
+    SECTION("unsignedInt8")
+    {
+        std::vector<std::uint8_t> destination(source.size());
+        pcmplayer::convert(source.data(), destination.data(), source.size(), pcmplayer::SampleFormat::unsignedInt8);
+        REQUIRE(destination == std::vector<std::uint8_t>{128, 255, 0, 191, 64, 255, 0});
+    }
+
+    SECTION("signedInt16")
+    {
+        std::vector<std::int16_t> destination(source.size());
+        pcmplayer::convert(source.data(), destination.data(), source.size(), pcmplayer::SampleFormat::signedInt16);
+        REQUIRE(destination == std::vector<std::int16_t>{0, 32767, -32767, 16384, -16384, 32767, -32768});
+    }
+
+    SECTION("signedInt24")
+    {
+        std::vector<std::uint8_t> destination(source.size() * 3);
+        pcmplayer::convert(source.data(), destination.data(), source.size(), pcmplayer::SampleFormat::signedInt24);
+        REQUIRE(destination == std::vector<std::uint8_t>{
+            0x00, 0x00, 0x00,
+            0xFF, 0xFF, 0x7F,
+            0x01, 0x00, 0x80,
+            0x00, 0x00, 0x40,
+            0x00, 0x00, 0xC0,
+            0xFF, 0xFF, 0x7F,
+            0x00, 0x00, 0x80
+        });
+    }
+
+    SECTION("signedInt24In32")
+    {
+        std::vector<std::int32_t> destination(source.size());
+        pcmplayer::convert(source.data(), destination.data(), source.size(), pcmplayer::SampleFormat::signedInt24In32);
+        REQUIRE(destination == std::vector<std::int32_t>{0, 8388607, -8388607, 4194304, -4194304, 8388607, -8388608});
+    }
+
+    SECTION("signedInt32")
+    {
+        std::vector<std::int32_t> destination(source.size());
+        pcmplayer::convert(source.data(), destination.data(), source.size(), pcmplayer::SampleFormat::signedInt32);
+        REQUIRE(destination[0] == 0);
+        REQUIRE(destination[1] == 2147483520);
+        REQUIRE(destination[2] == -2147483648);
+        REQUIRE(destination[3] == 1073741824);
+        REQUIRE(destination[4] == -1073741824);
+        REQUIRE(destination[5] == 2147483520);
+        REQUIRE(destination[6] == -2147483648);
+    }
+
+    SECTION("float32")
+    {
+        std::vector<float> destination(source.size());
+        pcmplayer::convert(source.data(), destination.data(), source.size(), pcmplayer::SampleFormat::float32);
+        REQUIRE(destination == source);
+    }
+
+    SECTION("float64")
+    {
+        std::vector<double> destination(source.size());
+        pcmplayer::convert(source.data(), destination.data(), source.size(), pcmplayer::SampleFormat::float64);
+        for (std::size_t i = 0; i < source.size(); ++i)
+            REQUIRE(destination[i] == static_cast<double>(source[i]));
+    }
+
+    SECTION("Dither")
+    {
+        const std::vector<float> silence(1024, 0.0F);
+        std::vector<std::int16_t> destination(silence.size());
+
+        pcmplayer::Dither dither;
+        dither.setEnabled(true);
+        pcmplayer::convert(silence.data(), destination.data(), silence.size(), pcmplayer::SampleFormat::signedInt16, &dither);
+
+        bool nonZero = false;
+        for (const auto sample : destination)
+        {
+            REQUIRE(sample >= -1);
+            REQUIRE(sample <= 1);
+            if (sample != 0) nonZero = true;
+        }
+        REQUIRE(nonZero);
+    }
+}
+
+TEST_CASE("SampleFormatNegotiation", "[sample_format_negotiation]")
+{
+    using pcmplayer::SampleFormat;
+
+    const auto signedInt16 = pcmplayer::getPreferredSampleFormats(SampleFormat::signedInt16);
+    REQUIRE(signedInt16[0] == SampleFormat::signedInt16);
+    REQUIRE(signedInt16[1] == SampleFormat::signedInt24);
+    REQUIRE(signedInt16.back() == SampleFormat::unsignedInt8);
+
+    const auto signedInt24 = pcmplayer::getPreferredSampleFormats(SampleFormat::signedInt24);
+    REQUIRE(signedInt24[0] == SampleFormat::signedInt24);
+    REQUIRE(signedInt24[1] == SampleFormat::signedInt24In32);
+    REQUIRE(signedInt24[2] == SampleFormat::float32);
+    REQUIRE(signedInt24[3] == SampleFormat::signedInt32);
+
+    const auto float32 = pcmplayer::getPreferredSampleFormats(SampleFormat::float32);
+    REQUIRE(float32[0] == SampleFormat::float32);
+    REQUIRE(float32[1] == SampleFormat::float64);
+    REQUIRE(float32[2] == SampleFormat::signedInt32);
+}
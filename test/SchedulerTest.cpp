@@ -0,0 +1,81 @@
+#include <thread>
+#include "catch2/catch.hpp"
+#include "Scheduler.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+#if defined(_WIN32)
+namespace
+{
+    // only reports its handles, never run
+    class HandleStream final: public pcmplayer::ScheduledStream
+    {
+    public:
+        explicit HandleStream(std::size_t initCount): handleCount{initCount} {}
+
+        void startStream() final {}
+        void stopStream() final {}
+        std::size_t getWakeupHandles(pcmplayer::WakeupHandle*, std::size_t) final { return handleCount; }
+        bool process(pcmplayer::WakeupHandle*, std::size_t) final { return false; }
+
+    private:
+        std::size_t handleCount;
+    };
+}
+#endif
+
+TEST_CASE("Scheduler", "[scheduler]")
+{
+    SECTION("Streams")
+    {
+        pcmplayer::null::MemorySink fastSink;
+        pcmplayer::null::AudioPlayer fastPlayer(fastSink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                64, 48000, pcmplayer::SampleFormat::float32, 2);
+        fastPlayer.setSamples(pcmplayer::SampleBuffer(48000 * 2, 0.5F));
+
+        pcmplayer::null::MemorySink pacedSink;
+        pcmplayer::null::AudioPlayer pacedPlayer(pacedSink, pcmplayer::null::Pacing::realTime,
+                                                 480, 48000, pcmplayer::SampleFormat::signedInt16, 1);
+        pacedPlayer.setSamples(pcmplayer::SampleBuffer(4800, 0.5F));
+
+        pcmplayer::Scheduler scheduler;
+        scheduler.add(fastPlayer);
+        scheduler.add(pacedPlayer);
+        scheduler.run();
+
+        REQUIRE(fastSink.getData().size() == 48000 * 2 * sizeof(float));
+        REQUIRE(pacedSink.getData().size() == 4800 * sizeof(std::int16_t));
+        REQUIRE(pacedPlayer.getClock() == 4800);
+    }
+
+    SECTION("Stop")
+    {
+        pcmplayer::null::DiscardSink sink;
+        pcmplayer::null::AudioPlayer player(sink, pcmplayer::null::Pacing::realTime,
+                                            480, 48000, pcmplayer::SampleFormat::float32, 1);
+        player.setSamples(pcmplayer::SampleBuffer(48000 * 60));
+
+        pcmplayer::Scheduler scheduler;
+        scheduler.add(player);
+
+        std::thread thread([&scheduler]() { scheduler.run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        scheduler.stop();
+        thread.join();
+
+        REQUIRE(player.getClock() < 48000 * 60);
+    }
+
+#if defined(_WIN32)
+    SECTION("HandleLimit")
+    {
+        HandleStream first(40);
+        HandleStream second(23);
+        HandleStream third(1);
+
+        pcmplayer::Scheduler scheduler;
+        scheduler.add(first);
+        scheduler.add(second);
+        REQUIRE_THROWS_AS(scheduler.add(third), std::runtime_error);
+    }
+#endif
+}
@@ -0,0 +1,169 @@
+#include <cstring>
+#include <limits>
+#include "catch2/catch.hpp"
+#include "dsp/Gain.hpp"
+#include "dsp/Graph.hpp"
+#include "dsp/ProcessorChain.hpp"
+#include "dsp/Silence.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+namespace
+{
+    // adds an offset to the samples and counts the processed frames
+    class Counter final: public pcmplayer::dsp::Processor
+    {
+    public:
+        Counter(std::uint32_t initTail, float initOffset = 0.0F): tail{initTail}, offset{initOffset} {}
+
+        void prepare(std::uint32_t, std::uint32_t, std::uint16_t newChannels) final { channels = newChannels; }
+
+        void process(float* samples, std::uint32_t count) noexcept final
+        {
+            frames += count;
+            for (std::uint32_t i = 0; i < count * channels; ++i) samples[i] += offset;
+        }
+
+        std::uint32_t getTail() const noexcept final { return tail; }
+
+        std::uint32_t tail;
+        float offset;
+        std::uint16_t channels = 0;
+        std::uint64_t frames = 0;
+    };
+
+    // does not know its tail
+    class Passthrough final: public pcmplayer::dsp::Processor
+    {
+    public:
+        void prepare(std::uint32_t, std::uint32_t, std::uint16_t) final {}
+        void process(float*, std::uint32_t count) noexcept final { frames += count; }
+
+        std::uint64_t frames = 0;
+    };
+}
+
+TEST_CASE("Silence", "[silence]")
+{
+    SECTION("Detect")
+    {
+        std::vector<float> samples(37, 0.0F);
+        REQUIRE(pcmplayer::dsp::isSilent(samples.data(), samples.size()));
+
+        samples[5] = -0.0F;
+        REQUIRE(pcmplayer::dsp::isSilent(samples.data(), samples.size()));
+
+        for (const auto index : {0, 15, 17, 33, 36})
+        {
+            for (const auto value : {1.0F, -1e-30F, std::numeric_limits<float>::denorm_min(),
+                                     std::numeric_limits<float>::quiet_NaN()})
+            {
+                std::fill(samples.begin(), samples.end(), 0.0F);
+                samples[index] = value;
+                INFO("Index " << index << ", value " << value);
+                REQUIRE_FALSE(pcmplayer::dsp::isSilent(samples.data(), samples.size()));
+            }
+        }
+    }
+
+    SECTION("Tail")
+    {
+        Counter counter(600);
+        Counter endless(pcmplayer::dsp::Processor::infiniteTail);
+        pcmplayer::dsp::ProcessorChain chain;
+        chain.add(counter);
+        chain.add(endless);
+        chain.prepare(48000, 256, 2);
+
+        // nothing to ring out yet
+        std::vector<float> samples(256 * 2, 0.0F);
+        REQUIRE(chain.process(samples.data(), 256));
+        REQUIRE(counter.frames == 0);
+        REQUIRE(endless.frames == 256);
+
+        samples[0] = 1.0F;
+        REQUIRE_FALSE(chain.process(samples.data(), 256));
+        REQUIRE(counter.frames == 256);
+
+        // until the silent input has covered the tail
+        for (int i = 0; i < 4; ++i)
+        {
+            std::fill(samples.begin(), samples.end(), 0.0F);
+            REQUIRE(chain.process(samples.data(), 256, true));
+        }
+        REQUIRE(counter.frames == 256 + 768);
+        REQUIRE(endless.frames == 256 * 6);
+
+        chain.reset();
+        samples[0] = 0.5F;
+        chain.process(samples.data(), 256);
+        REQUIRE(counter.frames == 256 + 1024);
+    }
+
+    SECTION("Default")
+    {
+        // skipping is opt-in
+        Passthrough passthrough;
+        pcmplayer::dsp::Gain gain(0.5F);
+        REQUIRE(passthrough.getTail() == pcmplayer::dsp::Processor::infiniteTail);
+        REQUIRE(gain.getTail() == 0);
+
+        pcmplayer::dsp::ProcessorChain chain;
+        chain.add(passthrough);
+        chain.prepare(48000, 256, 2);
+
+        std::vector<float> samples(256 * 2, 0.0F);
+        for (int i = 0; i < 3; ++i)
+            chain.process(samples.data(), 256, true);
+        REQUIRE(passthrough.frames == 256 * 3);
+    }
+
+    SECTION("Player")
+    {
+        // a second of silence between two blocks of a tone
+        pcmplayer::SampleBuffer samples(3000 * 2 + 48000 * 2, 0.0F);
+        for (std::size_t i = 0; i < 3000 * 2; ++i)
+        {
+            samples[i / 2 < 1500 ? i : samples.size() - 3000 * 2 + i] = i % 2 ? 0.25F : -0.25F;
+        }
+
+        Counter counter(1000);
+
+        pcmplayer::null::MemorySink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 256, 48000, pcmplayer::SampleFormat::signedInt16, 2);
+        audioPlayer.addProcessor(counter);
+        audioPlayer.play(samples);
+
+        REQUIRE(counter.frames < 10000);
+
+        std::vector<std::int16_t> output(sink.getData().size() / sizeof(std::int16_t));
+        std::memcpy(output.data(), sink.getData().data(), sink.getData().size());
+        REQUIRE(output.size() == samples.size());
+        for (std::size_t i = 0; i < output.size(); ++i)
+            if (output[i] != static_cast<std::int16_t>(samples[i] * 32768.0F))
+                FAIL("Sample " << i << " is " << output[i]);
+    }
+
+    SECTION("Graph")
+    {
+        pcmplayer::BufferSource first(pcmplayer::SampleBuffer(1000 * 2, 0.0F), 2);
+        pcmplayer::BufferSource second(pcmplayer::SampleBuffer(1000 * 2, 0.5F), 2);
+        Counter bus(0, 0.25F);
+        Counter effect(100);
+
+        pcmplayer::dsp::Graph graph(2, 256);
+        const auto silentBus = graph.addProcessor(effect);
+        const auto output = graph.addProcessor(bus);
+        graph.connect(graph.addSource(first), silentBus);
+        graph.connect(silentBus, output);
+        graph.connect(graph.addSource(second), output, 0.5F);
+        graph.prepare(48000, output, 0);
+
+        std::vector<float> result(1000 * 2);
+        REQUIRE(graph.read(result.data(), 1000) == 1000);
+        REQUIRE(effect.frames == 0);
+        REQUIRE(bus.frames == 1000);
+        REQUIRE(result.front() == 0.5F);
+        REQUIRE(result.back() == 0.5F);
+    }
+}
@@ -0,0 +1,166 @@
+#include <cmath>
+#include "catch2/catch.hpp"
+#include "dsp/TimeStretch.hpp"
+#include "dsp/Varispeed.hpp"
+#include "null/NullAudioPlayer.hpp"
+
+namespace
+{
+    pcmplayer::SampleBuffer getSine(float frequency, std::uint32_t sampleRate, std::uint16_t channels, std::size_t frames)
+    {
+        pcmplayer::SampleBuffer result(frames * channels);
+        for (std::size_t frame = 0; frame < frames; ++frame)
+            for (std::uint16_t channel = 0; channel < channels; ++channel)
+                result[frame * channels + channel] = 0.5F *
+                    std::sin(2.0F * 3.14159265F * frequency * static_cast<float>(frame) / static_cast<float>(sampleRate));
+        return result;
+    }
+
+    std::vector<float> readAll(pcmplayer::Source& source, std::uint16_t channels)
+    {
+        std::vector<float> result;
+        std::vector<float> buffer(300 * channels);
+        while (!source.isFinished())
+        {
+            const auto frames = source.read(buffer.data(), 300);
+            result.insert(result.end(), buffer.begin(), buffer.begin() + frames * channels);
+            if (frames < 300) break;
+        }
+        return result;
+    }
+
+    // the frequency from the rising zero crossings of the first channel
+    float getFrequency(const std::vector<float>& samples, std::uint16_t channels, std::uint32_t sampleRate,
+                       std::size_t first, std::size_t last)
+    {
+        std::size_t crossings = 0;
+        std::size_t firstCrossing = 0;
+        std::size_t lastCrossing = 0;
+        for (std::size_t frame = first + 1; frame < last; ++frame)
+            if (samples[(frame - 1) * channels] < 0.0F && samples[frame * channels] >= 0.0F)
+            {
+                if (crossings++ == 0) firstCrossing = frame;
+                lastCrossing = frame;
+            }
+
+        return static_cast<float>(crossings - 1) * sampleRate / static_cast<float>(lastCrossing - firstCrossing);
+    }
+}
+
+TEST_CASE("Varispeed", "[varispeed]")
+{
+    SECTION("Original speed")
+    {
+        const auto samples = getSine(1000.0F, 48000, 2, 10000);
+        pcmplayer::BufferSource source(samples, 2);
+        pcmplayer::dsp::Varispeed varispeed(source, 2);
+
+        const auto result = readAll(varispeed, 2);
+        REQUIRE(result.size() == samples.size());
+        for (std::size_t i = 0; i < samples.size(); ++i)
+            REQUIRE(result[i] == Approx(samples[i]).margin(0.0001));
+    }
+
+    SECTION("Speed")
+    {
+        const auto samples = getSine(1000.0F, 48000, 2, 48000);
+        pcmplayer::BufferSource source(samples, 2);
+        pcmplayer::dsp::Varispeed varispeed(source, 2);
+        varispeed.setSpeed(1.5F);
+
+        // the pitch follows the speed
+        const auto result = readAll(varispeed, 2);
+        REQUIRE(result.size() / 2 == Approx(32000).margin(2));
+        REQUIRE(getFrequency(result, 2, 48000, 100, 31000) == Approx(1500.0F).epsilon(0.001));
+        REQUIRE(result[2000 * 2] == Approx(result[2000 * 2 + 1]));
+    }
+
+    SECTION("Change")
+    {
+        const auto samples = getSine(1000.0F, 48000, 1, 48000);
+        pcmplayer::BufferSource source(samples, 1);
+        pcmplayer::dsp::Varispeed varispeed(source, 1);
+
+        std::vector<float> result(24000);
+        varispeed.read(result.data(), 12000);
+        varispeed.setSpeed(0.5F);
+        varispeed.read(result.data() + 12000, 12000);
+
+        REQUIRE(varispeed.getPosition() == Approx(18000.0));
+        REQUIRE(getFrequency(result, 1, 48000, 100, 11900) == Approx(1000.0F).epsilon(0.001));
+        REQUIRE(getFrequency(result, 1, 48000, 12100, 23900) == Approx(500.0F).epsilon(0.001));
+    }
+
+    SECTION("Pause")
+    {
+        // the window must not move backwards when the speed goes up between short reads
+        const auto samples = getSine(1000.0F, 48000, 2, 4800);
+        const float speeds[] = {1.0F, 0.0F, 4.0F, 0.5F, 0.0F, 4.0F, 2.0F, 0.0F, 4.0F};
+
+        pcmplayer::BufferSource source(samples, 2);
+        pcmplayer::dsp::Varispeed varispeed(source, 2);
+        pcmplayer::BufferSource referenceSource(samples, 2);
+        pcmplayer::dsp::Varispeed reference(referenceSource, 2);
+
+        std::vector<float> output(64 * 2);
+        std::vector<float> expected(64 * 2);
+        for (const auto speed : speeds)
+        {
+            INFO("Speed " << speed);
+            varispeed.setSpeed(speed);
+            REQUIRE(varispeed.read(output.data(), 64) == 64);
+
+            if (speed == 0.0F)
+            {
+                // silent and the position is held
+                for (const auto sample : output) REQUIRE(sample == 0.0F);
+                continue;
+            }
+
+            reference.setSpeed(speed);
+            REQUIRE(reference.read(expected.data(), 64) == 64);
+            REQUIRE(output == expected);
+        }
+
+        REQUIRE(varispeed.getPosition() == reference.getPosition());
+    }
+}
+
+TEST_CASE("TimeStretch", "[time_stretch]")
+{
+    SECTION("Rate")
+    {
+        for (const auto rate : {0.5F, 1.0F, 1.5F})
+        {
+            const auto samples = getSine(440.0F, 48000, 2, 48000);
+            pcmplayer::BufferSource source(samples, 2);
+            pcmplayer::dsp::TimeStretch timeStretch(source, 2, 48000);
+            timeStretch.setRate(rate);
+
+            // the length follows the rate and the pitch stays
+            INFO("Rate " << rate);
+            const auto result = readAll(timeStretch, 2);
+            REQUIRE(result.size() / 2 == Approx(48000 / rate).epsilon(0.05));
+            REQUIRE(getFrequency(result, 2, 48000, 4000, result.size() / 2 - 4000) == Approx(440.0F).epsilon(0.01));
+
+            float peak = 0.0F;
+            for (std::size_t i = 4000 * 2; i < result.size() - 4000 * 2; ++i)
+                peak = std::fabs(result[i]) > peak ? std::fabs(result[i]) : peak;
+            REQUIRE(peak == Approx(0.5F).epsilon(0.05));
+        }
+    }
+
+    SECTION("Player")
+    {
+        pcmplayer::BufferSource source(getSine(440.0F, 44100, 1, 44100), 1);
+        pcmplayer::dsp::TimeStretch timeStretch(source, 1, 44100);
+        timeStretch.setRate(2.0F);
+
+        pcmplayer::null::DiscardSink sink;
+        pcmplayer::null::AudioPlayer audioPlayer(sink, pcmplayer::null::Pacing::asFastAsPossible,
+                                                 512, 44100, pcmplayer::SampleFormat::signedInt16, 1);
+        audioPlayer.play(timeStretch);
+
+        REQUIRE(sink.getBytesWritten() / sizeof(std::int16_t) == Approx(22050).epsilon(0.05));
+    }
+}
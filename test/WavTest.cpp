@@ -30,7 +30,7 @@ public:
     }
 
 private:
-    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in) override
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode = std::ios_base::in) override
     {
         if (dir == std::ios_base::cur)
             setg(eback(), gptr() + off, egptr());
@@ -41,7 +41,7 @@ private:
         return gptr() - eback();
     }
 
-    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override
+    pos_type seekpos(pos_type sp, std::ios_base::openmode) override
     {
         setg(eback(), eback() + sp, egptr());
         return gptr() - eback();
@@ -57,10 +57,12 @@ TEST_CASE("Decoding", "[decoding]")
         MemoryBuffer buffer(std::begin(data), std::end(data));
         std::istream stream(&buffer);
 
-        Wav wav(stream);
+        Wav wav(stream, true);
         REQUIRE(wav.getChannels() == 2);
         REQUIRE(wav.getSampleRate() == 48000);
         REQUIRE(wav.getFrames() == 3);
+        REQUIRE(wav.getSampleFormat() == pcmplayer::SampleFormat::signedInt16);
+        REQUIRE(wav.getData().size() == 12);
 
         const auto& samples = wav.getSamples();
         REQUIRE(samples[0] == Approx(1.0F));
@@ -78,10 +80,12 @@ TEST_CASE("Decoding", "[decoding]")
         MemoryBuffer buffer(std::begin(data), std::end(data));
         std::istream stream(&buffer);
 
-        Wav wav(stream);
+        Wav wav(stream, true);
         REQUIRE(wav.getChannels() == 2);
         REQUIRE(wav.getSampleRate() == 48000);
         REQUIRE(wav.getFrames() == 3);
+        REQUIRE(wav.getSampleFormat() == pcmplayer::SampleFormat::signedInt24);
+        REQUIRE(wav.getData().size() == 18);
 
         const auto& samples = wav.getSamples();
         REQUIRE(samples[0] == Approx(1.0F));
@@ -99,10 +103,12 @@ TEST_CASE("Decoding", "[decoding]")
         MemoryBuffer buffer(std::begin(data), std::end(data));
         std::istream stream(&buffer);
 
-        Wav wav(stream);
+        Wav wav(stream, true);
         REQUIRE(wav.getChannels() == 2);
         REQUIRE(wav.getSampleRate() == 48000);
         REQUIRE(wav.getFrames() == 3);
+        REQUIRE(wav.getSampleFormat() == pcmplayer::SampleFormat::float32);
+        REQUIRE(wav.getData().size() == 24);
 
         const auto& samples = wav.getSamples();
         REQUIRE(samples[0] == Approx(1.0F));
@@ -121,3 +127,45 @@ TEST_CASE("Encodin", "[encoding]")
         Wav wav(2, 48000, 3, {1.0F, 1.0F, -1.0F, -1.0F, 0.0F, 0.0F});
     }
 }
+
+TEST_CASE("Markers", "[markers]")
+{
+    std::vector<std::uint8_t> data;
+    const auto append = [&data](std::initializer_list<std::uint32_t> values) {
+        for (const auto value : values)
+            for (int i = 0; i < 4; ++i)
+                data.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+    };
+
+    data = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E'};
+    data.insert(data.end(), {'f', 'm', 't', ' '});
+    append({16, 0x00010001, 44100, 88200, 0x00100002}); // PCM, mono, 16-bit
+    data.insert(data.end(), {'d', 'a', 't', 'a'});
+    append({8, 0x20001000, 0x40003000}); // 4 frames
+    data.insert(data.end(), {'c', 'u', 'e', ' '});
+    append({4 + 24, 1, 7, 0, 0x61746164, 0, 0, 3});
+    data.insert(data.end(), {'s', 'm', 'p', 'l'});
+    append({36 + 24, 0, 0, 22675, 60, 0, 0, 0, 1, 0, 7, 0, 1, 2, 0, 3});
+
+    const auto length = static_cast<std::uint32_t>(data.size() - 8);
+    for (int i = 0; i < 4; ++i)
+        data[4 + i] = static_cast<std::uint8_t>(length >> (i * 8));
+
+    MemoryBuffer buffer(data.data(), data.data() + data.size());
+    std::istream stream(&buffer);
+
+    Wav wav(stream);
+    REQUIRE(wav.getFrames() == 4);
+    REQUIRE(wav.getData().empty());
+
+    REQUIRE(wav.getCuePoints().size() == 1);
+    REQUIRE(wav.getCuePoints()[0].id == 7);
+    REQUIRE(wav.getCuePoints()[0].frame == 3);
+
+    REQUIRE(wav.getLoops().size() == 1);
+    REQUIRE(wav.getLoops()[0].cuePointId == 7);
+    REQUIRE(wav.getLoops()[0].type == Wav::Loop::Type::forward);
+    REQUIRE(wav.getLoops()[0].start == 1);
+    REQUIRE(wav.getLoops()[0].end == 3); // exclusive, the chunk stores 2
+    REQUIRE(wav.getLoops()[0].playCount == 3);
+}